@@ -0,0 +1,202 @@
+#!/bin/bash
+#
+# bench.sh - end-to-end throughput benchmark for the data-path tools.
+#
+# Usage: bench/bench.sh [-b BIN_DIR] [-c COMPARE] [-s SIZES] [-r REPS]
+#                       [-d CORPUS_DIR] [-o JSON_FILE]
+#
+#   -b  directory holding the binaries under test (default: bin)
+#   -c  what to compare against: a directory holding another build,
+#       or 'system' for whatever the tools in PATH resolve to
+#   -s  space-separated corpus sizes, with K/M/G suffixes
+#       (default: "1K 1M 64M"; try "1K 1M 64M 1G 4G" for a full run)
+#   -r  repetitions per measurement (default: 5)
+#   -d  where the generated corpus is kept (default: obj/bench/data)
+#   -o  where the JSON results are written (default: obj/bench/results.json)
+#
+# The helpers corpus and runner are expected in obj/bench, which is
+# where `make bench` builds them. The corpus is generated once per
+# shape and size and reused by later runs.
+
+BIN_DIR="bin"
+COMPARE=""
+SIZES="1K 1M 64M"
+REPS=5
+HELPER_DIR="obj/bench"
+CORPUS_DIR="${HELPER_DIR}/data"
+JSON_FILE="${HELPER_DIR}/results.json"
+
+while getopts "b:c:s:r:d:o:" opt; do
+    case "${opt}" in
+        b) BIN_DIR="${OPTARG}" ;;
+        c) COMPARE="${OPTARG}" ;;
+        s) SIZES="${OPTARG}" ;;
+        r) REPS="${OPTARG}" ;;
+        d) CORPUS_DIR="${OPTARG}" ;;
+        o) JSON_FILE="${OPTARG}" ;;
+        *) sed -n '3,20p' "$0" | sed 's/^# \{0,1\}//'; exit 1 ;;
+    esac
+done
+
+CORPUS="${HELPER_DIR}/corpus"
+RUNNER="${HELPER_DIR}/runner"
+
+# tool|arguments|shapes
+CASES=(
+    "cat||text binary longline small"
+    "wc||text longline small"
+    "wc|-l|text longline"
+    "md5sum||binary small"
+    "sha224sum||binary small"
+    "sha256sum||binary small"
+    "sha384sum||binary small"
+    "sha512sum||binary small"
+    "base64||binary"
+    "base64|-d|b64"
+    "base32||binary"
+    "base32|-d|b32"
+    "od||binary"
+    "head|-n 1000000000|text"
+    "tail|-n 1000|text"
+    "fold|-w 80|text longline"
+    "nl||text"
+)
+
+# Many small files are passed on the command line, so cap
+# that shape before it runs into ARG_MAX.
+SMALL_MAX=$((64 * 1024 * 1024))
+
+to_bytes() {
+    local n="${1%[KMG]}"
+    case "$1" in
+        *K) echo $(( n << 10 )) ;;
+        *M) echo $(( n << 20 )) ;;
+        *G) echo $(( n << 30 )) ;;
+        *)  echo "${n}" ;;
+    esac
+}
+
+# Generate the corpus for shape $1, size $2 at path $3, unless it exists.
+make_corpus() {
+    if [[ ! -e "$3.lines" ]]; then
+        rm -rf "$3"
+        if ! "${CORPUS}" "$1" "$2" "$3" > "$3.lines"; then
+            rm -f "$3.lines"
+            echo "bench.sh: unable to generate $3" >&2
+            exit 1
+        fi
+    fi
+}
+
+# Resolve the binary for tool $1 in build $2 ('system' or a directory).
+resolve_tool() {
+    if [[ "$2" == "system" ]]; then
+        command -v "$1"
+    elif [[ -x "$2/$1" ]]; then
+        echo "$2/$1"
+    fi
+}
+
+# Run one measurement and print "<median s> <rss KiB> <status>".
+measure() {
+    local out
+    out=$("${RUNNER}" "${REPS}" "$@")
+    read -r _ median rss status <<< "${out}"
+    echo "${median} ${rss} ${status}"
+}
+
+# Print "<MB/s> <lines/s>" for bytes $1 and lines $2 handled in $3 seconds.
+rates() {
+    awk -v b="$1" -v l="$2" -v t="$3" \
+        'BEGIN { if (t > 0) printf "%.2f %.0f", b / t / 1e6, l / t; else print "0 0" }'
+}
+
+# Append one result object to the JSON array. Arguments:
+# build tool args shape size bytes lines median rss status
+json_sep=""
+json_record() {
+    local mbs lps
+    read -r mbs lps <<< "$(rates "$6" "$7" "$8")"
+    printf '%s\n  {"build": "%s", "tool": "%s", "args": "%s", "shape": "%s", "size": "%s", ' \
+        "${json_sep}" "$1" "$2" "$3" "$4" "$5" >> "${JSON_FILE}.tmp"
+    printf '"bytes": %s, "lines": %s, "reps": %s, "median_s": %s, ' \
+        "$6" "$7" "${REPS}" "$8" >> "${JSON_FILE}.tmp"
+    printf '"mb_per_s": %s, "lines_per_s": %s, "max_rss_kb": %s, "status": %s}' \
+        "${mbs}" "${lps}" "$9" "${10}" >> "${JSON_FILE}.tmp"
+    json_sep=","
+}
+
+if [[ ! -x "${CORPUS}" || ! -x "${RUNNER}" ]]; then
+    echo "bench.sh: helpers not found in ${HELPER_DIR}, run 'make bench'" >&2
+    exit 1
+fi
+
+mkdir -p "${CORPUS_DIR}" "$(dirname "${JSON_FILE}")"
+printf '[' > "${JSON_FILE}.tmp"
+
+header=$(printf "%-10s %-16s %-9s %6s %10s %12s %9s" \
+                "tool" "args" "shape" "size" "MB/s" "lines/s" "RSS KiB")
+if [[ -n "${COMPARE}" ]]; then
+    header+=$(printf " %10s %9s %8s" "cmp MB/s" "cmp RSS" "speedup")
+fi
+echo "${header}"
+
+for size in ${SIZES}; do
+    bytes_wanted=$(to_bytes "${size}")
+
+    for c in "${CASES[@]}"; do
+        IFS='|' read -r tool args shapes <<< "${c}"
+        read -r -a arg_list <<< "${args}"
+
+        bin=$(resolve_tool "${tool}" "${BIN_DIR}")
+        [[ -n "${bin}" ]] || continue
+
+        for shape in ${shapes}; do
+            if [[ "${shape}" == "small" && ${bytes_wanted} -gt ${SMALL_MAX} ]]; then
+                continue
+            fi
+
+            path="${CORPUS_DIR}/${shape}-${size}"
+            make_corpus "${shape}" "${size}" "${path}"
+            lines=$(cat "${path}.lines")
+            if [[ "${shape}" == "small" ]]; then
+                files=("${path}"/*)
+                bytes=$(cat "${files[@]}" | wc -c)
+            else
+                files=("${path}")
+                bytes=$(wc -c < "${path}")
+            fi
+            bytes=$(( bytes + 0 ))
+
+            read -r median rss status <<< "$(measure "${bin}" "${arg_list[@]}" "${files[@]}")"
+            json_record "${BIN_DIR}" "${tool}" "${args}" "${shape}" "${size}" \
+                        "${bytes}" "${lines}" "${median}" "${rss}" "${status}"
+            read -r mbs lps <<< "$(rates "${bytes}" "${lines}" "${median}")"
+
+            [[ "${status}" == "0" ]] || mbs="failed(${status})"
+            row=$(printf "%-10s %-16s %-9s %6s %10s %12s %9s" \
+                         "${tool}" "${args}" "${shape}" "${size}" "${mbs}" "${lps}" "${rss}")
+
+            if [[ -n "${COMPARE}" ]]; then
+                cmp_bin=$(resolve_tool "${tool}" "${COMPARE}")
+                if [[ -n "${cmp_bin}" ]]; then
+                    read -r c_median c_rss c_status <<< "$(measure "${cmp_bin}" "${arg_list[@]}" "${files[@]}")"
+                    json_record "${COMPARE}" "${tool}" "${args}" "${shape}" "${size}" \
+                                "${bytes}" "${lines}" "${c_median}" "${c_rss}" "${c_status}"
+                    read -r c_mbs _ <<< "$(rates "${bytes}" "${lines}" "${c_median}")"
+                    speedup=$(awk -v a="${median}" -v b="${c_median}" \
+                                  'BEGIN { printf "%.2fx", (a > 0) ? b / a : 0 }')
+                    [[ "${c_status}" == "0" ]] || c_mbs="failed(${c_status})"
+                    [[ "${status}" == "0" && "${c_status}" == "0" ]] || speedup="-"
+                    row+=$(printf " %10s %9s %8s" "${c_mbs}" "${c_rss}" "${speedup}")
+                fi
+            fi
+            echo "${row}"
+        done
+    done
+done
+
+printf '\n]\n' >> "${JSON_FILE}.tmp"
+mv "${JSON_FILE}.tmp" "${JSON_FILE}"
+echo
+echo "results written to ${JSON_FILE}"
@@ -0,0 +1,240 @@
+/***************************************************************************
+ *   corpus.c - generate deterministic benchmark input files               *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Usage: corpus SHAPE SIZE PATH
+ *
+ * Writes SIZE bytes of SHAPE data to PATH, and prints the number of
+ * newlines written on stdout. The same SHAPE and SIZE always produce
+ * the same bytes. SIZE takes an optional K, M or G (binary) suffix.
+ *
+ * Shapes:
+ *   text      words separated by spaces, lines of 20-120 bytes
+ *   binary    uniformly random bytes
+ *   longline  text with lines of about 1 MiB
+ *   b64       random bytes, base64 encoded and wrapped at 76 columns
+ *   b32       random bytes, base32 encoded and wrapped at 76 columns
+ *   small     PATH is a directory, filled with 4 KiB text files
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "../src/common.h"
+
+#define BLOCK_SIZE (1 << 20)
+#define SMALL_FILE_SIZE 4096
+
+static const char *APP_NAME = "corpus";
+
+static uint64_t rng_state;
+
+/* xorshift64*, good enough for filler data and fully reproducible. */
+static uint64_t next_rand()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static constexpr char words[][8] = { "the", "of", "and", "a", "to", "in", "is",
+                                     "you", "that", "it", "he", "was", "for",
+                                     "on", "are", "as", "with", "his", "they",
+                                     "at", "be", "this", "have", "from", "or",
+                                     "one", "had", "by", "word", "but", "not",
+                                     "what", "all", "were", "we", "when" };
+
+static constexpr char b64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char b32_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+static uint64_t parse_size(const char *arg)
+{
+    char *end;
+    uint64_t n = strtoull(arg, &end, 10);
+    switch (*end) {
+        case 'G': n <<= 10; [[fallthrough]];
+        case 'M': n <<= 10; [[fallthrough]];
+        case 'K': n <<= 10; break;
+        case '\0': break;
+        default:
+            fprintf(stderr, "%s: bad size '%s'\n", APP_NAME, arg);
+            exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+/* Fill buf with text whose lines are between min_line and max_line
+ * bytes long. 'col' carries the current column across calls. */
+static uint64_t fill_text(char *buf, const size_t len, size_t *col,
+                          const size_t min_line, const size_t max_line)
+{
+    static size_t line_len = 0;
+    uint64_t lines = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (line_len == 0) {
+            line_len = min_line + next_rand() % (max_line - min_line + 1);
+        }
+        if (*col >= line_len) {
+            buf[i++] = '\n';
+            lines++;
+            *col = 0;
+            line_len = 0;
+            continue;
+        }
+        const char *w = words[next_rand() % (sizeof(words) / sizeof(words[0]))];
+        for (; *w && i < len; w++, (*col)++) {
+            buf[i++] = *w;
+        }
+        if (i < len) {
+            buf[i++] = ' ';
+            (*col)++;
+        }
+    }
+    return lines;
+}
+
+static void fill_binary(uint8_t *buf, const size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(next_rand() >> 56);
+    }
+}
+
+/* Fill buf with random base32 or base64 digits wrapped at 76 columns. */
+static uint64_t fill_encoded(char *buf, const size_t len, size_t *col,
+                             const char *digits, const int n_digits)
+{
+    uint64_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (*col == 76) {
+            buf[i] = '\n';
+            lines++;
+            *col = 0;
+        } else {
+            buf[i] = digits[next_rand() % n_digits];
+            (*col)++;
+        }
+    }
+    return lines;
+}
+
+static uint64_t write_file(const char *shape, uint64_t size, const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "%s: unable to open %s: %s\n", APP_NAME, path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    char *buf = malloc(BLOCK_SIZE);
+    if (!buf) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", APP_NAME);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Trim encoded shapes so they decode without a partial group.
+     * A 76-digit line holds whole base64 groups of 4, but base32
+     * groups of 8 only line up every second line. */
+    if (strcmp(shape, "b64") == 0) {
+        size = size / 77 * 77;
+    } else if (strcmp(shape, "b32") == 0) {
+        size = size / 154 * 154;
+    }
+
+    uint64_t lines = 0;
+    size_t col = 0;
+    while (size > 0) {
+        const size_t len = size < BLOCK_SIZE ? size : BLOCK_SIZE;
+
+        if (strcmp(shape, "text") == 0) {
+            lines += fill_text(buf, len, &col, 20, 120);
+        } else if (strcmp(shape, "longline") == 0) {
+            lines += fill_text(buf, len, &col, 1 << 20, (1 << 20) + 4096);
+        } else if (strcmp(shape, "binary") == 0) {
+            fill_binary((uint8_t *)buf, len);
+            for (size_t i = 0; i < len; i++) {
+                lines += buf[i] == '\n';
+            }
+        } else if (strcmp(shape, "b64") == 0) {
+            lines += fill_encoded(buf, len, &col, b64_digits, 64);
+        } else if (strcmp(shape, "b32") == 0) {
+            lines += fill_encoded(buf, len, &col, b32_digits, 32);
+        } else {
+            fprintf(stderr, "%s: unknown shape '%s'\n", APP_NAME, shape);
+            exit(EXIT_FAILURE);
+        }
+
+        if (fwrite(buf, 1, len, fp) != len) {
+            fprintf(stderr, "%s: write to %s failed: %s\n", APP_NAME, path, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        size -= len;
+    }
+
+    free(buf);
+    fclose(fp);
+    return lines;
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s SHAPE SIZE PATH\n", APP_NAME);
+        return EXIT_FAILURE;
+    }
+
+    const char *shape = argv[1];
+    const uint64_t size = parse_size(argv[2]);
+    const char *path = argv[3];
+
+    rng_state = 0x9e3779b97f4a7c15ULL ^ size;
+
+    if (strcmp(shape, "small") == 0) {
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "%s: unable to create %s: %s\n", APP_NAME, path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        const size_t name_len = strlen(path) + 16;
+        char *name = malloc(name_len);
+        if (!name) {
+            fprintf(stderr, "%s: unable to allocate memory!\n", APP_NAME);
+            return EXIT_FAILURE;
+        }
+
+        uint64_t lines = 0;
+        const uint64_t n_files = size / SMALL_FILE_SIZE ? size / SMALL_FILE_SIZE : 1;
+        for (uint64_t i = 0; i < n_files; i++) {
+            snprintf(name, name_len, "%s/%08" PRIu64, path, i);
+            lines += write_file("text", SMALL_FILE_SIZE, name);
+        }
+        free(name);
+        printf("%" PRIu64 "\n", lines);
+        return EXIT_SUCCESS;
+    }
+
+    printf("%" PRIu64 "\n", write_file(shape, size, path));
+    return EXIT_SUCCESS;
+}
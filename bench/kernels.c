@@ -0,0 +1,633 @@
+/***************************************************************************
+ *   kernels.c - time the inner loops of the data-path tools in memory     *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+/*
+ * Usage: kernels [-s SIZE] [-n ITERATIONS] [-k KERNEL] [-c CPU] [-l]
+ *
+ * Runs the inner loops of md5sum, sha256sum, sha512sum, base64, base32
+ * and wc over a buffer held in memory, so no I/O is timed, and prints
+ * the best of ITERATIONS runs of each as cycles/byte, ns/byte and MB/s.
+ * Cycles come from the time stamp counter where there is one (x86), and
+ * are shown as '-' elsewhere. Pin to a CPU with -c for stable numbers.
+ * The CPU features in use are printed first; set ULL_FORCE_ISA to time
+ * the kernels with fewer of them.
+ *
+ *   -s  buffer size, with an optional K, M or G suffix (default: 16M)
+ *   -n  iterations per kernel (default: 10)
+ *   -k  run only the named kernel
+ *   -c  pin the process to this CPU (Linux only)
+ *   -l  list the kernels
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include <getopt.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "../src/common.h"
+#include "../src/cpu.h"
+#include "../src/md5.h"
+#include "../src/sha2.h"
+#include "../src/basenc.h"
+#include "../src/wc.h"
+
+
+static const char *APP_NAME = "kernels";
+
+static struct {
+    uint64_t size;
+    int iterations;
+    const char *only;
+    int cpu;
+} opts = {
+    .size = 16 << 20,
+    .iterations = 10,
+    .only = nullptr,
+    .cpu = -1 };
+
+/* The input buffers, and a buffer big enough for any kernel's output. */
+static uint8_t *binary_buf;
+static uint8_t *text_buf;
+static uint8_t *b64_buf;
+static uint8_t *b32_buf;
+static uint8_t *out_buf;
+static size_t b64_len;
+static size_t b32_len;
+
+static int8_t b64_map[256];
+static int8_t b32_map[256];
+
+/* Folded into by every kernel so the compiler cannot drop the work. */
+static volatile uint64_t sink;
+
+/* Each kernel runs once over its input and returns the bytes consumed. */
+static size_t run_md5()
+{
+    uint32_t reg[4];
+    memcpy(reg, md5_init_regs, sizeof(reg));
+    const size_t len = opts.size / 64 * 64;
+    for (size_t i = 0; i < len; i += 64) {
+        process_chunk(reg, binary_buf + i);
+    }
+    sink += reg[0];
+    return len;
+}
+
+/* Hash the buffer as one message per MD5 lane, each a contiguous slice of it.
+ * Returns the bytes hashed, or 0 without a multi-lane kernel. */
+static size_t md5_mb_run(uint32_t st[4][MD5_MB_MAX_LANES])
+{
+    const typeof(md5_mb_impls[0]) *mb = CPU_SELECT(md5_mb_impls);
+    if (mb->lanes == 0) {
+        return 0;
+    }
+
+    const size_t blocks = opts.size / 64 / mb->lanes;
+    const uint8_t *data[MD5_MB_MAX_LANES];
+    for (size_t l = 0; l < mb->lanes; l++) {
+        data[l] = binary_buf + l * blocks * 64;
+        for (int j = 0; j < 4; j++) {
+            st[j][l] = md5_init_regs[j];
+        }
+    }
+    mb->fn(st, data, blocks);
+    return blocks * 64 * mb->lanes;
+}
+
+static size_t run_md5_mb()
+{
+    uint32_t st[4][MD5_MB_MAX_LANES];
+    const size_t len = md5_mb_run(st);
+    if (len > 0) {
+        sink += st[0][0];
+    }
+    return len;
+}
+
+static size_t run_sha256()
+{
+    uint32_t reg[8];
+    memcpy(reg, sha256_init_regs, sizeof(reg));
+    const size_t len = opts.size / 64 * 64;
+    CPU_SELECT(sha256_blocks_impls)->fn(reg, binary_buf, len / 64);
+    sink += reg[0];
+    return len;
+}
+
+/* The widest multi-buffer SHA-256 kernel this CPU can run, or nullptr. */
+static const typeof(sha256_mb_impls[0]) *sha256_mb_best()
+{
+    for (size_t i = 0; i < sizeof(sha256_mb_impls) / sizeof(sha256_mb_impls[0]); i++) {
+        if (sha256_mb_impls[i].lanes > 0 &&
+            (sha256_mb_impls[i].needs & cpu_features()) == sha256_mb_impls[i].needs) {
+            return &sha256_mb_impls[i];
+        }
+    }
+    return nullptr;
+}
+
+/* Hash the buffer as one message per lane, each a contiguous slice of it.
+ * Returns the bytes hashed, or 0 without a multi-buffer kernel. */
+static size_t sha256_mb_run(uint32_t st[8][SHA256_MB_MAX_LANES])
+{
+    const typeof(sha256_mb_impls[0]) *mb = sha256_mb_best();
+    if (mb == nullptr) {
+        return 0;
+    }
+
+    const size_t blocks = opts.size / 64 / mb->lanes;
+    const uint8_t *data[SHA256_MB_MAX_LANES];
+    for (size_t l = 0; l < mb->lanes; l++) {
+        data[l] = binary_buf + l * blocks * 64;
+        for (int j = 0; j < 8; j++) {
+            st[j][l] = sha256_init_regs[j];
+        }
+    }
+    mb->fn(st, data, blocks);
+    return blocks * 64 * mb->lanes;
+}
+
+static size_t run_sha256_mb()
+{
+    uint32_t st[8][SHA256_MB_MAX_LANES];
+    const size_t len = sha256_mb_run(st);
+    if (len > 0) {
+        sink += st[0][0];
+    }
+    return len;
+}
+
+static size_t run_sha512()
+{
+    uint64_t reg[8];
+    memcpy(reg, sha512_init_regs, sizeof(reg));
+    const size_t len = opts.size / 128 * 128;
+    CPU_SELECT(sha512_blocks_impls)->fn(reg, binary_buf, len / 128);
+    sink += reg[0];
+    return len;
+}
+
+static size_t run_base64_encode()
+{
+    sink += base64_encode_block(binary_buf, opts.size, (char *)out_buf);
+    return opts.size;
+}
+
+static size_t run_base64_decode()
+{
+    struct decode_state st = { 0 };
+    const uint8_t *bad;
+    sink += base64_decode_block(b64_map, &st, b64_buf, b64_len, out_buf, false, &bad);
+    return b64_len;
+}
+
+static size_t run_base32_encode()
+{
+    sink += base32_encode_block(binary_buf, opts.size, (char *)out_buf);
+    return opts.size;
+}
+
+static size_t run_base32_decode()
+{
+    struct decode_state st = { 0 };
+    const uint8_t *bad;
+    sink += base32_decode_block(b32_map, &st, b32_buf, b32_len, out_buf, false, &bad);
+    return b32_len;
+}
+
+static size_t run_wc()
+{
+    struct count t_counts = { .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+    struct count_state st;
+    count_init(&st, false, false);
+    count_buffer(text_buf, opts.size, &t_counts, &st);
+    sink += t_counts.words;
+    return opts.size;
+}
+
+static size_t run_wc_utf8()
+{
+    uint64_t chars;
+    sink += CPU_SELECT(count_utf8_impls)->fn(text_buf, opts.size, &chars) ? chars : 0;
+    return opts.size;
+}
+
+static const struct {
+    const char *name;
+    size_t (*run)();
+} kernels[] = {
+    { .name = "md5",           .run = run_md5 },
+    { .name = "md5-mb",        .run = run_md5_mb },
+    { .name = "sha256",        .run = run_sha256 },
+    { .name = "sha256-mb",     .run = run_sha256_mb },
+    { .name = "sha512",        .run = run_sha512 },
+    { .name = "base64-encode", .run = run_base64_encode },
+    { .name = "base64-decode", .run = run_base64_decode },
+    { .name = "base32-encode", .run = run_base32_encode },
+    { .name = "base32-decode", .run = run_base32_decode },
+    { .name = "wc",            .run = run_wc },
+    { .name = "wc-utf8",       .run = run_wc_utf8 },
+};
+
+static void show_help()
+{
+    printf("Usage: %s [OPTION]...\n\n\
+Options:\n\
+    -h, --help\t\t display this help\n\
+    -s, --size=SIZE\t buffer size, with optional K, M or G suffix\n\
+    -n, --iterations=N\t runs per kernel, the best is reported\n\
+    -k, --kernel=NAME\t run only kernel NAME\n\
+    -c, --cpu=N\t\t pin to CPU N\n\
+    -l, --list\t\t list the kernels\n", APP_NAME);
+}
+
+static void *xmalloc(const size_t size)
+{
+    void *p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", APP_NAME);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static uint64_t parse_size(const char *arg)
+{
+    char *end;
+    uint64_t n = strtoull(arg, &end, 10);
+    switch (*end) {
+        case 'G': n <<= 10; [[fallthrough]];
+        case 'M': n <<= 10; [[fallthrough]];
+        case 'K': n <<= 10; break;
+        case '\0': break;
+        default:
+            fprintf(stderr, "%s: bad size '%s'\n", APP_NAME, arg);
+            exit(EXIT_FAILURE);
+    }
+    if (n < 128) {
+        fprintf(stderr, "%s: size must be at least 128 bytes\n", APP_NAME);
+        exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+/* Build every input up front, so setup is never timed. */
+static void make_inputs()
+{
+    static constexpr char text_words[][6] = { "the", "of", "and", "a", "to", "in",
+                                              "is", "you", "that", "it", "word" };
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    binary_buf = xmalloc(opts.size);
+    text_buf = xmalloc(opts.size);
+    out_buf = xmalloc(opts.size * 2 + 16);
+
+    for (size_t i = 0; i < opts.size; i++) {
+        /* xorshift64*, as the corpus generator uses. */
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        binary_buf[i] = (uint8_t)((state * 0x2545f4914f6cdd1dULL) >> 56);
+    }
+
+    size_t col = 0;
+    for (size_t i = 0; i < opts.size;) {
+        if (col > 20 + (size_t)binary_buf[i] % 100) {
+            text_buf[i++] = '\n';
+            col = 0;
+            continue;
+        }
+        const char *w = text_words[binary_buf[i] % (sizeof(text_words) / sizeof(text_words[0]))];
+        for (; *w && i < opts.size; w++, col++) {
+            text_buf[i++] = *w;
+        }
+        if (i < opts.size) {
+            text_buf[i++] = ' ';
+            col++;
+        }
+    }
+
+    b64_buf = xmalloc(opts.size / 3 * 4 + 4);
+    b64_len = base64_encode_block(binary_buf, opts.size / 3 * 3, (char *)b64_buf);
+    b32_buf = xmalloc(opts.size / 5 * 8 + 8);
+    b32_len = base32_encode_block(binary_buf, opts.size / 5 * 5, (char *)b32_buf);
+
+    base64_init_decode_map(b64_map);
+    base32_init_decode_map(b32_map);
+}
+
+/* The multi-lane MD5 kernel must agree with process_chunk() in every lane. */
+static void check_md5()
+{
+    uint32_t st[4][MD5_MB_MAX_LANES];
+    const size_t len = md5_mb_run(st);
+    const typeof(md5_mb_impls[0]) *mb = CPU_SELECT(md5_mb_impls);
+    for (size_t l = 0; len > 0 && l < mb->lanes; l++) {
+        const size_t lane_len = len / mb->lanes;
+        uint32_t want[4];
+        memcpy(want, md5_init_regs, sizeof(want));
+        for (size_t i = 0; i < lane_len; i += 64) {
+            process_chunk(want, binary_buf + l * lane_len + i);
+        }
+        for (int j = 0; j < 4; j++) {
+            if (st[j][l] != want[j]) {
+                fprintf(stderr, "%s: md5 %s multi-lane kernel disagrees with scalar\n", APP_NAME, mb->isa);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+/* Every SHA-2 kernel this CPU can run must agree with the scalar one. */
+static void check_sha2()
+{
+    const size_t n_impls = sizeof(sha256_blocks_impls) / sizeof(sha256_blocks_impls[0]);
+    const size_t blocks = opts.size / 64;
+    uint32_t want[8];
+    memcpy(want, sha256_init_regs, sizeof(want));
+    sha256_blocks_scalar(want, binary_buf, blocks);
+
+    for (size_t i = 0; i < n_impls; i++) {
+        if ((sha256_blocks_impls[i].needs & cpu_features()) != sha256_blocks_impls[i].needs) {
+            continue;
+        }
+        uint32_t got[8];
+        memcpy(got, sha256_init_regs, sizeof(got));
+        sha256_blocks_impls[i].fn(got, binary_buf, blocks);
+        if (memcmp(got, want, sizeof(want)) != 0) {
+            fprintf(stderr, "%s: sha256 %s kernel disagrees with scalar\n",
+                    APP_NAME, sha256_blocks_impls[i].isa);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    uint32_t st[8][SHA256_MB_MAX_LANES];
+    const size_t len = sha256_mb_run(st);
+    const typeof(sha256_mb_impls[0]) *mb = sha256_mb_best();
+    for (size_t l = 0; len > 0 && l < mb->lanes; l++) {
+        const size_t lane_len = len / mb->lanes;
+        memcpy(want, sha256_init_regs, sizeof(want));
+        sha256_blocks_scalar(want, binary_buf + l * lane_len, lane_len / 64);
+        for (int j = 0; j < 8; j++) {
+            if (st[j][l] != want[j]) {
+                fprintf(stderr, "%s: sha256 %s multi-buffer kernel disagrees with scalar\n",
+                        APP_NAME, mb->isa);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    /* An odd chunk count also covers the vector kernels' scalar tail. */
+    const size_t blocks512 = (opts.size / 128 - 1) | 1;
+    uint64_t want512[8];
+    memcpy(want512, sha512_init_regs, sizeof(want512));
+    sha512_blocks_scalar(want512, binary_buf, blocks512);
+
+    for (size_t i = 0; i < sizeof(sha512_blocks_impls) / sizeof(sha512_blocks_impls[0]); i++) {
+        if ((sha512_blocks_impls[i].needs & cpu_features()) != sha512_blocks_impls[i].needs) {
+            continue;
+        }
+        uint64_t got[8];
+        memcpy(got, sha512_init_regs, sizeof(got));
+        sha512_blocks_impls[i].fn(got, binary_buf, blocks512);
+        if (memcmp(got, want512, sizeof(want512)) != 0) {
+            fprintf(stderr, "%s: sha512 %s kernel disagrees with scalar\n",
+                    APP_NAME, sha512_blocks_impls[i].isa);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/*
+ * UTF-8 with bad and cut-short characters at every offset around the
+ * vector blocks. Every UTF-8 kernel must agree with the scalar one on
+ * which of them are valid, and -m must count them as mbrtowc() does,
+ * in one buffer or split across two anywhere.
+ */
+static void check_wc_utf8()
+{
+    static const char *const cases[] = {
+        "h\xc3\xa9llo \xe2\x82\xac \xf0\x9f\x98\x80",
+        "\xff\xfe\xc3",                         /* Bad leads, then one cut short. */
+        "\xc3", "\xe2\x82", "\xf0\x9f\x98",     /* Cut short. */
+        "\xc3" "A", "\xe2\x82" "A",
+        "\x80\xbf",                             /* Stray continuation bytes. */
+        "\xc0\x80", "\xe0\x80\xaf",             /* Overlong. */
+        "\xed\xa0\x80",                         /* A surrogate. */
+        "\xf4\x90\x80\x80",                     /* Above U+10FFFF. */
+        "\xf8\x88\x80\x80\x80",                 /* Five bytes. */
+    };
+    const bool utf8_locale = setlocale(LC_CTYPE, "C.UTF-8") != nullptr
+                          || setlocale(LC_CTYPE, "en_US.UTF-8") != nullptr;
+    uint8_t buf[256];
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        for (size_t pre = 0; pre < 72; pre++) {
+            for (size_t post = 0; post <= 72; post += 72) {
+                const size_t clen = strlen(cases[c]);
+                const size_t len = pre + clen + post;
+                memset(buf, 'a', len);
+                memcpy(buf + pre, cases[c], clen);
+
+                uint64_t want = 0;
+                const bool valid = count_utf8_scalar(buf, len, &want);
+                for (size_t i = 0; i < sizeof(count_utf8_impls) / sizeof(count_utf8_impls[0]); i++) {
+                    if ((count_utf8_impls[i].needs & cpu_features()) != count_utf8_impls[i].needs) {
+                        continue;
+                    }
+                    uint64_t got = 0;
+                    const bool ok = count_utf8_impls[i].fn(buf, len, &got);
+                    if (ok != valid || (ok && got != want)) {
+                        fprintf(stderr, "%s: wc-utf8 %s kernel disagrees with scalar on case %zu\n",
+                                APP_NAME, count_utf8_impls[i].isa, c);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+
+                if (!utf8_locale || count_char_mode() != CHARS_UTF8) {
+                    continue;
+                }
+                mbstate_t mb = { 0 };
+                const uint64_t chars = count_mb_chars(buf, len, &mb);
+                for (size_t cut = 0; cut <= len; cut++) {
+                    struct count t = { .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+                    struct count_state st;
+                    count_init(&st, false, true);
+                    count_buffer(buf, cut, &t, &st);
+                    count_buffer(buf + cut, len - cut, &t, &st);
+                    if (t.chars != chars) {
+                        fprintf(stderr, "%s: wc -m counts %" PRIu64 " characters in case %zu, mbrtowc() %" PRIu64 "\n",
+                                APP_NAME, t.chars, c, chars);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+            }
+        }
+    }
+    setlocale(LC_CTYPE, "C");
+}
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void pin_cpu(const int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(stderr, "%s: unable to pin to CPU %d: %s\n", APP_NAME, cpu, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+#else
+    fprintf(stderr, "%s: CPU pinning is not supported on this platform\n", APP_NAME);
+    (void)cpu;
+#endif
+}
+
+int main(const int argc, char *argv[])
+{
+    const struct option long_opts[] = {
+        { .name = "help",       .has_arg = no_argument,       .flag = nullptr, .val = 'h' },
+        { .name = "size",       .has_arg = required_argument, .flag = nullptr, .val = 's' },
+        { .name = "iterations", .has_arg = required_argument, .flag = nullptr, .val = 'n' },
+        { .name = "kernel",     .has_arg = required_argument, .flag = nullptr, .val = 'k' },
+        { .name = "cpu",        .has_arg = required_argument, .flag = nullptr, .val = 'c' },
+        { .name = "list",       .has_arg = no_argument,       .flag = nullptr, .val = 'l' },
+        { .name = nullptr,      .has_arg = no_argument,       .flag = nullptr, .val = 0 }
+    };
+
+    const size_t n_kernels = sizeof(kernels) / sizeof(kernels[0]);
+    const int *min = &(int){0};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hs:n:k:c:l", long_opts, nullptr)) != -1) {
+        switch (opt) {
+            case 'h':
+                show_help();
+                return EXIT_SUCCESS;
+            case 's':
+                opts.size = parse_size(optarg);
+                break;
+            case 'n':
+                opts.iterations = (int)parse_numeric_arg(optarg, &(int){1}, nullptr, APP_NAME);
+                break;
+            case 'k':
+                opts.only = optarg;
+                break;
+            case 'c':
+                opts.cpu = (int)parse_numeric_arg(optarg, min, nullptr, APP_NAME);
+                break;
+            case 'l':
+                for (size_t i = 0; i < n_kernels; i++) {
+                    printf("%s\n", kernels[i].name);
+                }
+                return EXIT_SUCCESS;
+            default:
+                show_help();
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (opts.cpu >= 0) {
+        pin_cpu(opts.cpu);
+    }
+
+    make_inputs();
+    check_md5();
+    check_sha2();
+    check_wc_utf8();
+
+    char features[128];
+    cpu_feature_string(cpu_features(), features, sizeof(features));
+    printf("cpu features: %s\n\n", features);
+
+    printf("%-14s %10s %10s %10s\n", "kernel", "cycles/B", "ns/B", "MB/s");
+
+    bool found = false;
+    for (size_t i = 0; i < n_kernels; i++) {
+        if (opts.only && strcmp(opts.only, kernels[i].name) != 0) {
+            continue;
+        }
+        found = true;
+
+        /* One untimed run to fault in the pages and warm the caches.
+         * A kernel this CPU has no code for hashes nothing. */
+        if (kernels[i].run() == 0) {
+            printf("%-14s %10s %10s %10s\n", kernels[i].name, "n/a", "n/a", "n/a");
+            continue;
+        }
+
+        uint64_t best_ns = UINT64_MAX;
+        uint64_t best_cycles = UINT64_MAX;
+        size_t bytes = 0;
+        for (int n = 0; n < opts.iterations; n++) {
+            const uint64_t start = now_ns();
+#ifdef HAVE_TSC
+            const uint64_t start_tsc = __rdtsc();
+#endif
+            bytes = kernels[i].run();
+#ifdef HAVE_TSC
+            const uint64_t cycles = __rdtsc() - start_tsc;
+            if (cycles < best_cycles) {
+                best_cycles = cycles;
+            }
+#endif
+            const uint64_t elapsed = now_ns() - start;
+            if (elapsed < best_ns) {
+                best_ns = elapsed;
+            }
+        }
+
+        char cpb[16] = "-";
+        if (best_cycles != UINT64_MAX) {
+            snprintf(cpb, sizeof(cpb), "%.3f", (double)best_cycles / (double)bytes);
+        }
+        printf("%-14s %10s %10.3f %10.1f\n", kernels[i].name, cpb,
+               (double)best_ns / (double)bytes,
+               best_ns ? (double)bytes * 1e3 / (double)best_ns : 0.0);
+    }
+
+    if (!found) {
+        fprintf(stderr, "%s: no kernel named '%s', try -l\n", APP_NAME, opts.only);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
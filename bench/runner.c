@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   runner.c - time repeated runs of a command                            *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Usage: runner REPS COMMAND [ARGUMENT]...
+ *
+ * Runs COMMAND REPS times with stdin and stdout on /dev/null, and prints
+ *
+ *   <min seconds> <median seconds> <peak RSS KiB> <exit status>
+ *
+ * The peak RSS is the largest ru_maxrss of any run. The exit status is
+ * that of the first failing run, or 0. A run killed by a signal reports
+ * 128 plus the signal number, as the shell does.
+ */
+
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../src/common.h"
+
+
+static const char *APP_NAME = "runner";
+
+static int compare_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s REPS COMMAND [ARGUMENT]...\n", APP_NAME);
+        return EXIT_FAILURE;
+    }
+
+    const int *min = &(int){1};
+    const int reps = (int)parse_numeric_arg(argv[1], min, nullptr, APP_NAME);
+
+    double *times = malloc(sizeof(double) * reps);
+    if (!times) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", APP_NAME);
+        return EXIT_FAILURE;
+    }
+
+    long max_rss = 0;
+    int status = 0;
+
+    for (int i = 0; i < reps; i++) {
+        const double start = now();
+        const pid_t pid = fork();
+
+        if (pid < 0) {
+            fprintf(stderr, "%s: fork failed: %s\n", APP_NAME, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        if (pid == 0) {
+            const int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+            }
+            execvp(argv[2], argv + 2);
+            _exit(127);
+        }
+
+        int w_status;
+        struct rusage ru;
+        if (wait4(pid, &w_status, 0, &ru) < 0) {
+            fprintf(stderr, "%s: wait4 failed: %s\n", APP_NAME, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        times[i] = now() - start;
+
+        /* ru_maxrss is in bytes on macOS, KiB elsewhere. */
+#if defined(__APPLE__) && defined(__MACH__)
+        ru.ru_maxrss /= 1024;
+#endif
+        if (ru.ru_maxrss > max_rss) {
+            max_rss = ru.ru_maxrss;
+        }
+
+        if (status == 0) {
+            if (WIFEXITED(w_status)) {
+                status = WEXITSTATUS(w_status);
+            } else if (WIFSIGNALED(w_status)) {
+                status = 128 + WTERMSIG(w_status);
+            }
+        }
+    }
+
+    qsort(times, reps, sizeof(double), compare_double);
+    const double median = reps % 2 ? times[reps / 2]
+                                   : (times[reps / 2 - 1] + times[reps / 2]) / 2.0;
+
+    printf("%.6f %.6f %ld %d\n", times[0], median, max_rss, status);
+    free(times);
+    return EXIT_SUCCESS;
+}
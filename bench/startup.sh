@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+# startup.sh - compare exec latency of the per-tool binaries
+#              against the multicall `ull` binary.
+#
+# Usage: bench/startup.sh BIN_DIR LINK_DIR [ITERATIONS]
+#
+# BIN_DIR holds the per-tool binaries built by `make`, LINK_DIR holds
+# the symlinks to `ull` created by `make ull-links`. Each applet is run
+# ITERATIONS times with trivial input, and the mean wall time per exec
+# is reported in microseconds.
+
+BIN_DIR="${1:-bin}"
+LINK_DIR="${2:-bin/ull.d}"
+ITERATIONS="${3:-2000}"
+
+# Applets and arguments chosen so that the run is dominated by
+# process startup rather than by any actual work.
+TESTS=(
+    "true"
+    "false"
+    "basename /usr/local/bin/tool"
+    "dirname /usr/local/bin/tool"
+    "cat /dev/null"
+    "wc /dev/null"
+    "head -n 1 /dev/null"
+    "md5sum /dev/null"
+)
+
+# Wall time in nanoseconds.
+now_ns() {
+    date +%s%N
+}
+
+# Mean microseconds per exec of "$@" over ITERATIONS runs.
+time_exec() {
+    local start end
+    start=$(now_ns)
+    for ((i = 0; i < ITERATIONS; i++)); do
+        "$@" > /dev/null 2>&1
+    done
+    end=$(now_ns)
+    echo $(( (end - start) / ITERATIONS / 1000 ))
+}
+
+if [[ ! -x "${LINK_DIR}/true" ]]; then
+    echo "startup.sh: no applet links in ${LINK_DIR}, run 'make ull-links' first" >&2
+    exit 1
+fi
+
+printf "%-32s %12s %12s %8s\n" "command" "per-tool us" "ull us" "ratio"
+for t in "${TESTS[@]}"; do
+    read -r -a cmd <<< "${t}"
+    tool="${cmd[0]}"
+    args=("${cmd[@]:1}")
+
+    [[ -x "${BIN_DIR}/${tool}" ]] || continue
+
+    single=$(time_exec "${BIN_DIR}/${tool}" "${args[@]}")
+    multi=$(time_exec "${LINK_DIR}/${tool}" "${args[@]}")
+    ratio=$(awk -v a="${multi}" -v b="${single}" 'BEGIN { printf "%.2f", (b > 0) ? a / b : 0 }')
+
+    printf "%-32s %12s %12s %8s\n" "${t}" "${single}" "${multi}" "${ratio}"
+done
+
+total=0
+for f in "${BIN_DIR}"/*; do
+    if [[ -f "${f}" && "${f##*/}" != "ull" ]]; then
+        total=$(( total + $(wc -c < "${f}") ))
+    fi
+done
+
+printf "\nbinary sizes (bytes):\n"
+printf "  per-tool total: %s\n" "${total}"
+printf "  ull:            %s\n" "$(wc -c < "${BIN_DIR}/ull")"
@@ -42,6 +42,7 @@ int main(const int argc, char *argv[])
     const struct option long_opts[] = {
         {.name = "help",    .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -57,6 +58,9 @@ int main(const int argc, char *argv[])
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -25,6 +25,11 @@
 #include <stdlib.h>
 
 #include "common.h"
+#include "basenc.h"
+#include "io.h"
+
+/* Encoder input block size, a multiple of the 5-byte group. */
+#define BUF_SIZE (5 * 16384)
 
 
 static const char *APP_NAME = "base32";
@@ -40,31 +45,7 @@ static struct {
 
 static int8_t decode_map[256];
 
-static void init_decode_map()
-{
-    /* Set everything to -1 (garbage/invalid) by default. */
-    for (int i = 0; i < 256; i++) {
-        decode_map[i] = -1;
-    }
-
-    /* Map A-Z and a-z to 0-25. */
-    for (int i = 0; i < 26; i++) {
-        decode_map['A' + i] = i;
-        decode_map['a' + i] = i;
-    }
-
-    /* Map 2-7 to 26-31. */
-    for (int i = 0; i < 6; i++) {
-        decode_map['2' + i] = i + 26;
-    }
-
-    /*  Map special characters. */
-    decode_map['='] = -3;
-    decode_map['\n'] = -2;
-    decode_map['\r'] = -2;
-}
-
-static constexpr char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+static struct io_writer out;
 
 static void show_help()
 {
@@ -91,77 +72,40 @@ static FILE* open_infile(char *file)
 
 static void decode(char *name)
 {
-    FILE *fp;
-    if (*name == 0x2D) {
-        fp = stdin;
-    } else {
-        fp = open_infile(name);
+    struct io_reader in;
+    if (!io_open(&in, name, APP_NAME)) {
+        fprintf(stderr, "%s: unable to open %s: %s", APP_NAME, name, strerror(errno));
+        exit(EXIT_FAILURE);
     }
 
-    int ch;
-    uint8_t chars_read = 0;
-    uint8_t pad_chars = 0;
-    uint64_t val = 0;
+    uint8_t *out_buf = malloc(BASE32_DECODED_MAX(IO_BUF_SIZE));
+    if (!out_buf) {
+        fprintf(stderr, "%s: malloc failed!\n", APP_NAME);
+        exit(EXIT_FAILURE);
+    }
 
-    while ((ch = fgetc(fp)) != EOF) {
-        const int8_t decoded = decode_map[ch];
+    struct decode_state st = { 0 };
+    const uint8_t *in_buf;
+    size_t read;
 
-        /* Newlines are always ignored. */
-        if (decoded == -2) {
-            continue;
-        }
+    while ((read = io_read(&in, &in_buf)) > 0) {
+        const uint8_t *bad;
+        const size_t n = base32_decode_block(decode_map, &st, in_buf, read, out_buf, opts.ignore, &bad);
+        io_write(&out, out_buf, n);
 
-        /* Handle garbage. */
-        if (decoded == -1) {
-            if (opts.ignore) {
-                continue;
-            }
-            fprintf(stderr, "%s: Invalid Base32 character: '%c'\n", APP_NAME, ch);
+        if (bad) {
+            io_flush(&out);
+            fprintf(stderr, "%s: Invalid Base32 character: '%c'\n", APP_NAME, *bad);
             exit(EXIT_FAILURE);
         }
-
-        /* Handle valid chars and Padding. */
-        if (decoded == -3) {
-            pad_chars++;
-            val = val << 5; /* Shift in 5 zero-bits to keep alignment. */
-        } else {
-            val = (val << 5) | (uint8_t)decoded;
-        }
-
-        chars_read++;
-
-        /* Process the assembled 40-bit chunk. */
-        if (chars_read == 8) {
-            uint8_t out_bytes[5];
-            out_bytes[0] = (val >> 32) & 0xFF;
-            out_bytes[1] = (val >> 24) & 0xFF;
-            out_bytes[2] = (val >> 16) & 0xFF;
-            out_bytes[3] = (val >> 8)  & 0xFF;
-            out_bytes[4] =  val        & 0xFF;
-
-            /* Determine how many bytes to actually write based on padding count. */
-            size_t bytes_to_write = 5;
-            if (pad_chars == 6) bytes_to_write = 1;
-            else if (pad_chars == 4) bytes_to_write = 2;
-            else if (pad_chars == 3) bytes_to_write = 3;
-            else if (pad_chars == 1) bytes_to_write = 4;
-
-            fwrite(out_bytes, 1, bytes_to_write, stdout);
-
-            /* Reset state for the next iteration. */
-            chars_read = 0;
-            pad_chars = 0;
-            val = 0;
-        }
     }
 
-    if (chars_read > 0) {
+    if (st.chars_read > 0) {
         fprintf(stderr, "%s: warning: truncated message encountered!\n", APP_NAME);
     }
 
-    if (fp != stdin) {
-        fclose(fp);
-    }
+    io_close(&in);
+    free(out_buf);
 }
 
 static void encode(char *name)
@@ -173,88 +117,51 @@ static void encode(char *name)
         fp = open_infile(name);
     }
 
-    char *out_buf = malloc(opts.wrap + 8);
-    if (!out_buf) {
+    uint8_t *in_buf = malloc(BUF_SIZE);
+    char *out_buf = malloc(BUF_SIZE / 5 * 8);
+    if (!in_buf || !out_buf) {
         fprintf(stderr, "%s: malloc failed!\n", APP_NAME);
         exit(EXIT_FAILURE);
     }
 
-    uint8_t out_idx = 0;
-    uint8_t in_buf[5];
+    size_t col = 0;
+    size_t read;
 
-    /* Read in 5-byte chunks, and parse them into eight
-     * 5-bit integers. Then use the integers as indices
-     * into the digit array to build the output string. */
-    while (true) {
-        const size_t read = fread(in_buf, 1, 5, fp);
+    /* BUF_SIZE is a multiple of 5, so only the final
+     * read can end in a partial group that needs padding. */
+    while ((read = fread(in_buf, 1, BUF_SIZE, fp)) > 0) {
+        const size_t out_len = base32_encode_block(in_buf, read, out_buf);
 
-        if (read == 0) {
-            break;
-        }
-
-        if (read < 5) {
-            for (int i = read; i < 5; i++) {
-                in_buf[i] = 0;
-            }
+        /* Do not print newlines. */
+        if (opts.wrap == 0) {
+            io_write(&out, out_buf, out_len);
+            continue;
         }
 
-        /* Pack the 5-bytes read into a single integer. */
-        const uint64_t val = ((uint64_t)in_buf[0] << 32) |
-                             ((uint64_t)in_buf[1] << 24) |
-                             ((uint64_t)in_buf[2] << 16) |
-                             ((uint64_t)in_buf[3] << 8)  |
-                              (uint64_t)in_buf[4];
-
-        /* Split into eight 5-bit integers. */
-        out_buf[out_idx++] = digits[(val >> 35) & 0x1F];
-        out_buf[out_idx++] = digits[(val >> 30) & 0x1F];
-        out_buf[out_idx++] = digits[(val >> 25) & 0x1F];
-        out_buf[out_idx++] = digits[(val >> 20) & 0x1F];
-        out_buf[out_idx++] = digits[(val >> 15) & 0x1F];
-        out_buf[out_idx++] = digits[(val >> 10) & 0x1F];
-        out_buf[out_idx++] = digits[(val >>  5) & 0x1F];
-        out_buf[out_idx++] = digits[val         & 0x1F];
-
-        /* For short reads, determine the amount
-         * of '=' padding, then backtrack and
-         * overwrite the trailing 'A's. */
-        if (read < 5) {
-            uint8_t pad_chars = 0;
-            if (read == 1) pad_chars = 6;
-            else if (read == 2) pad_chars = 4;
-            else if (read == 3) pad_chars = 3;
-            else if (read == 4) pad_chars = 1;
-
-            for (int i = 0; i < pad_chars; i++) {
-                out_buf[out_idx - 1 - i] = '=';
+        /* Print lines of exactly opts.wrap chars. The newline
+         * ending a full line is held back until more output
+         * follows, as the last line always gets one below. */
+        size_t out_idx = 0;
+        while (out_idx < out_len) {
+            if (col == opts.wrap) {
+                io_putc(&out, '\n');
+                col = 0;
             }
-        }
-
-        /* Do not print newlines. */
-        if (opts.wrap == 0) {
-            printf("%.*s", out_idx, out_buf);
-            out_idx = 0;
-        } else {
-            /* Print exactly opts.wrap chars and a newline.
-             * If there are extra chars from the previous
-             * read then we copy them to the start of the
-             * buffer, pad with '\0' and iterate again. */
-            while (out_idx > opts.wrap) {
-                const uint8_t ext = out_idx - opts.wrap;
-                printf("%.*s\n", opts.wrap, out_buf);
-                if (ext > 0) {
-                    memmove(out_buf, out_buf + opts.wrap, ext);
-                    memset(out_buf + ext, 0, opts.wrap + 8 - ext);
-                }
-                out_idx = ext;
+            size_t n = opts.wrap - col;
+            if (n > out_len - out_idx) {
+                n = out_len - out_idx;
             }
+            io_write(&out, out_buf + out_idx, n);
+            out_idx += n;
+            col += n;
         }
     }
-    printf("%.*s\n", out_idx, out_buf);
+    io_putc(&out, '\n');
 
     if (fp != stdin) {
         fclose(fp);
     }
+    free(in_buf);
     free(out_buf);
 }
 
@@ -266,6 +173,7 @@ int main(const int argc, char *argv[])
         { .name = "decode",         .has_arg = no_argument,       .flag = nullptr, .val = 'd' },
         { .name = "ignore-garbage", .has_arg = no_argument,       .flag = nullptr, .val = 'i' },
         { .name = "wrap",           .has_arg = required_argument, .flag = nullptr, .val = 'w' },
+        STATS_LONG_OPT,
         { .name = nullptr,          .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -294,30 +202,37 @@ int main(const int argc, char *argv[])
             case 'w':
                 opts.wrap = parse_numeric_arg(optarg, min, max, APP_NAME);
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
         }
     }
 
+    io_writer_fd(&out, STDOUT_FILENO, false, APP_NAME);
+
     if (argc == optind || strcmp(argv[optind], "-") == 0) {  /* no file arguments */
         if (opts.decode) {
-            init_decode_map();
+            base32_init_decode_map(decode_map);
             decode("-");
         } else {
             encode("-");
         }
+        io_writer_close(&out);
         return EXIT_SUCCESS;
     }
 
     while (optind < argc) {
         if (opts.decode) {
-            init_decode_map();
+            base32_init_decode_map(decode_map);
             decode(argv[optind++]);
         } else {
             encode(argv[optind++]);
         }
     }
+    io_writer_close(&out);
 
     return EXIT_SUCCESS;
 }
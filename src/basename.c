@@ -53,6 +53,7 @@ int main(const int argc, char *argv[]) {
         {"suffix", required_argument, nullptr, 's'},
         {"help", 0, nullptr, 'h'},
         {"version", 0, nullptr, 'V'},
+        STATS_LONG_OPT,
         {nullptr,0,nullptr,0}
     };
 
@@ -72,6 +73,9 @@ int main(const int argc, char *argv[]) {
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
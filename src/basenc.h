@@ -0,0 +1,309 @@
+/***************************************************************************
+ *   basenc.h - encoding and decoding kernels for base32 and base64        *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef BASENC_H
+#define BASENC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+static constexpr char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char base32_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+/* Decode map entries that are not digits. */
+#define DECODE_GARBAGE (-1)
+#define DECODE_NEWLINE (-2)
+#define DECODE_PAD     (-3)
+
+/* Largest output of decoding n input chars. */
+#define BASE64_DECODED_MAX(n) (((n) / 4 + 1) * 3)
+#define BASE32_DECODED_MAX(n) (((n) / 8 + 1) * 5)
+
+/* Decoder state carried between calls, so
+ * input can be fed in arbitrary pieces. */
+struct decode_state {
+    uint64_t val;
+    uint8_t chars_read;
+    uint8_t pad_chars;
+};
+
+static inline void base64_init_decode_map(int8_t decode_map[256])
+{
+    /* Set everything to -1 (garbage/invalid) by default. */
+    for (int i = 0; i < 256; i++) {
+        decode_map[i] = DECODE_GARBAGE;
+    }
+
+    /* Map A-Z to 0-25. */
+    for (int i = 0; i < 26; i++) {
+        decode_map['A' + i] = i;
+    }
+
+    /* Map a-z to 26-51. */
+    for (int i = 0; i < 26; i++) {
+        decode_map['a' + i] = i + 26;
+    }
+
+    /* Map 0-9 to 52-61. */
+    for (int i = 0; i < 10; i++) {
+        decode_map['0' + i] = i + 52;
+    }
+
+    /* Map '+' and '/' to 62 and 63. */
+    decode_map['+'] = 62;
+    decode_map['/'] = 63;
+
+    /*  Map special characters. */
+    decode_map['=']  = DECODE_PAD;
+    decode_map['\n'] = DECODE_NEWLINE;
+    decode_map['\r'] = DECODE_NEWLINE;
+}
+
+static inline void base32_init_decode_map(int8_t decode_map[256])
+{
+    /* Set everything to -1 (garbage/invalid) by default. */
+    for (int i = 0; i < 256; i++) {
+        decode_map[i] = DECODE_GARBAGE;
+    }
+
+    /* Map A-Z and a-z to 0-25. */
+    for (int i = 0; i < 26; i++) {
+        decode_map['A' + i] = i;
+        decode_map['a' + i] = i;
+    }
+
+    /* Map 2-7 to 26-31. */
+    for (int i = 0; i < 6; i++) {
+        decode_map['2' + i] = i + 26;
+    }
+
+    /*  Map special characters. */
+    decode_map['=']  = DECODE_PAD;
+    decode_map['\n'] = DECODE_NEWLINE;
+    decode_map['\r'] = DECODE_NEWLINE;
+}
+
+/* Encode len bytes of in to out, and return the number of chars written.
+ * Every 3 input bytes become 4 chars. If len is not a multiple of 3 the
+ * last group is padded with '=', so only the final call on a stream may
+ * pass such a length. */
+static inline size_t base64_encode_block(const uint8_t *in, const size_t len, char *out)
+{
+    size_t out_idx = 0;
+    size_t i = 0;
+
+    for (; i + 3 <= len; i += 3) {
+        /* Pack the 3-bytes read into a single integer. */
+        const uint32_t val = ((uint32_t)in[i] << 16) |
+                             ((uint32_t)in[i + 1] <<  8) |
+                              (uint32_t)in[i + 2];
+
+        /* Split into four 6-bit integers. */
+        out[out_idx++] = base64_digits[(val >> 18) & 0x3F];
+        out[out_idx++] = base64_digits[(val >> 12) & 0x3F];
+        out[out_idx++] = base64_digits[(val >>  6) & 0x3F];
+        out[out_idx++] = base64_digits[val         & 0x3F];
+    }
+
+    /* For a short final group, encode with zero bytes,
+     * then backtrack and overwrite the trailing 'A's. */
+    const size_t rest = len - i;
+    if (rest > 0) {
+        const uint32_t val = ((uint32_t)in[i] << 16) |
+                             ((rest > 1 ? (uint32_t)in[i + 1] : 0) << 8);
+
+        out[out_idx++] = base64_digits[(val >> 18) & 0x3F];
+        out[out_idx++] = base64_digits[(val >> 12) & 0x3F];
+        out[out_idx++] = rest == 2 ? base64_digits[(val >> 6) & 0x3F] : '=';
+        out[out_idx++] = '=';
+    }
+    return out_idx;
+}
+
+/* As base64_encode_block(), but every 5 input bytes become 8 chars. */
+static inline size_t base32_encode_block(const uint8_t *in, const size_t len, char *out)
+{
+    size_t out_idx = 0;
+
+    for (size_t i = 0; i < len; i += 5) {
+        const size_t read = len - i < 5 ? len - i : 5;
+        uint8_t group[5] = { 0 };
+        for (size_t j = 0; j < read; j++) {
+            group[j] = in[i + j];
+        }
+
+        /* Pack the 5-bytes read into a single integer. */
+        const uint64_t val = ((uint64_t)group[0] << 32) |
+                             ((uint64_t)group[1] << 24) |
+                             ((uint64_t)group[2] << 16) |
+                             ((uint64_t)group[3] << 8)  |
+                              (uint64_t)group[4];
+
+        /* Split into eight 5-bit integers. */
+        out[out_idx++] = base32_digits[(val >> 35) & 0x1F];
+        out[out_idx++] = base32_digits[(val >> 30) & 0x1F];
+        out[out_idx++] = base32_digits[(val >> 25) & 0x1F];
+        out[out_idx++] = base32_digits[(val >> 20) & 0x1F];
+        out[out_idx++] = base32_digits[(val >> 15) & 0x1F];
+        out[out_idx++] = base32_digits[(val >> 10) & 0x1F];
+        out[out_idx++] = base32_digits[(val >>  5) & 0x1F];
+        out[out_idx++] = base32_digits[val         & 0x1F];
+
+        /* For short reads, determine the amount of '=' padding,
+         * then backtrack and overwrite the trailing 'A's. */
+        if (read < 5) {
+            uint8_t pad_chars = 0;
+            if (read == 1) pad_chars = 6;
+            else if (read == 2) pad_chars = 4;
+            else if (read == 3) pad_chars = 3;
+            else if (read == 4) pad_chars = 1;
+
+            for (int p = 0; p < pad_chars; p++) {
+                out[out_idx - 1 - p] = '=';
+            }
+        }
+    }
+    return out_idx;
+}
+
+/* Decode len chars of in to out, which must hold BASE64_DECODED_MAX(len)
+ * bytes, and return the number of bytes written. Newlines are skipped,
+ * and so is garbage if 'ignore' is set. Otherwise decoding stops at the
+ * first invalid char, and *bad is pointed at it; it is nullptr if the
+ * whole block was consumed. */
+static inline size_t base64_decode_block(const int8_t decode_map[256], struct decode_state *st,
+                                         const uint8_t *in, const size_t len, uint8_t *out,
+                                         const bool ignore, const uint8_t **bad)
+{
+    size_t out_idx = 0;
+    *bad = nullptr;
+
+    for (size_t i = 0; i < len; i++) {
+        const int8_t decoded = decode_map[in[i]];
+
+        /* Newlines are always ignored. */
+        if (decoded == DECODE_NEWLINE) {
+            continue;
+        }
+
+        /* Handle garbage. */
+        if (decoded == DECODE_GARBAGE) {
+            if (ignore) {
+                continue;
+            }
+            *bad = in + i;
+            return out_idx;
+        }
+
+        /* Handle valid chars and Padding. */
+        if (decoded == DECODE_PAD) {
+            st->pad_chars++;
+            st->val = st->val << 6; /* Shift in 6 zero-bits to keep alignment. */
+        } else {
+            st->val = (st->val << 6) | (uint8_t)decoded;
+        }
+
+        st->chars_read++;
+
+        /* Process the assembled 24-bit chunk. */
+        if (st->chars_read == 4) {
+            out[out_idx]     = (st->val >> 16) & 0xFF;
+            out[out_idx + 1] = (st->val >> 8)  & 0xFF;
+            out[out_idx + 2] =  st->val        & 0xFF;
+
+            /* Determine how many bytes to actually keep based on padding count. */
+            size_t bytes_to_write = 3;
+            if (st->pad_chars == 1) bytes_to_write = 2;
+            else if (st->pad_chars == 2) bytes_to_write = 1;
+            out_idx += bytes_to_write;
+
+            /* Reset state for the next iteration. */
+            st->chars_read = 0;
+            st->pad_chars = 0;
+            st->val = 0;
+        }
+    }
+    return out_idx;
+}
+
+/* As base64_decode_block(), for groups of 8 chars making 5 bytes.
+ * out must hold BASE32_DECODED_MAX(len) bytes. */
+static inline size_t base32_decode_block(const int8_t decode_map[256], struct decode_state *st,
+                                         const uint8_t *in, const size_t len, uint8_t *out,
+                                         const bool ignore, const uint8_t **bad)
+{
+    size_t out_idx = 0;
+    *bad = nullptr;
+
+    for (size_t i = 0; i < len; i++) {
+        const int8_t decoded = decode_map[in[i]];
+
+        /* Newlines are always ignored. */
+        if (decoded == DECODE_NEWLINE) {
+            continue;
+        }
+
+        /* Handle garbage. */
+        if (decoded == DECODE_GARBAGE) {
+            if (ignore) {
+                continue;
+            }
+            *bad = in + i;
+            return out_idx;
+        }
+
+        /* Handle valid chars and Padding. */
+        if (decoded == DECODE_PAD) {
+            st->pad_chars++;
+            st->val = st->val << 5; /* Shift in 5 zero-bits to keep alignment. */
+        } else {
+            st->val = (st->val << 5) | (uint8_t)decoded;
+        }
+
+        st->chars_read++;
+
+        /* Process the assembled 40-bit chunk. */
+        if (st->chars_read == 8) {
+            out[out_idx]     = (st->val >> 32) & 0xFF;
+            out[out_idx + 1] = (st->val >> 24) & 0xFF;
+            out[out_idx + 2] = (st->val >> 16) & 0xFF;
+            out[out_idx + 3] = (st->val >> 8)  & 0xFF;
+            out[out_idx + 4] =  st->val        & 0xFF;
+
+            /* Determine how many bytes to actually keep based on padding count. */
+            size_t bytes_to_write = 5;
+            if (st->pad_chars == 6) bytes_to_write = 1;
+            else if (st->pad_chars == 4) bytes_to_write = 2;
+            else if (st->pad_chars == 3) bytes_to_write = 3;
+            else if (st->pad_chars == 1) bytes_to_write = 4;
+            out_idx += bytes_to_write;
+
+            /* Reset state for the next iteration. */
+            st->chars_read = 0;
+            st->pad_chars = 0;
+            st->val = 0;
+        }
+    }
+    return out_idx;
+}
+
+#endif /* BASENC_H */
@@ -201,6 +201,7 @@ int main(const int argc, char *argv[]) {
         {.name = "context", .has_arg = 0, .flag = nullptr, .val = '3'},
         {.name = "help",    .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -218,6 +219,9 @@ int main(const int argc, char *argv[]) {
             case '3':
                 context = 1;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -237,27 +241,27 @@ int main(const int argc, char *argv[]) {
         print_mon = 1;
     } else if (args == 1) {
         /* one arg: take a year */
-        year = (int)strtol(argv[1], nullptr, 10);
+        year = (int)strtol(argv[optind], nullptr, 10);
         /* month is arbitrary - value not needed */
         month = 1;
         if (year < 1000 || year > 9999) {
             fprintf(stderr, "%s: bad argument: %s%s%s. Year must be 4-digit integer.\n",
-                APP_NAME, ANSI_RED_B, argv[1], ANSI_RESET);
+                APP_NAME, ANSI_RED_B, argv[optind], ANSI_RESET);
             return EXIT_FAILURE;
         }
         print_mon = 0;
     } else if (args == 2) {
         /* two args: take a month and a year */
-        month = (int)strtol(argv[1], nullptr, 10);
-        year = (int)strtol(argv[2], nullptr, 10);
+        month = (int)strtol(argv[optind], nullptr, 10);
+        year = (int)strtol(argv[optind + 1], nullptr, 10);
         if (year < 1000 || year > 9999) {
             fprintf(stderr, "%s: bad argument: %s%s%s. Year must be 4-digit integer.\n",
-                APP_NAME, ANSI_RED_B, argv[1], ANSI_RESET);
+                APP_NAME, ANSI_RED_B, argv[optind], ANSI_RESET);
             return EXIT_FAILURE;
         }
         if (month < 1 || month > 12) {
             fprintf(stderr, "%s: bad argument: %s%s%s. Month must be 1-12 inclusive.\n)",
-                APP_NAME, ANSI_RED_B, argv[1], ANSI_RESET);
+                APP_NAME, ANSI_RED_B, argv[optind], ANSI_RESET);
             return EXIT_FAILURE;
         }
         print_mon = 1;
@@ -20,10 +20,16 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sys/sendfile.h>
+#endif
 #include <getopt.h>
+#include <pthread.h>
 #include <stdint.h>
 
 #include "common.h"
+#include "io.h"
 
 
 static const char *APP_NAME = "cat";
@@ -42,50 +48,261 @@ Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 /* flag which tells whether we are numbering lines */
 static bool number_lines = false;
 
-static void cat_stdin(const int unbuffered) {
-    int c;
-    int line_number = 1;
+static struct io_writer out;
 
-    if (unbuffered) {
-        setvbuf(stdout, nullptr, _IONBF, 1);
+/* Type of the standard output, which picks the kernel copy to try first. */
+static mode_t out_type;
+
+/* Largest request for one kernel copy call. */
+#define COPY_CHUNK (1L << 30)
+
+enum copy_method {
+    COPY_RANGE,      /* copy_file_range(): file to file, reflinked where the fs can */
+    COPY_SPLICE,     /* splice(): anything into a pipe */
+    COPY_SENDFILE,   /* sendfile(): file to anything else */
+    COPY_NONE
+};
+
+/*
+ * Copy in_fd to the standard output without passing the data through
+ * user space. Methods are tried cheapest first; one that is refused moves
+ * on to the next, and the file offset carries over, so a partial copy is
+ * fine. Returns true once in_fd is at end of file, or false to have the
+ * caller finish with read() and write(), which also report any real error.
+ */
+static bool copy_kernel(const int in_fd) {
+#if defined(__linux__)
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) {
+        return false;
+    }
+    /* procfs and sysfs files claim a size of 0; read them normally. */
+    if (S_ISREG(st.st_mode) && st.st_size == 0) {
+        return false;
     }
 
-    while (( c = getc(stdin)) != EOF ) {
-        if  (c == 10 && number_lines == 1) {
-            putc(c, stdout);
-            printf("%6u\t", line_number++);
-        } else {
-            putc(c, stdout);
+    enum copy_method method;
+    if (S_ISFIFO(out_type)) {
+        method = COPY_SPLICE;
+    } else if (S_ISREG(out_type) && S_ISREG(st.st_mode)) {
+        method = COPY_RANGE;
+    } else {
+        method = COPY_SENDFILE;
+    }
+
+    io_flush(&out);
+    while (method != COPY_NONE) {
+        ssize_t n;
+        switch (method) {
+            case COPY_RANGE:
+                n = copy_file_range(in_fd, nullptr, STDOUT_FILENO, nullptr, COPY_CHUNK, 0);
+                break;
+            case COPY_SPLICE:
+                n = splice(in_fd, nullptr, STDOUT_FILENO, nullptr, COPY_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+                break;
+            default:
+                n = sendfile(STDOUT_FILENO, in_fd, nullptr, COPY_CHUNK);
+                break;
         }
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* Across filesystems, or on old kernels, sendfile() still works. */
+            method = method == COPY_RANGE ? COPY_SENDFILE : COPY_NONE;
+            continue;
+        }
+        io_counters.reads++;
+        io_counters.writes++;
+        io_counters.bytes_read += n;
+        io_counters.bytes_written += n;
     }
-    printf("\n");
-    exit(EXIT_SUCCESS);
+#else
+    (void)in_fd;
+#endif
+    return false;
 }
 
-static void cat_file(char *filename, uint32_t *line_number) {
-    FILE *fd;
+/*
+ * The current line number as it is printed: right-aligned in six
+ * columns and followed by a tab. It is kept and counted as decimal text,
+ * so numbering a line is a copy and usually a single byte increment
+ * rather than a division per digit, and it never wraps.
+ */
+static struct {
+    char text[IO_NUM_MAX + 1];
+    size_t start;          /* First digit in text. */
+    bool mid_line;         /* The last block ended without a newline. */
+} line_no;
+
+#define LINE_NO_TAB (sizeof(line_no.text) - 1)
+#define LINE_NO_WIDTH 6
 
-    if ((fd = fopen(filename, "r")) == NULL ) {
-        fprintf(stderr, "cannot open file %s: %s\n", filename, strerror(errno));
-        exit(EXIT_FAILURE);
+static void line_no_init(void) {
+    memset(line_no.text, ' ', LINE_NO_TAB);
+    line_no.text[LINE_NO_TAB] = '\t';
+    line_no.start = LINE_NO_TAB - 1;
+    line_no.text[line_no.start] = '1';
+}
+
+static void line_no_next(void) {
+    size_t i = LINE_NO_TAB - 1;
+    while (i >= line_no.start && line_no.text[i] == '9') {
+        line_no.text[i--] = '0';
+    }
+    if (i < line_no.start) {
+        line_no.start = i;
+        line_no.text[i] = '1';
+    } else {
+        line_no.text[i]++;
+    }
+}
+
+/* Copy a block to the output, numbering each line that starts in it.
+ * Lines may run across blocks and files. */
+static void number_block(const uint8_t *p, const uint8_t *end) {
+    while (p < end) {
+        if (!line_no.mid_line) {
+            size_t from = LINE_NO_TAB - LINE_NO_WIDTH;
+            if (line_no.start < from) {
+                from = line_no.start;
+            }
+            const size_t n = LINE_NO_TAB + 1 - from;
+            memcpy(io_reserve(&out, n), line_no.text + from, n);
+            io_commit(&out, n);
+            line_no_next();
+        }
+
+        const uint8_t *nl = memchr(p, '\n', end - p);
+        const uint8_t *stop = nl ? nl + 1 : end;
+        io_write(&out, p, stop - p);
+        line_no.mid_line = nl == nullptr;
+        p = stop;
     }
+}
 
-    char *line = nullptr;
-    size_t line_cap = 0;
-    ssize_t line_len;
-    while ((line_len = getline(&line, &line_cap, fd)) > 0) {
-        if  (number_lines) {
-            printf("%6u\t%s", *line_number, line);
-            (*line_number)++;
-        } else {
-            fwrite(line, line_len, 1, stdout);
+/* Copy an open file to the output, then close it. */
+static void cat_fd(const int fd) {
+    struct io_reader in;
+    io_reader_fd(&in, fd, APP_NAME);
+
+    const uint8_t *data;
+    size_t len;
+    if (number_lines) {
+        while ((len = io_read(&in, &data)) > 0) {
+            number_block(data, data + len);
+        }
+    } else if (!copy_kernel(in.fd)) {
+        while ((len = io_read(&in, &data)) > 0) {
+            io_write(&out, data, len);
         }
     }
-    fclose(fd);
+    io_close(&in);
+}
+
+/*
+ * With several files, a helper thread opens up to PREFETCH_DEPTH files
+ * ahead of the one being written and asks the kernel to start reading
+ * them, so that the latency of cold files overlaps with the output
+ * instead of adding up. Files are still written strictly in order.
+ */
+#define PREFETCH_DEPTH 16
+
+/* Readahead requested for each prefetched file; the kernel's own
+ * sequential readahead takes over for anything longer. */
+#define PREFETCH_BYTES (4 * 1024 * 1024)
+
+static struct {
+    char **names;
+    size_t count;
+    int fd[PREFETCH_DEPTH];
+    int error[PREFETCH_DEPTH];
+    size_t opened;     /* Files the helper has opened, or failed to. */
+    size_t taken;      /* Files the writer has taken. */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} ahead = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+/* Open a file argument, "-" being stdin. Returns -1 with errno set on failure. */
+static int open_file(const char *filename) {
+    if (strcmp(filename, "-") == 0) {
+        return STDIN_FILENO;
+    }
+    const int fd = open(filename, O_RDONLY);
+#if defined(POSIX_FADV_WILLNEED)
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fd, 0, PREFETCH_BYTES, POSIX_FADV_WILLNEED);
+    }
+#endif
+    return fd;
+}
+
+static void *prefetch_files(void *arg) {
+    (void)arg;
+    for (size_t i = 0; i < ahead.count; i++) {
+        pthread_mutex_lock(&ahead.lock);
+        while (i - ahead.taken >= PREFETCH_DEPTH) {
+            pthread_cond_wait(&ahead.cond, &ahead.lock);
+        }
+        pthread_mutex_unlock(&ahead.lock);
+
+        const int fd = open_file(ahead.names[i]);
+        const int error = errno;
+
+        pthread_mutex_lock(&ahead.lock);
+        ahead.fd[i % PREFETCH_DEPTH] = fd;
+        ahead.error[i % PREFETCH_DEPTH] = error;
+        ahead.opened = i + 1;
+        pthread_cond_broadcast(&ahead.cond);
+        pthread_mutex_unlock(&ahead.lock);
+    }
+    return nullptr;
+}
+
+/* Wait for file i to be opened, and take it. Returns -1 with errno set on failure. */
+static int take_file(const size_t i) {
+    pthread_mutex_lock(&ahead.lock);
+    while (ahead.opened <= i) {
+        pthread_cond_wait(&ahead.cond, &ahead.lock);
+    }
+    const int fd = ahead.fd[i % PREFETCH_DEPTH];
+    const int error = ahead.error[i % PREFETCH_DEPTH];
+    ahead.taken = i + 1;
+    pthread_cond_broadcast(&ahead.cond);
+    pthread_mutex_unlock(&ahead.lock);
+
+    errno = error;
+    return fd;
+}
+
+static void cat_files(char **names, const size_t count) {
+    pthread_t helper;
+    ahead.names = names;
+    ahead.count = count;
+
+    const bool threaded = count > 1 && pthread_create(&helper, nullptr, prefetch_files, nullptr) == 0;
+    for (size_t i = 0; i < count; i++) {
+        const int fd = threaded ? take_file(i) : open_file(names[i]);
+        if (fd < 0) {
+            io_flush(&out);
+            fprintf(stderr, "cannot open file %s: %s\n", names[i], strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        cat_fd(fd);
+    }
+    if (threaded) {
+        pthread_join(helper, nullptr);
+    }
 }
 
 int main(const int argc, char *argv[]) {
-    uint32_t line_number = 1;
     bool unbuffered = 0;
 
     const struct option long_opts[] = {
@@ -93,6 +310,7 @@ int main(const int argc, char *argv[]) {
         {"version", 0, nullptr, 'V'},
         {"number", 0, nullptr, 'n'},
         {"unbuffered", 0, nullptr, 'u'},
+        STATS_LONG_OPT,
         {nullptr,0,nullptr,0}
     };
 
@@ -114,20 +332,28 @@ int main(const int argc, char *argv[]) {
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
         }
     }
 
-    if (argc == optind || strcmp(argv[optind], "-") == 0) {  /* no file arguments */
-        cat_stdin(unbuffered);
-        return EXIT_SUCCESS;
+    io_writer_fd(&out, STDOUT_FILENO, unbuffered, APP_NAME);
+    line_no_init();
+
+    struct stat st;
+    if (fstat(STDOUT_FILENO, &st) == 0) {
+        out_type = st.st_mode;
     }
 
-    while (optind < argc) {
-        cat_file(argv[optind++], &line_number);
+    if (argc == optind) {  /* no file arguments */
+        cat_fd(STDIN_FILENO);
+    } else {
+        cat_files(argv + optind, argc - optind);
     }
-    printf("\n");
+    io_writer_close(&out);
     return EXIT_SUCCESS;
 }
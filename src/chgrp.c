@@ -24,27 +24,33 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <fts.h>
 #include <getopt.h>
 
 #include "common.h"
+#include "idcache.h"
+#include "walk.h"
 
 #define MAX_GROUP_LEN 32
 
 
 static const char *APP_NAME = "chgrp";
 
-static struct group *grp_buf;
+static gid_t to_gid;
 static char *to_grp;
 
 static struct {
     bool no_dereference;
     bool recursive;
     bool verbose;
+    unsigned threads;
 } opts = {
     .no_dereference = false,
     .recursive = false,
-    .verbose = false };
+    .verbose = false,
+    .threads = 0 };
+
+/* Set by the tree walk's workers on any failure. */
+static atomic_bool failed;
 
 static void show_help()
 {
@@ -54,57 +60,52 @@ Options:\n\
     -R, --recursive\t\tchange group of files recursively\n\
     -v, --verbose\t\toutput a diagnostic for every file processed\n\
     -d, --no-dereference\toperate on symbolic links rather than their targets\n\
+    -j, --threads=N\t\twalk directories with N threads (default: one per CPU)\n\
     -h, --help\t\t\tdisplay this help\n\
     -V, --version\t\tdisplay version information\n\n\
 Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 }
 
-/* Compare function for FTS. */
-static int cmp(const FTSENT **s1, const FTSENT **s2)
+/* Change the group of each entry found under a -R operand. */
+static int chgrp_visit(const struct walk_entry *e, const enum walk_visit visit, void *arg)
 {
-    return strcoll((*s1)->fts_name, (*s2)->fts_name);
-}
+    (void)arg;
 
-static int chgrp_recurse(char *path)
-{
-    FTSENT *f;
-    char  *argv[] = { path , nullptr };
-
-    const int flags = opts.no_dereference ? FTS_PHYSICAL : FTS_LOGICAL;
-    FTS *tree = fts_open(argv, flags | FTS_NOSTAT, cmp);
-    if (!tree) {
-        fprintf(stderr, "fts_open() failed: %s\n", strerror(errno));
-        return -1;
+    if (visit == WALK_POST) {
+        return WALK_CONTINUE;
+    }
+    if (visit == WALK_ERR) {
+        fprintf(stderr, "%s: could not read '%s': %s\n", APP_NAME, e->path, strerror(e->error));
+        atomic_store(&failed, true);
+        return WALK_CONTINUE;
     }
 
-    while ((f = fts_read(tree))) {
-        switch (f->fts_info) {
-        case FTS_DNR:
-            fprintf(stderr, "could not read '%s': %s\n", f->fts_path, strerror(f->fts_errno));
-            continue;
-        case FTS_ERR:
-            fprintf(stderr, "failed on '%s': %s", f->fts_path, strerror(f->fts_errno));
-            /* Intentional fall-through to the continue... */
-        case FTS_DP:
-            continue;
-        default:
-            if (f->fts_info == FTS_SL && opts.no_dereference) {
-                if (lchown(f->fts_path, -1, grp_buf->gr_gid) != 0) {
-                    fprintf(stderr, "lchown failed on '%s'\n", path);
-                }
-            } else {
-                if (chown(f->fts_path, -1, grp_buf->gr_gid) != 0) {
-                    fprintf(stderr, "chown failed on '%s'\n", path);
-                }
-            }
-        }
-        if (opts.verbose) {
-            printf("Changed group ownership of '%s' to '%s'\n", f->fts_path, to_grp);
-        }
+    /* A directory is changed through its open descriptor. */
+    const int rv = e->fd >= 0 ? fchown(e->fd, -1, to_gid) :
+        fchownat(e->dirfd, e->name, -1, to_gid, opts.no_dereference ? AT_SYMLINK_NOFOLLOW : 0);
+    if (rv != 0) {
+        fprintf(stderr, "%s: %s failed on '%s': %s\n", APP_NAME,
+            opts.no_dereference ? "lchown" : "chown", e->path, strerror(errno));
+        atomic_store(&failed, true);
+        return WALK_CONTINUE;
     }
 
-    fts_close(tree);
-    return 0;
+    if (opts.verbose) {
+        printf("Changed group ownership of '%s' to '%s'\n", e->path, to_grp);
+    }
+    return WALK_CONTINUE;
+}
+
+static void chgrp_recurse(const char *path)
+{
+    const struct walk_opts wo = {
+        .flags = opts.no_dereference ? 0 : WALK_FOLLOW,
+        .threads = opts.threads,
+        .visit = chgrp_visit,
+        .arg = nullptr,
+        .app_name = APP_NAME
+    };
+    walk(path, &wo);
 }
 
 int main(const int argc, char *argv[])
@@ -115,11 +116,13 @@ int main(const int argc, char *argv[])
         {.name = "recursive",      .has_arg = no_argument, .flag = nullptr, .val = 'R'},
         {.name = "verbose",        .has_arg = no_argument, .flag = nullptr, .val = 'v'},
         {.name = "no-dereference", .has_arg = no_argument, .flag = nullptr, .val = 'd'},
+        {.name = "threads",        .has_arg = required_argument, .flag = nullptr, .val = 'j'},
+        STATS_LONG_OPT,
         {.name = nullptr,          .has_arg = 0,           .flag = nullptr, .val = 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "VhRvd", long_opts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "VhRvdj:", long_opts, nullptr)) != -1) {
         switch(opt) {
             case 'V':
                 printf("%s (%s) version %s\n", APP_NAME, APP_SUITE, APP_VERSION);
@@ -139,6 +142,15 @@ int main(const int argc, char *argv[])
             case 'd':
                 opts.no_dereference = true;
                 break;
+            case 'j': {
+                const int min = 1;
+                const int max = WALK_MAX_THREADS;
+                opts.threads = (unsigned)parse_numeric_arg(optarg, &min, &max, APP_NAME);
+                break;
+            }
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -153,46 +165,38 @@ int main(const int argc, char *argv[])
     }
     strncpy(to_grp, argv[optind], MAX_GROUP_LEN - 1);
 
-    grp_buf = getgrnam(argv[optind]);
-    if (grp_buf == NULL) {
+    if (!get_gid(argv[optind], &to_gid)) {
         printf("Could not resolve group name: %s", argv[optind]);
         return EXIT_FAILURE;
     }
     optind++;
 
-    if (opts.recursive) {
-        /* Status of chgrp calls checked within chgrp_recursive()
-         * A failure of any particular file will be noted, but we
-         * will continue to run... */
-        if (chgrp_recurse(argv[optind]) != 0) {
-            return EXIT_FAILURE;
-        }
-        return EXIT_SUCCESS;
-    }
-
-    while (optind < argc) {
+    for (; optind < argc; optind++) {
         if (opts.recursive) {
-            /* Status of chgrp calls checked within chgrp_recursive()
-             * A failure of any particular file will be noted, but we
-             * will continue to run... */
-            chgrp_recurse(argv[optind++]);
+            /* Failures on single files are reported as the
+             * walk goes, and do not stop the rest of the tree. */
+            chgrp_recurse(argv[optind]);
             continue;
         }
 
         if (opts.no_dereference) {
-            if (lchown(argv[optind], -1, grp_buf->gr_gid) != 0) {
-                fprintf(stderr, "lchown failed on `%s'\n", argv[optind]);
+            if (lchown(argv[optind], -1, to_gid) != 0) {
+                fprintf(stderr, "%s: lchown failed on `%s': %s\n", APP_NAME, argv[optind], strerror(errno));
+                failed = true;
+                continue;
             }
         } else {
-            if (chown(argv[optind], -1, grp_buf->gr_gid) != 0) {
-                fprintf(stderr, "chown failed on `%s'\n", argv[optind++]);
+            if (chown(argv[optind], -1, to_gid) != 0) {
+                fprintf(stderr, "%s: chown failed on `%s': %s\n", APP_NAME, argv[optind], strerror(errno));
+                failed = true;
+                continue;
             }
         }
 
         if (opts.verbose) {
-            printf("Changed group ownership of `%s' to `%s'\n", argv[optind++], to_grp);
+            printf("Changed group ownership of `%s' to `%s'\n", argv[optind], to_grp);
         }
     }
     free(to_grp);
-    return EXIT_SUCCESS;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
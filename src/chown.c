@@ -22,28 +22,34 @@
 
 /* TODO: allow for passing uid/gid. */
 
-#include <fts.h>
 #include <getopt.h>
 
 #include "common.h"
+#include "idcache.h"
+#include "walk.h"
 
 
 static const char *APP_NAME = "chown";
 static size_t FILE_MAX;
 
-static struct group *grp_buf;
-static struct passwd *own_buf;
+static uid_t to_uid;
+static gid_t to_gid;
 
 static struct {
     bool no_dereference;
     bool recursive;
     bool verbose;
     bool group_too;
+    unsigned threads;
 } opts = {
     .no_dereference = false,
     .recursive = false,
     .verbose = false,
-    .group_too = false };
+    .group_too = false,
+    .threads = 0 };
+
+/* Set by the tree walk's workers on any failure. */
+static atomic_bool failed;
 
 static void show_help(void) {
     printf("Usage: %s [OPTION] user[:group]...\n\n\
@@ -52,72 +58,58 @@ Options:\n\
     -R, --recursive\t\tchange group of files recursively\n\
     -v, --verbose\t\toutput a diagnostic for every file processed\n\
     -d, --no-dereference\toperate on symbolic links rather than their targets\n\
+    -j, --threads=N\t\twalk directories with N threads (default: one per CPU)\n\
     -h, --help\t\t\tdisplay this help\n\
     -V, --version\t\tdisplay version information\n\n\
 Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 }
 
-/* Compare function for FTS. */
-static int cmp(const FTSENT **s1, const FTSENT **s2)
+/* Change the ownership of each entry found under a -R operand. */
+static int chown_visit(const struct walk_entry *e, const enum walk_visit visit, void *arg)
 {
-    return strcoll((*s1)->fts_name, (*s2)->fts_name);
-}
+    const char *to_own = ((char **)arg)[0];
+    const char *to_grp = ((char **)arg)[1];
 
-static int chown_recurse(char *path, char to_own[], char to_grp[])
-{
-    FTSENT *f;
-    char  *argv[] = { path , nullptr };
-
-    const int flags = opts.no_dereference ? FTS_PHYSICAL : FTS_LOGICAL;
-    FTS *tree = fts_open(argv, flags | FTS_NOSTAT, cmp);
-    if (!tree) {
-        fprintf(stderr, "fts_open() failed: %s\n", strerror(errno));
-        return -1;
+    if (visit == WALK_POST) {
+        return WALK_CONTINUE;
+    }
+    if (visit == WALK_ERR) {
+        fprintf(stderr, "%s: could not read '%s': %s\n", APP_NAME, e->path, strerror(e->error));
+        atomic_store(&failed, true);
+        return WALK_CONTINUE;
     }
 
-    while ((f = fts_read(tree))) {
-        switch (f->fts_info) {
-            case FTS_DNR:
-                fprintf(stderr, "%s: could not read '%s': %s\n", APP_NAME, f->fts_path, strerror(f->fts_errno));
-                continue;
-            case FTS_ERR:
-                fprintf(stderr, "%s: failed on '%s': %s", APP_NAME, f->fts_path, strerror(f->fts_errno));
-                /* Intentional fall-through to the continue... */
-            case FTS_DP:
-                continue;
-            default:
-                if (opts.group_too) {
-                    if (f->fts_info == FTS_SL && opts.no_dereference) {
-                        if (lchown(f->fts_path, own_buf->pw_uid, grp_buf->gr_gid) != 0) {
-                            fprintf(stderr, "%s: lchown failed on '%s'\n", APP_NAME, path);
-                        }
-                    } else {
-                        if (chown(f->fts_path, own_buf->pw_uid, grp_buf->gr_gid) != 0) {
-                            fprintf(stderr, "%s: chown failed on '%s'\n", APP_NAME, path);
-                        }
-                    }
-                } else {
-                    if (f->fts_info == FTS_SL && opts.no_dereference) {
-                        if (lchown(f->fts_path, own_buf->pw_uid, -1) != 0) {
-                            fprintf(stderr, "%s: lchown failed on '%s'\n", APP_NAME, path);
-                        }
-                    } else {
-                        if (chown(f->fts_path, own_buf->pw_uid, -1) != 0) {
-                            fprintf(stderr, "%s: chown failed on '%s'\n", APP_NAME, path);
-                        }
-                    }
-                }
-        }
-        if (opts.verbose) {
-            printf("Changed ownership of '%s' to '%s'\n", f->fts_path, to_own);
-            if (opts.group_too) {
-                printf("Changed group ownership of '%s' to '%s'\n", f->fts_path, to_grp);
-            }
+    /* A directory is changed through its open descriptor. */
+    const gid_t gid = opts.group_too ? to_gid : (gid_t)-1;
+    const int rv = e->fd >= 0 ? fchown(e->fd, to_uid, gid) :
+        fchownat(e->dirfd, e->name, to_uid, gid, opts.no_dereference ? AT_SYMLINK_NOFOLLOW : 0);
+    if (rv != 0) {
+        fprintf(stderr, "%s: %s failed on '%s': %s\n", APP_NAME,
+            opts.no_dereference ? "lchown" : "chown", e->path, strerror(errno));
+        atomic_store(&failed, true);
+        return WALK_CONTINUE;
+    }
+
+    if (opts.verbose) {
+        printf("Changed ownership of '%s' to '%s'\n", e->path, to_own);
+        if (opts.group_too) {
+            printf("Changed group ownership of '%s' to '%s'\n", e->path, to_grp);
         }
     }
+    return WALK_CONTINUE;
+}
 
-    fts_close(tree);
-    return 0;
+static void chown_recurse(const char *path, char to_own[], char to_grp[])
+{
+    char *names[] = { to_own, to_grp };
+    const struct walk_opts wo = {
+        .flags = opts.no_dereference ? 0 : WALK_FOLLOW,
+        .threads = opts.threads,
+        .visit = chown_visit,
+        .arg = names,
+        .app_name = APP_NAME
+    };
+    walk(path, &wo);
 }
 
 int main(const int argc, char *argv[])
@@ -128,11 +120,13 @@ int main(const int argc, char *argv[])
         {.name = "recursive",      .has_arg = 0, .flag = nullptr, .val = 'R'},
         {.name = "verbose",        .has_arg = 0, .flag = nullptr, .val = 'v'},
         {.name = "no-dereference", .has_arg = 0, .flag = nullptr, .val = 'd'},
+        {.name = "threads",        .has_arg = 1, .flag = nullptr, .val = 'j'},
+        STATS_LONG_OPT,
         {.name = nullptr,.has_arg = 0, .flag = nullptr,.val = 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "VhRvd", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "VhRvdj:", long_opts, NULL)) != -1) {
         switch(opt) {
             case 'V':
                 printf("%s (%s) version %s\n", APP_NAME, APP_SUITE, APP_VERSION);
@@ -152,6 +146,15 @@ int main(const int argc, char *argv[])
             case 'd':
                 opts.no_dereference = true;
                 break;
+            case 'j': {
+                const int min = 1;
+                const int max = WALK_MAX_THREADS;
+                opts.threads = (unsigned)parse_numeric_arg(optarg, &min, &max, APP_NAME);
+                break;
+            }
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -177,48 +180,47 @@ int main(const int argc, char *argv[])
     }
     optind++;
 
-    own_buf = getpwnam(to_own);
-    if (own_buf == NULL) {
+    if (!get_uid(to_own, &to_uid)) {
         fprintf(stderr, "%s: could not resolve user name: %s\n", APP_NAME, to_own);
         return EXIT_FAILURE;
     }
 
-    grp_buf = getgrnam(to_grp);
-    if (opts.group_too && grp_buf == NULL) {
+    if (opts.group_too && !get_gid(to_grp, &to_gid)) {
         fprintf(stderr, "%s: could not resolve group name: %s\n", APP_NAME, to_grp);
         return EXIT_FAILURE;
     }
 
-    if (opts.recursive) {
-        /* Status of chown calls checked within chown_recursive()
-        * A failure of any particular file will be noted, but we
-        * will continue to run... */
-        if (chown_recurse(argv[optind], to_own, to_grp) != 0) {
-            return EXIT_FAILURE;
+    while (optind < argc) {
+        if (opts.recursive) {
+            /* Failures on single files are reported as the
+             * walk goes, and do not stop the rest of the tree. */
+            chown_recurse(argv[optind++], to_own, to_grp);
+            continue;
         }
-        return EXIT_SUCCESS;
-    }
 
-    while (optind < argc) {
         if (opts.no_dereference) {
             if (opts.group_too) {
-                if (lchown(argv[optind], own_buf->pw_uid, grp_buf->gr_gid) != 0) {
-                fprintf(stderr, "%s: lchown failed: %s\n", APP_NAME, strerror(errno));
+                if (lchown(argv[optind], to_uid, to_gid) != 0) {
+                    fprintf(stderr, "%s: lchown failed: %s\n", APP_NAME, strerror(errno));
+                    failed = true;
                 }
             } else {
-                if (lchown(argv[optind], own_buf->pw_uid, -1) != 0) {
-                fprintf(stderr, "%s: lchown failed: %s\n", APP_NAME, strerror(errno));
+                if (lchown(argv[optind], to_uid, -1) != 0) {
+                    fprintf(stderr, "%s: lchown failed: %s\n", APP_NAME, strerror(errno));
+                    failed = true;
                 }
             }
 
         } else {
             if (opts.group_too) {
-                if (chown(argv[optind], own_buf->pw_uid, grp_buf->gr_gid) != 0) {
-                fprintf(stderr, "%s: chown failed: %s\n", APP_NAME, strerror(errno));
+                if (chown(argv[optind], to_uid, to_gid) != 0) {
+                    fprintf(stderr, "%s: chown failed: %s\n", APP_NAME, strerror(errno));
+                    failed = true;
                 }
             } else {
-                if (chown(argv[optind], own_buf->pw_uid, -1) != 0) {
-                fprintf(stderr, "%s: chown failed: %s\n", APP_NAME, strerror(errno));
+                if (chown(argv[optind], to_uid, -1) != 0) {
+                    fprintf(stderr, "%s: chown failed: %s\n", APP_NAME, strerror(errno));
+                    failed = true;
                 }
             }
         }
@@ -231,5 +233,5 @@ int main(const int argc, char *argv[])
         }
         optind++;
     }
-    return EXIT_SUCCESS;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
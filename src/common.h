@@ -33,6 +33,9 @@
 #include <ctype.h>
 #include <pwd.h>
 #include <grp.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
 
 
 /* Version information */
@@ -48,13 +51,13 @@
 #endif
 
 /* Determine portable, local max path length. */
-extern inline size_t get_path_max()
+static inline size_t get_path_max()
 {
     return pathconf(".", _PC_PATH_MAX);
 }
 
 /* Determine portable, local max filename length. */
-extern inline size_t get_filename_max()
+static inline size_t get_filename_max()
 {
     return pathconf(".", _PC_NAME_MAX);
 }
@@ -81,11 +84,10 @@ extern inline size_t get_filename_max()
 
 #define ANSI_RESET     "\x1b[0m"
 
-/* Formats 'human readable' output.
- * Used by ls and vdir. */
-extern inline void format_ls(const long long int bytes)
+/* Formats 'human readable' sizes into size_string,
+ * and returns it. Used by ls and vdir. */
+static inline char *format_ls(const long long int bytes, char size_string[22])
 {
-    char size_string[22];
     double result;
     if (bytes < 1024) {
         if (snprintf(size_string, 21, "%lld", bytes) < 0) {
@@ -107,10 +109,10 @@ extern inline void format_ls(const long long int bytes)
             perror("sprintf"); exit(EXIT_FAILURE);
         }
     }
-    printf("%6s ", size_string);
+    return size_string;
 }
 
-extern inline long parse_numeric_arg(char *arg, const int *min, const int *max, const char *name) {
+static inline long parse_numeric_arg(char *arg, const int *min, const int *max, const char *name) {
     char *end_ptr;
     errno = 0;
 
@@ -144,7 +146,7 @@ extern inline long parse_numeric_arg(char *arg, const int *min, const int *max,
 }
 
 /* Debugging aids */
-inline int dump_args(int argc, char *argv[])
+static inline int dump_args(int argc, char *argv[])
 {
   printf("argc: %i\n", argc);
     for (int i = 1; i < argc; i++) {
@@ -154,7 +156,7 @@ inline int dump_args(int argc, char *argv[])
 }
 
 /* trims leading and tailing whitespace from strings */
-extern inline char* trim_whitespace(char *str)
+static inline char* trim_whitespace(char *str)
 {
     size_t len = 0;
     const char *front_p = str;
@@ -196,33 +198,31 @@ bit information in returned string. */
 
 #define PERM_STR_SIZE sizeof("rwxrwxrwx")
 
-/* Return 'ls -l' style string for file permissions mask, This is from
- * 'The Linux Programming Interface'. */
-extern inline char* file_perm_str(const mode_t perm, const int flags)
+/* Fill str with the 'ls -l' style string for file permissions mask, and
+ * return it. str must hold PERM_STR_SIZE bytes. This is from 'The Linux
+ * Programming Interface'. */
+static inline char* file_perm_str(const mode_t perm, const int flags, char *str)
 {
-    char *str = malloc(PERM_STR_SIZE + 1);
-    if (!str) {
-        fprintf(stderr, "malloc failed\n");
-        exit(EXIT_FAILURE);
-    }
-    snprintf(str, PERM_STR_SIZE, "%c%c%c%c%c%c%c%c%c",
-    (perm & S_IRUSR) ? 'r' : '-', (perm & S_IWUSR) ? 'w' : '-',
-    (perm & S_IXUSR) ?
-    (((perm & S_ISUID) && (flags & FP_SPECIAL)) ? 's' : 'x') :
-    (((perm & S_ISUID) && (flags & FP_SPECIAL)) ? 'S' : '-'),
-    (perm & S_IRGRP) ? 'r' : '-', (perm & S_IWGRP) ? 'w' : '-',
-    (perm & S_IXGRP) ?
-    (((perm & S_ISGID) && (flags & FP_SPECIAL)) ? 's' : 'x') :
-    (((perm & S_ISGID) && (flags & FP_SPECIAL)) ? 'S' : '-'),
-    (perm & S_IROTH) ? 'r' : '-', (perm & S_IWOTH) ? 'w' : '-',
-    (perm & S_IXOTH) ?
-    (((perm & S_ISVTX) && (flags & FP_SPECIAL)) ? 't' : 'x') :
-    (((perm & S_ISVTX) && (flags & FP_SPECIAL)) ? 'T' : '-'));
+    const bool special = flags & FP_SPECIAL;
+
+    str[0] = (perm & S_IRUSR) ? 'r' : '-';
+    str[1] = (perm & S_IWUSR) ? 'w' : '-';
+    str[2] = (perm & S_IXUSR) ? ((perm & S_ISUID) && special ? 's' : 'x')
+                              : ((perm & S_ISUID) && special ? 'S' : '-');
+    str[3] = (perm & S_IRGRP) ? 'r' : '-';
+    str[4] = (perm & S_IWGRP) ? 'w' : '-';
+    str[5] = (perm & S_IXGRP) ? ((perm & S_ISGID) && special ? 's' : 'x')
+                              : ((perm & S_ISGID) && special ? 'S' : '-');
+    str[6] = (perm & S_IROTH) ? 'r' : '-';
+    str[7] = (perm & S_IWOTH) ? 'w' : '-';
+    str[8] = (perm & S_IXOTH) ? ((perm & S_ISVTX) && special ? 't' : 'x')
+                              : ((perm & S_ISVTX) && special ? 'T' : '-');
+    str[9] = '\0';
     return str;
 }
 
 /* Returns octal permissions of a file/directory. */
-extern inline int file_perm_oct(const mode_t perm) {
+static inline int file_perm_oct(const mode_t perm) {
     int oct_perm = 00;
     if (perm & S_ISUID) oct_perm += 04000;
     if (perm & S_ISGID) oct_perm += 02000;
@@ -239,7 +239,7 @@ extern inline int file_perm_oct(const mode_t perm) {
     return oct_perm;
 }
 
-extern inline char* filetype(const mode_t st_mode, const bool long_form)
+static inline char* filetype(const mode_t st_mode, const bool long_form)
 {
     switch (st_mode & S_IFMT) {
     case S_IFBLK:
@@ -261,33 +261,91 @@ extern inline char* filetype(const mode_t st_mode, const bool long_form)
     }
 }
 
-extern inline char* get_username(const uid_t uid)
+/*
+ * Resource report, printed to stderr on exit by any tool run with --stats.
+ * Tools add STATS_LONG_OPT to their long options, and call stats_enable()
+ * for STATS_OPT. The byte and call counters are kept by the I/O layer in
+ * io.h; on Linux /proc/self/io is used instead, as it also sees stdio.
+ */
+
+/* Well clear of the long-only option values tools define from 256 up. */
+#define STATS_OPT 0x1000
+#define STATS_LONG_OPT { .name = "stats", .has_arg = no_argument, .flag = nullptr, .val = STATS_OPT }
+
+/* Atomic, as the threaded tools read from several threads at once. */
+static struct {
+    _Atomic uint64_t bytes_read;
+    _Atomic uint64_t bytes_written;
+    _Atomic uint64_t reads;
+    _Atomic uint64_t writes;
+} io_counters;
+
+static struct {
+    const char *app_name;
+    struct timespec start;
+} stats_state;
+
+static inline double stats_seconds(const struct timeval tv)
+{
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static inline void stats_report()
 {
-    errno = 0;
-    const struct passwd *pwd = getpwuid(uid);
+    /* Runs before exit() flushes stdio, so flush now to count it. */
+    fflush(stdout);
 
-    if (pwd == NULL) {
-        if (errno == 0) {
-            return (char *)"unknown username";
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const double wall = (double)(now.tv_sec - stats_state.start.tv_sec) +
+                        (double)(now.tv_nsec - stats_state.start.tv_nsec) / 1e9;
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    /* ru_maxrss is in bytes on macOS, KiB elsewhere. */
+#if defined(__APPLE__) && defined(__MACH__)
+    ru.ru_maxrss /= 1024;
+#endif
+
+    uint64_t rchar = io_counters.bytes_read;
+    uint64_t wchar = io_counters.bytes_written;
+    uint64_t syscr = io_counters.reads;
+    uint64_t syscw = io_counters.writes;
+
+#ifdef __linux__
+    FILE *fp = fopen("/proc/self/io", "r");
+    if (fp) {
+        char key[32];
+        unsigned long long val;
+        while (fscanf(fp, "%31[^:]: %llu\n", key, &val) == 2) {
+            if (strcmp(key, "rchar") == 0) rchar = val;
+            else if (strcmp(key, "wchar") == 0) wchar = val;
+            else if (strcmp(key, "syscr") == 0) syscr = val;
+            else if (strcmp(key, "syscw") == 0) syscw = val;
         }
-        fprintf(stderr, "username lookup failed");
-        exit(EXIT_FAILURE);
+        fclose(fp);
     }
-    return pwd->pw_name;
+#endif
+
+    fprintf(stderr, "%s: wall %.3fs, user %.3fs, sys %.3fs\n", stats_state.app_name,
+            wall, stats_seconds(ru.ru_utime), stats_seconds(ru.ru_stime));
+    fprintf(stderr, "%s: read %llu bytes in %llu calls, wrote %llu bytes in %llu calls\n",
+            stats_state.app_name, (unsigned long long)rchar, (unsigned long long)syscr,
+            (unsigned long long)wchar, (unsigned long long)syscw);
+    fprintf(stderr, "%s: peak RSS %ld KiB, page faults %ld minor, %ld major\n",
+            stats_state.app_name, (long)ru.ru_maxrss, (long)ru.ru_minflt, (long)ru.ru_majflt);
 }
 
-extern inline char* get_groupname(const gid_t gid)
+/* Arrange for the resource report to be printed on exit. */
+static inline void stats_enable(const char *app_name)
 {
-    errno = 0;
-    const struct group *grp = getgrgid(gid);
-    if (grp == NULL) {
-        if (errno == 0) {
-            return (char *)"unknown group name";
-        }
-        fprintf(stderr, "group name lookup failed");
-        exit(EXIT_FAILURE);
+    if (stats_state.app_name) {
+        return;
     }
-    return grp->gr_name;
+    stats_state.app_name = app_name;
+    clock_gettime(CLOCK_MONOTONIC, &stats_state.start);
+    atexit(stats_report);
 }
 
 #endif /* COMMON_H */
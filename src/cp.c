@@ -160,6 +160,7 @@ int main(const int argc, char *argv[])
         {.name = "verbose",     .has_arg = 0, .flag = nullptr, .val = 'v'},
         {.name = "recursive",   .has_arg = 0, .flag = nullptr, .val = 'r'},
         {.name = "force",       .has_arg = 0, .flag = nullptr, .val = 'f'},
+        STATS_LONG_OPT,
         {.name = nullptr,       .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -194,6 +195,9 @@ int main(const int argc, char *argv[])
             case 'R':
                 opts.recursive = true;
                 break;
+            case STATS_OPT:
+            stats_enable(APP_NAME);
+            break;
             case '?':
             default:
                 show_help();
@@ -201,7 +205,7 @@ int main(const int argc, char *argv[])
         }
     }
 
-    if (argc < 3) {
+    if (argc - optind < 2) {
         fprintf(stderr, "%s: Missing destination operand\n\n", APP_NAME);
         show_help();
         return EXIT_FAILURE;
@@ -244,13 +248,13 @@ int main(const int argc, char *argv[])
     /* Exactly two operands, with no recurse.
      * op1 must be a regular file, op2 may be
      * a regular file or directory. */
-    if (argc == 3) {
+    if (argc - optind == 2) {
         if (last_op_is_dir) {
-            snprintf(destination, PATH_MAX, "%s/%s", argv[argc - 1], argv[1]);
+            snprintf(destination, PATH_MAX, "%s/%s", argv[argc - 1], argv[optind]);
         } else {
             strncpy(destination, argv[argc - 1], PATH_MAX);
         }
-        return copy_file(argv[1], destination);
+        return copy_file(argv[optind], destination);
     }
 
     /* More than two operands, with no recurse.
@@ -0,0 +1,227 @@
+/***************************************************************************
+ *   cpu.h - CPU feature detection and kernel dispatch                     *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+#if defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+
+/*
+ * CPU features the kernels can make use of. A kernel that needs a
+ * feature is built for it with one of the CPU_TARGET_* attributes, so
+ * the rest of the program keeps the baseline instruction set, and is
+ * only called when cpu_features() reports the feature.
+ */
+#define CPU_SSE42   (1u << 0)
+#define CPU_AVX2    (1u << 1)
+#define CPU_AVX512  (1u << 2)  /* F, BW and VL together. */
+#define CPU_SHANI   (1u << 3)
+#define CPU_NEON    (1u << 4)
+#define CPU_ARMSHA2 (1u << 5)
+
+static const struct {
+    uint32_t bit;
+    const char *name;
+} cpu_feature_names[] = {
+    { .bit = CPU_SSE42,   .name = "sse4.2" },
+    { .bit = CPU_AVX2,    .name = "avx2" },
+    { .bit = CPU_AVX512,  .name = "avx512" },
+    { .bit = CPU_SHANI,   .name = "sha-ni" },
+    { .bit = CPU_NEON,    .name = "neon" },
+    { .bit = CPU_ARMSHA2, .name = "sha2" },
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_TARGET_SSE42  [[gnu::target("sse4.2")]]
+#define CPU_TARGET_AVX2   [[gnu::target("avx2")]]
+#define CPU_TARGET_AVX512 [[gnu::target("avx512f,avx512bw,avx512vl")]]
+#define CPU_TARGET_SHANI  [[gnu::target("sha,sse4.1")]]
+#elif defined(__aarch64__)
+#define CPU_TARGET_ARMSHA2 [[gnu::target("+crypto")]]
+#endif
+
+/* Read the CPU's own feature flags. */
+static inline uint32_t cpu_detect()
+{
+    uint32_t features = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t eax, ebx, ecx, edx;
+
+    __asm__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    const uint32_t max_leaf = eax;
+
+    __asm__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+    if (ecx & (1u << 20)) {
+        features |= CPU_SSE42;
+    }
+
+    /* The AVX registers are only usable if the OS saves them,
+     * which XGETBV reports once OSXSAVE says it may be used. */
+    uint32_t xcr0 = 0;
+    if ((ecx & (1u << 27)) && (ecx & (1u << 28))) {
+        uint32_t xcr0_hi;
+        __asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+    }
+
+    if (max_leaf >= 7) {
+        __asm__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+        if ((xcr0 & 0x06) == 0x06 && (ebx & (1u << 5))) {
+            features |= CPU_AVX2;
+        }
+        const uint32_t avx512 = (1u << 16) | (1u << 30) | (1u << 31);
+        if ((xcr0 & 0xE6) == 0xE6 && (ebx & avx512) == avx512) {
+            features |= CPU_AVX512;
+        }
+        if ((ebx & (1u << 29)) && (features & CPU_SSE42)) {
+            features |= CPU_SHANI;
+        }
+    }
+#elif defined(__aarch64__)
+    /* Advanced SIMD is part of the base architecture. */
+    features |= CPU_NEON;
+#if defined(__linux__)
+    if (getauxval(AT_HWCAP) & (1u << 6)) {  /* HWCAP_SHA2 */
+        features |= CPU_ARMSHA2;
+    }
+#elif defined(__APPLE__)
+    features |= CPU_ARMSHA2;
+#endif
+#endif
+
+    return features;
+}
+
+/* Apply the ULL_FORCE_ISA override, a comma-separated list of feature
+ * names, or 'scalar' for none. Features the CPU lacks are dropped with
+ * a warning, since running their kernels would fault. */
+static inline uint32_t cpu_force(const char *force, const uint32_t detected)
+{
+    uint32_t features = 0;
+    const char *p = force;
+
+    while (*p) {
+        const size_t len = strcspn(p, ",");
+        bool known = len == strlen("scalar") && strncmp(p, "scalar", len) == 0;
+
+        for (size_t i = 0; i < sizeof(cpu_feature_names) / sizeof(cpu_feature_names[0]); i++) {
+            if (strlen(cpu_feature_names[i].name) != len ||
+                strncmp(p, cpu_feature_names[i].name, len) != 0) {
+                continue;
+            }
+            known = true;
+            if (detected & cpu_feature_names[i].bit) {
+                features |= cpu_feature_names[i].bit;
+            } else {
+                fprintf(stderr, "ULL_FORCE_ISA: %s not supported by this CPU, ignored\n",
+                        cpu_feature_names[i].name);
+            }
+        }
+        if (!known) {
+            fprintf(stderr, "ULL_FORCE_ISA: unknown feature '%.*s'\n", (int)len, p);
+        }
+
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return features;
+}
+
+/* The features kernels may use, detected on first call. */
+static inline uint32_t cpu_features()
+{
+    static uint32_t features;
+    static bool known = false;
+
+    if (!known) {
+        features = cpu_detect();
+        const char *force = getenv("ULL_FORCE_ISA");
+        if (force) {
+            features = cpu_force(force, features);
+        }
+        known = true;
+    }
+    return features;
+}
+
+/*
+ * Kernel dispatch. Each kernel with more than one implementation has
+ * a table of them, ordered best first and ending with the portable
+ * version, which needs nothing. Every entry starts with the features
+ * it needs, for example:
+ *
+ *     static const struct {
+ *         uint32_t needs;
+ *         const char *isa;
+ *         void (*fn)(const uint8_t *, size_t);
+ *     } foo_impls[] = {
+ *         { .needs = CPU_AVX2, .isa = "avx2",   .fn = foo_avx2 },
+ *         { .needs = 0,        .isa = "scalar", .fn = foo_scalar },
+ *     };
+ *
+ * CPU_SELECT(foo_impls) then points at the entry to use. Look it
+ * up once, outside the hot loop.
+ */
+static inline size_t cpu_select_index(const void *table, const size_t stride, const size_t n)
+{
+    const uint32_t features = cpu_features();
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t needs;
+        memcpy(&needs, (const uint8_t *)table + i * stride, sizeof(needs));
+        if ((needs & features) == needs) {
+            return i;
+        }
+    }
+    return n - 1;
+}
+
+#define CPU_SELECT(impls) \
+    (&(impls)[cpu_select_index((impls), sizeof((impls)[0]), sizeof(impls) / sizeof((impls)[0]))])
+
+/* Write the names of the features in 'features' to buf. */
+static inline void cpu_feature_string(const uint32_t features, char *buf, const size_t size)
+{
+    size_t len = 0;
+    buf[0] = '\0';
+
+    for (size_t i = 0; i < sizeof(cpu_feature_names) / sizeof(cpu_feature_names[0]); i++) {
+        if (features & cpu_feature_names[i].bit) {
+            len += snprintf(buf + len, len < size ? size - len : 0, "%s%s",
+                            len ? " " : "", cpu_feature_names[i].name);
+        }
+    }
+    if (len == 0) {
+        snprintf(buf, size, "scalar");
+    }
+}
+
+#endif /* CPU_H */
@@ -26,6 +26,7 @@
 
 #include "mount.h"
 #include "common.h"
+#include "io.h"
 
 /* Print all fields.
  * 2047 = 0000011111111111 =
@@ -152,6 +153,7 @@ int main(const int argc, char *argv[])
         { .name = "all",        .has_arg = no_argument,       .flag = nullptr, .val = 'a' },
         { .name = "output",     .has_arg = optional_argument, .flag = nullptr, .val = 'o' },
         { .name = "block-size", .has_arg = required_argument, .flag = nullptr, .val = 'b' },
+        STATS_LONG_OPT,
         { .name = nullptr,      .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -222,6 +224,9 @@ int main(const int argc, char *argv[])
                 return EXIT_FAILURE;
             }
             break;
+        case STATS_OPT:
+            stats_enable(APP_NAME);
+            break;
         default:
             show_help();
             EXIT_FAILURE;
@@ -312,52 +317,64 @@ int main(const int argc, char *argv[])
         }
     }
 
+    struct io_writer *out = io_stdout(APP_NAME);
+
     /* Print the selected headers. */
     if (opts.fields & source) {
-        printf("%-16s ", "Filesystem");
+        io_put_str(out, "Filesystem", -16);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & fstype) {
-        printf("%-10s ", "FS type");
+        io_put_str(out, "FS type", -10);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & itotal) {
-        printf("%-12s ", "Inodes");
+        io_put_str(out, "Inodes", -12);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & iused) {
-        printf("%-8s ", "IUsed");
+        io_put_str(out, "IUsed", -8);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & iavail) {
-        printf("%-12s ", "IFree");
+        io_put_str(out, "IFree", -12);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & ipcent) {
-        printf("%5s ", "IUse%");
+        io_put_str(out, "IUse%", 5);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & size) {
-        printf("%-*s ", w, size_label);
+        io_put_str(out, size_label, -w);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & used) {
-        printf("%-*s ", w, "Used");
+        io_put_str(out, "Used", -w);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & avail) {
-        printf("%-*s ", w, "Free");
+        io_put_str(out, "Free", -w);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & pcent) {
-        printf("%4s ", "Use%");
+        io_put_str(out, "Use%", 4);
+        io_putc(out, ' ');
     }
 
     if (opts.fields & target) {
-        printf(" %s", "Mount Point");
+        io_puts(out, " Mount Point");
     }
 
-    putchar('\n');
+    io_putc(out, '\n');
 
     /* Print the Data */
     for (int i = 0; i < n_mounts; i++) {
@@ -385,50 +402,61 @@ int main(const int argc, char *argv[])
 
         /* Print the selected data. */
         if (opts.fields & source) {
-            printf("%-16s ", mfs[i].f_mntfromname);
+            io_put_str(out, mfs[i].f_mntfromname, -16);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & fstype) {
-            printf("%-10s ", mfs[i].f_fstypename);
+            io_put_str(out, mfs[i].f_fstypename, -10);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & itotal) {
-            printf("%-12" PRId64 " ", mfs[i].f_files);
+            io_put_uint(out, mfs[i].f_files, -12);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & iused) {
-            printf("%-8" PRId64 " ", mfs[i].f_files - mfs[i].f_ffree);
+            io_put_uint(out, mfs[i].f_files - mfs[i].f_ffree, -8);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & iavail) {
-            printf("%-12" PRId64 " ", mfs[i].f_ffree);
+            io_put_uint(out, mfs[i].f_ffree, -12);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & ipcent) {
-            printf("%4" PRId64 "%% ", calculate_percent(mfs[i].f_files, mfs[i].f_ffree));
+            io_put_uint(out, calculate_percent(mfs[i].f_files, mfs[i].f_ffree), 4);
+            io_write(out, "% ", 2);
         }
 
         if (opts.fields & size) {
-            printf("%-*" PRId64 " ", w, p_size);
+            io_put_uint(out, p_size, -w);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & used) {
-            printf("%-*" PRId64 " ", w, p_used);
+            io_put_uint(out, p_used, -w);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & avail) {
-            printf("%-*" PRId64 " ", w, p_free);
+            io_put_uint(out, p_free, -w);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & pcent) {
-            printf("%3" PRId64 "%% ", calculate_percent(mfs[i].f_blocks, mfs[i].f_bfree));
+            io_put_uint(out, calculate_percent(mfs[i].f_blocks, mfs[i].f_bfree), 3);
+            io_write(out, "% ", 2);
         }
 
         if (opts.fields & target) {
-            printf(" %s", mfs[i].f_mntonname);
+            io_putc(out, ' ');
+            io_puts(out, mfs[i].f_mntonname);
         }
 
-        putchar('\n');
+        io_putc(out, '\n');
     }
 
     free(mfs);
@@ -0,0 +1,890 @@
+/***************************************************************************
+ *   digest.h - shared driver for the md5sum and sha*sum utilities         *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include "common.h"
+#include "io.h"
+#include "md5.h"
+#include "names.h"
+#include "pool.h"
+#include "sha2.h"
+
+#define DIGEST_MAX_SIZE SHA512_DIGEST_SIZE
+
+/* The multi-lane kernels of md5.h and sha2.h share one signature. */
+#define DIGEST_MB_MAX_LANES 16
+static_assert(MD5_MB_MAX_LANES == DIGEST_MB_MAX_LANES && SHA256_MB_MAX_LANES == DIGEST_MB_MAX_LANES);
+
+typedef void (*digest_mb_fn)(uint32_t st[][DIGEST_MB_MAX_LANES], const uint8_t *const data[], size_t n);
+
+/* Room for any of the digests in progress. */
+union digest_ctx {
+    struct md5_ctx md5;
+    struct sha256_ctx sha256;
+    struct sha512_ctx sha512;
+};
+
+/* One hash function, driven through an opaque context. */
+struct digest_algo {
+    const char *name;
+    size_t size;
+    void (*init)(union digest_ctx *ctx);
+    void (*update)(union digest_ctx *ctx, const void *data, size_t len);
+    void (*final)(union digest_ctx *ctx, uint8_t *out);
+    /* Multi-lane hashing of small files, where the algorithm has it. */
+    size_t (*mb_select)(digest_mb_fn *fn);  /* Returns the lane count, 0 for none. */
+    const uint32_t *mb_init;                /* The initial registers. */
+    int mb_regs;
+    bool mb_big_endian;                     /* Byte order of the size and digest words. */
+};
+
+static inline void digest_md5_init(union digest_ctx *ctx)    { md5_init(&ctx->md5); }
+static inline void digest_sha224_init(union digest_ctx *ctx) { sha224_init(&ctx->sha256); }
+static inline void digest_sha256_init(union digest_ctx *ctx) { sha256_init(&ctx->sha256); }
+static inline void digest_sha384_init(union digest_ctx *ctx) { sha384_init(&ctx->sha512); }
+static inline void digest_sha512_init(union digest_ctx *ctx) { sha512_init(&ctx->sha512); }
+
+static inline void digest_md5_update(union digest_ctx *ctx, const void *data, const size_t len)
+{
+    md5_update(&ctx->md5, data, len);
+}
+
+static inline void digest_sha256_update(union digest_ctx *ctx, const void *data, const size_t len)
+{
+    sha256_update(&ctx->sha256, data, len);
+}
+
+static inline void digest_sha512_update(union digest_ctx *ctx, const void *data, const size_t len)
+{
+    sha512_update(&ctx->sha512, data, len);
+}
+
+static inline void digest_md5_final(union digest_ctx *ctx, uint8_t *out)    { md5_final(&ctx->md5, out); }
+static inline void digest_sha256_final(union digest_ctx *ctx, uint8_t *out) { sha256_final(&ctx->sha256, out); }
+static inline void digest_sha512_final(union digest_ctx *ctx, uint8_t *out) { sha512_final(&ctx->sha512, out); }
+
+static inline size_t digest_md5_mb(digest_mb_fn *fn)
+{
+    const typeof(md5_mb_impls[0]) *mb = CPU_SELECT(md5_mb_impls);
+    *fn = mb->fn;
+    return mb->lanes;
+}
+
+static inline size_t digest_sha256_mb(digest_mb_fn *fn)
+{
+    const typeof(sha256_mb_impls[0]) *mb = CPU_SELECT(sha256_mb_impls);
+    *fn = mb->fn;
+    return mb->lanes;
+}
+
+static const struct digest_algo digest_md5 = {
+    .name = "MD5", .size = MD5_DIGEST_SIZE,
+    .init = digest_md5_init, .update = digest_md5_update, .final = digest_md5_final,
+    .mb_select = digest_md5_mb, .mb_init = md5_init_regs, .mb_regs = 4, .mb_big_endian = false
+};
+static const struct digest_algo digest_sha224 = {
+    .name = "SHA224", .size = SHA224_DIGEST_SIZE,
+    .init = digest_sha224_init, .update = digest_sha256_update, .final = digest_sha256_final,
+    .mb_select = digest_sha256_mb, .mb_init = sha224_init_regs, .mb_regs = 8, .mb_big_endian = true
+};
+static const struct digest_algo digest_sha256 = {
+    .name = "SHA256", .size = SHA256_DIGEST_SIZE,
+    .init = digest_sha256_init, .update = digest_sha256_update, .final = digest_sha256_final,
+    .mb_select = digest_sha256_mb, .mb_init = sha256_init_regs, .mb_regs = 8, .mb_big_endian = true
+};
+static const struct digest_algo digest_sha384 = {
+    .name = "SHA384", .size = SHA384_DIGEST_SIZE,
+    .init = digest_sha384_init, .update = digest_sha512_update, .final = digest_sha512_final,
+    .mb_select = nullptr
+};
+static const struct digest_algo digest_sha512 = {
+    .name = "SHA512", .size = SHA512_DIGEST_SIZE,
+    .init = digest_sha512_init, .update = digest_sha512_update, .final = digest_sha512_final,
+    .mb_select = nullptr
+};
+
+/*
+ * Files are read DIGEST_BUF_SIZE bytes at a time, so each update()
+ * hands the compression function thousands of chunks in one call.
+ * Regular files of DIGEST_MMAP_MIN bytes or more are mapped instead,
+ * which saves copying them through the buffer.
+ */
+#define DIGEST_BUF_SIZE (256 * 1024)
+#define DIGEST_MMAP_MIN (1024 * 1024)
+
+/* Read from fd until buf holds len bytes or end of file. Returns the
+ * byte count, or -1 with errno set on a read error. */
+static inline ssize_t digest_read_full(const int fd, uint8_t *buf, const size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        const ssize_t n = read(fd, buf + got, len - got);
+        io_counters.reads++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        got += n;
+        io_counters.bytes_read += n;
+    }
+    return (ssize_t)got;
+}
+
+/* Hash the rest of fd, of which the first offset bytes have been read,
+ * into ctx. buf holds DIGEST_BUF_SIZE bytes. Returns false with errno
+ * set on a read error. */
+static inline bool digest_fd(const struct digest_algo *algo, union digest_ctx *ctx, const int fd,
+                             const off_t offset, uint8_t *buf)
+{
+    struct stat sb;
+    if (fd != STDIN_FILENO && fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) &&
+        sb.st_size >= DIGEST_MMAP_MIN && sb.st_size > offset) {
+        uint8_t *map = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, sb.st_size, MADV_SEQUENTIAL);
+            algo->update(ctx, map + offset, sb.st_size - offset);
+            munmap(map, sb.st_size);
+            io_counters.bytes_read += sb.st_size - offset;
+            return true;
+        }
+    }
+
+    ssize_t n;
+    while ((n = digest_read_full(fd, buf, DIGEST_BUF_SIZE)) > 0) {
+        algo->update(ctx, buf, n);
+    }
+    return n == 0;
+}
+
+/* Write the digest of path ("-" being stdin) to out, reading through
+ * buf. Returns false with errno set if the file cannot be opened or read. */
+static inline bool digest_file(const struct digest_algo *algo, const char *path, uint8_t *out, uint8_t *buf)
+{
+    int fd = STDIN_FILENO;
+    if (strcmp(path, "-") != 0 && (fd = open(path, O_RDONLY)) < 0) {
+        return false;
+    }
+
+    union digest_ctx ctx;
+    algo->init(&ctx);
+    const bool ok = digest_fd(algo, &ctx, fd, 0, buf);
+    const int err = errno;
+    algo->final(&ctx, out);
+
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    errno = err;
+    return ok;
+}
+
+/* Format a digest as lowercase hex into hex, which holds 2 * size + 1 bytes. */
+static inline void digest_hex(const uint8_t *digest, const size_t size, char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; i++) {
+        hex[2 * i]     = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0xf];
+    }
+    hex[2 * size] = '\0';
+}
+
+/*
+ * Files up to DIGEST_MB_MAX bytes are read whole and hashed by the
+ * multi-lane kernels, one per lane; a larger one is streamed through
+ * its own context as soon as it is found, while the lanes wait.
+ */
+#define DIGEST_MB_MAX  (64 * 1024)
+
+struct digest_result {
+    char *name;
+    bool owned;
+    int err;
+    uint8_t digest[DIGEST_MAX_SIZE];
+};
+
+struct digest_lane {
+    uint8_t *buf;                   /* The message, padded to whole chunks. */
+    size_t pos;                     /* Offset of the next chunk. */
+    size_t blocks;                  /* Chunks left to hash. */
+    struct digest_result *res;      /* Where the digest goes, or nullptr when idle. */
+};
+
+/*
+ * Load res->name into the lane and pad it. Returns false if the file
+ * is not left in the lane: it could not be opened or read, or it was
+ * too large and has been hashed on the spot. Either way res holds the
+ * outcome.
+ */
+static inline bool digest_lane_load(const struct digest_algo *algo, struct digest_lane *lane,
+                                    struct digest_result *res, uint8_t *buf)
+{
+    res->err = 0;
+    int fd = STDIN_FILENO;
+    if (strcmp(res->name, "-") != 0 && (fd = open(res->name, O_RDONLY)) < 0) {
+        res->err = errno;
+        return false;
+    }
+
+    const ssize_t got = digest_read_full(fd, lane->buf, DIGEST_MB_MAX + 1);
+    const size_t len = got < 0 ? 0 : (size_t)got;
+    if (got < 0 || len > DIGEST_MB_MAX) {
+        union digest_ctx ctx;
+        algo->init(&ctx);
+        algo->update(&ctx, lane->buf, len);
+        if (got < 0 || !digest_fd(algo, &ctx, fd, (off_t)len, buf)) {
+            res->err = errno;
+        }
+        algo->final(&ctx, res->digest);
+        if (fd != STDIN_FILENO) {
+            close(fd);
+        }
+        return false;
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+
+    /* The 0x80 end marker, zeros, then the 64-bit size in bits. All
+     * the lane algorithms use 64-byte chunks. */
+    const size_t padded = (len + 8) / 64 * 64 + 64;
+    const uint64_t bits = (uint64_t)len * 8;
+    lane->buf[len] = 0x80;
+    memset(lane->buf + len + 1, 0, padded - len - 1);
+    for (int i = 0; i < 8; i++) {
+        lane->buf[padded - 8 + i] = (uint8_t)(bits >> (algo->mb_big_endian ? 56 - 8 * i : 8 * i));
+    }
+
+    lane->pos = 0;
+    lane->blocks = padded / 64;
+    lane->res = res;
+    return true;
+}
+
+/* The lanes of one thread, and its buffer for the files too large for them. */
+struct digest_lanes {
+    size_t n;                       /* 0 if the algorithm has no multi-lane kernel. */
+    digest_mb_fn mb;
+    struct digest_lane lane[DIGEST_MB_MAX_LANES];
+    uint32_t st[8][DIGEST_MB_MAX_LANES];
+    uint8_t *buf;
+};
+
+static inline void digest_lanes_init(const struct digest_algo *algo, struct digest_lanes *l, const char *app_name)
+{
+    l->n = algo->mb_select != nullptr ? algo->mb_select(&l->mb) : 0;
+    for (size_t i = 0; i < l->n; i++) {
+        /* Room for the largest file, padding, and the byte that shows it is too large. */
+        l->lane[i].buf = io_alloc(DIGEST_MB_MAX + 128, app_name);
+        l->lane[i].res = nullptr;
+    }
+    l->buf = io_alloc(DIGEST_BUF_SIZE, app_name);
+}
+
+static inline void digest_lanes_free(struct digest_lanes *l)
+{
+    for (size_t i = 0; i < l->n; i++) {
+        free(l->lane[i].buf);
+    }
+    free(l->buf);
+}
+
+/* Hash the n files of res[], the small ones of them one per lane. */
+static inline void digest_hash_batch(const struct digest_algo *algo, struct digest_lanes *l,
+                                     struct digest_result *const res[], const size_t n)
+{
+    if (l->n == 0 || n == 1) {
+        for (size_t i = 0; i < n; i++) {
+            res[i]->err = digest_file(algo, res[i]->name, res[i]->digest, l->buf) ? 0 : errno;
+        }
+        return;
+    }
+
+    size_t next = 0;
+    while (true) {
+        /* Refill the idle lanes. */
+        size_t active = 0;
+        for (size_t i = 0; i < l->n; i++) {
+            while (l->lane[i].res == nullptr && next < n) {
+                if (digest_lane_load(algo, &l->lane[i], res[next++], l->buf)) {
+                    for (int j = 0; j < algo->mb_regs; j++) {
+                        l->st[j][i] = algo->mb_init[j];
+                    }
+                }
+            }
+            active += l->lane[i].res != nullptr;
+        }
+        if (active == 0) {
+            break;
+        }
+
+        /* Run every lane for as long as the shortest message lasts.
+         * Idle lanes shadow a busy one. */
+        size_t blocks = SIZE_MAX;
+        const uint8_t *busy = nullptr;
+        for (size_t i = 0; i < l->n; i++) {
+            if (l->lane[i].res != nullptr) {
+                busy = l->lane[i].buf + l->lane[i].pos;
+                blocks = l->lane[i].blocks < blocks ? l->lane[i].blocks : blocks;
+            }
+        }
+        const uint8_t *data[DIGEST_MB_MAX_LANES];
+        for (size_t i = 0; i < l->n; i++) {
+            data[i] = l->lane[i].res != nullptr ? l->lane[i].buf + l->lane[i].pos : busy;
+        }
+        l->mb(l->st, data, blocks);
+
+        for (size_t i = 0; i < l->n; i++) {
+            struct digest_lane *lane = &l->lane[i];
+            if (lane->res == nullptr) {
+                continue;
+            }
+            lane->pos += blocks * 64;
+            lane->blocks -= blocks;
+            if (lane->blocks == 0) {
+                for (size_t k = 0; k < algo->size; k++) {
+                    const int shift = algo->mb_big_endian ? 24 - 8 * (k % 4) : 8 * (k % 4);
+                    lane->res->digest[k] = (uint8_t)(l->st[k / 4][i] >> shift);
+                }
+                lane->res = nullptr;
+            }
+        }
+    }
+}
+
+/* Options shared by the digest utilities. */
+struct digest_opts {
+    bool check;         /* Verify the checksum lists named by the operands. */
+    bool bsd_style;     /* Print 'ALGO (name) = digest' lines. */
+    bool quiet;         /* --check: leave out the OK lines. */
+    bool status;        /* --check: print no results, only set the exit status. */
+    bool progress;      /* --check: keep a count of the files checked on stderr. */
+    unsigned jobs;      /* Worker threads, or 0 to choose. */
+};
+
+/* Whether name must be escaped to survive a round trip through a checksum line. */
+static inline bool digest_needs_escape(const char *name)
+{
+    return strpbrk(name, "\\\n") != nullptr;
+}
+
+/* Print name, with backslash and newline escaped if escape is set. */
+static inline void digest_put_name(const char *name, const bool escape)
+{
+    if (!escape) {
+        fputs(name, stdout);
+        return;
+    }
+    for (const char *p = name; *p != '\0'; p++) {
+        if (*p == '\\') {
+            fputs("\\\\", stdout);
+        } else if (*p == '\n') {
+            fputs("\\n", stdout);
+        } else {
+            putchar(*p);
+        }
+    }
+}
+
+/*
+ * Print one line of output, or the reason there is none. As with GNU,
+ * a name holding a backslash or newline is escaped, and the line then
+ * starts with a backslash to say so.
+ */
+static inline bool digest_report(const struct digest_algo *algo, const struct digest_result *res,
+                                 const struct digest_opts *opts, const char *app_name)
+{
+    if (res->name[0] == '\0') {
+        fflush(stdout);
+        fprintf(stderr, "%s: invalid zero-length file name\n", app_name);
+        return false;
+    }
+    if (res->err != 0) {
+        fflush(stdout);
+        fprintf(stderr, "%s: %s: %s\n", app_name, res->name, strerror(res->err));
+        return false;
+    }
+
+    char hex[2 * DIGEST_MAX_SIZE + 1];
+    digest_hex(res->digest, algo->size, hex);
+    const bool escape = digest_needs_escape(res->name);
+    if (escape) {
+        putchar('\\');
+    }
+    if (opts->bsd_style) {
+        printf("%s (", algo->name);
+        digest_put_name(res->name, escape);
+        printf(") = %s\n", hex);
+    } else {
+        printf("%s  ", hex);
+        digest_put_name(res->name, escape);
+        putchar('\n');
+    }
+    return true;
+}
+
+/* Decode the 2 * size hex digits at hex into out. */
+static inline bool digest_unhex(const char *hex, const size_t size, uint8_t *out)
+{
+    for (size_t i = 0; i < 2 * size; i++) {
+        const char c = hex[i];
+        uint8_t v;
+        if (c >= '0' && c <= '9') {
+            v = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        out[i / 2] = i % 2 == 0 ? v << 4 : out[i / 2] | v;
+    }
+    return true;
+}
+
+/* Undo the escapes of digest_put_name in place. Returns false on any other escape. */
+static inline bool digest_unescape(char *s)
+{
+    char *out = s;
+    for (; *s != '\0'; s++) {
+        if (*s != '\\') {
+            *out++ = *s;
+        } else if (s[1] == '\\') {
+            *out++ = '\\';
+            s++;
+        } else if (s[1] == 'n') {
+            *out++ = '\n';
+            s++;
+        } else {
+            return false;
+        }
+    }
+    *out = '\0';
+    return true;
+}
+
+/*
+ * Parse one line of a checksum list: 'digest  name' or 'digest *name'
+ * as GNU writes it, or 'ALGO (name) = digest' as BSD does, either one
+ * escaped by a leading backslash. The expected digest goes to want.
+ * Returns the name, which is in line, or nullptr if the line is not
+ * a checksum line for algo.
+ */
+static inline char *digest_parse_line(const struct digest_algo *algo, char *line, uint8_t *want)
+{
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        line[--len] = '\0';
+    }
+    const bool escaped = line[0] == '\\';
+    if (escaped) {
+        line++;
+        len--;
+    }
+
+    const size_t hex_len = 2 * algo->size;
+    const size_t tag_len = strlen(algo->name);
+    char *name;
+    if (strncmp(line, algo->name, tag_len) == 0 && strncmp(line + tag_len, " (", 2) == 0) {
+        if (len < tag_len + 2 + 4 + hex_len || memcmp(line + len - hex_len - 4, ") = ", 4) != 0 ||
+            !digest_unhex(line + len - hex_len, algo->size, want)) {
+            return nullptr;
+        }
+        line[len - hex_len - 4] = '\0';
+        name = line + tag_len + 2;
+    } else {
+        if (len < hex_len + 3 || line[hex_len] != ' ' || (line[hex_len + 1] != ' ' && line[hex_len + 1] != '*') ||
+            !digest_unhex(line, algo->size, want)) {
+            return nullptr;
+        }
+        name = line + hex_len + 2;
+    }
+    if (escaped && !digest_unescape(name)) {
+        return nullptr;
+    }
+    return name[0] != '\0' ? name : nullptr;
+}
+
+/*
+ * Files are hashed on a pool of workers (pool.h), each with its own
+ * lanes. The main thread reads the names, or parses the checksum lists
+ * for --check, into the ring, and reports each entry in turn. A worker
+ * claims a batch of consecutive entries at once, which keeps its lanes
+ * full and the lock quiet when the files are small.
+ *
+ * The end of each checksum list, or its failure to open, is an entry
+ * too, so its warnings land after its own results.
+ */
+#define DIGEST_BATCH_PER_LANE 4     /* Files a worker claims at once, per lane. */
+#define DIGEST_MAX_BATCH (DIGEST_BATCH_PER_LANE * DIGEST_MB_MAX_LANES)
+#define DIGEST_BATCHES_PER_WORKER 4
+#define DIGEST_PENDING 1024         /* The ring without workers. */
+#define DIGEST_PROGRESS_NS (250 * 1000 * 1000)
+
+enum digest_entry_kind {
+    DIGEST_ENTRY_FILE,          /* Hash res.name, and with --check compare it with want. */
+    DIGEST_ENTRY_LIST_ERROR,    /* The list res.name could not be read, for res.err. */
+    DIGEST_ENTRY_LIST_END,      /* The end of the list res.name. */
+};
+
+struct digest_entry {
+    enum digest_entry_kind kind;
+    struct digest_result res;
+    uint8_t want[DIGEST_MAX_SIZE];
+    size_t valid;               /* LIST_END: the checksum lines in the list, */
+    size_t improper;            /* and the lines that were not. */
+};
+
+/* The checksum lists named on the command line. */
+struct digest_lists {
+    char *const *argv;
+    int argc;
+    const char *name;           /* The list being read, */
+    FILE *fp;                   /* or nullptr between lists. */
+    char *line;
+    size_t cap;
+    size_t valid;
+    size_t improper;
+};
+
+/* What the pool works through: the names, or with --check the lists. */
+struct digest_source {
+    const struct digest_algo *algo;
+    struct name_source *names;
+    struct digest_lists *lists;
+};
+
+/* Fill e with the next entry from the lists. Returns false at the end. */
+static inline bool digest_next_entry(const struct digest_algo *algo, struct digest_lists *src,
+                                     struct digest_entry *e, const char *app_name)
+{
+    e->res.owned = false;
+    e->res.err = 0;
+    while (true) {
+        if (src->fp == nullptr) {
+            if (src->argc == 0) {
+                return false;
+            }
+            src->argc--;
+            src->name = *src->argv++;
+            src->valid = src->improper = 0;
+            src->fp = strcmp(src->name, "-") == 0 ? stdin : fopen(src->name, "r");
+            if (src->fp == nullptr) {
+                e->kind = DIGEST_ENTRY_LIST_ERROR;
+                e->res.name = (char *)src->name;
+                e->res.err = errno;
+                return true;
+            }
+        }
+
+        errno = 0;
+        if (getline(&src->line, &src->cap, src->fp) == -1) {
+            e->res.err = ferror(src->fp) ? errno : 0;
+            if (src->fp == stdin) {
+                clearerr(stdin);
+            } else {
+                fclose(src->fp);
+            }
+            src->fp = nullptr;
+            e->kind = e->res.err != 0 ? DIGEST_ENTRY_LIST_ERROR : DIGEST_ENTRY_LIST_END;
+            e->res.name = (char *)src->name;
+            e->valid = src->valid;
+            e->improper = src->improper;
+            return true;
+        }
+        if (src->line[0] == '#') {
+            continue;
+        }
+        const char *name = digest_parse_line(algo, src->line, e->want);
+        if (name == nullptr) {
+            src->improper++;
+            continue;
+        }
+        src->valid++;
+
+        e->kind = DIGEST_ENTRY_FILE;
+        e->res.name = strdup(name);
+        if (e->res.name == nullptr) {
+            fprintf(stderr, "%s: unable to allocate memory!\n", app_name);
+            exit(EXIT_FAILURE);
+        }
+        e->res.owned = true;
+        return true;
+    }
+}
+
+static inline bool digest_next_job(struct pool *p, void *job)
+{
+    const struct digest_source *src = p->arg;
+    struct digest_entry *e = job;
+    if (src->lists != nullptr) {
+        return digest_next_entry(src->algo, src->lists, e, p->app_name);
+    }
+    e->kind = DIGEST_ENTRY_FILE;
+    e->res.err = 0;
+    e->res.name = names_next(src->names, &e->res.owned, p->app_name);
+    return e->res.name != nullptr;
+}
+
+/* Hash the files among the n entries of the ring from first on. n is
+ * at most p->batch. */
+static inline void digest_run_entries(struct pool *p, void *state, const size_t first, const size_t n)
+{
+    const struct digest_source *src = p->arg;
+    struct digest_result *res[DIGEST_MAX_BATCH];
+    size_t files = 0;
+    for (size_t i = 0; i < n; i++) {
+        struct digest_entry *e = pool_job(p, first + i);
+        if (e->kind != DIGEST_ENTRY_FILE) {
+            continue;
+        }
+        if (e->res.name[0] == '\0') {
+            e->res.err = ENOENT;
+        } else {
+            res[files++] = &e->res;
+        }
+    }
+    digest_hash_batch(src->algo, state, res, files);
+}
+
+static inline void *digest_enter(struct pool *p)
+{
+    const struct digest_source *src = p->arg;
+    struct digest_lanes *l = malloc(sizeof(*l));
+    if (l == nullptr) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", p->app_name);
+        exit(EXIT_FAILURE);
+    }
+    digest_lanes_init(src->algo, l, p->app_name);
+    return l;
+}
+
+static inline void digest_leave(struct pool *p, void *state)
+{
+    (void)p;
+    digest_lanes_free(state);
+    free(state);
+}
+
+/* Print "name: result", escaping the name as digest_report does. */
+static inline void digest_check_line(const char *name, const char *result)
+{
+    const bool escape = digest_needs_escape(name);
+    if (escape) {
+        putchar('\\');
+    }
+    digest_put_name(name, escape);
+    printf(": %s\n", result);
+}
+
+/* Print the count of files checked, at most every DIGEST_PROGRESS_NS unless final is set. */
+static inline void digest_progress(const size_t checked, const bool final, struct timespec *last,
+                                   const char *app_name)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const int64_t ns = (int64_t)(now.tv_sec - last->tv_sec) * 1000000000 + (now.tv_nsec - last->tv_nsec);
+    if (!final && ns < DIGEST_PROGRESS_NS) {
+        return;
+    }
+    *last = now;
+    fflush(stdout);
+    fprintf(stderr, "\r%s: %zu file%s checked%s", app_name, checked, checked == 1 ? "" : "s", final ? "\n" : "");
+}
+
+/* What --check has found so far. */
+struct digest_tally {
+    size_t checked;
+    size_t unreadable;          /* For the list being reported. */
+    size_t mismatched;
+    struct timespec last;       /* When the progress count was printed. */
+};
+
+/* Report one entry of --check. Returns false if it fails the check. */
+static inline bool digest_check_report(const struct digest_algo *algo, const struct digest_entry *e,
+                                       const struct digest_opts *opts, struct digest_tally *t,
+                                       const char *app_name)
+{
+    const char *name = e->res.name;
+    bool ok = true;
+    switch (e->kind) {
+        case DIGEST_ENTRY_FILE:
+            t->checked++;
+            if (e->res.err != 0) {
+                t->unreadable++;
+                fflush(stdout);
+                fprintf(stderr, "%s: %s: %s\n", app_name, name, strerror(e->res.err));
+                if (!opts->status) {
+                    digest_check_line(name, "FAILED open or read");
+                }
+            } else if (memcmp(e->res.digest, e->want, algo->size) != 0) {
+                t->mismatched++;
+                if (!opts->status) {
+                    digest_check_line(name, "FAILED");
+                }
+            } else if (!opts->quiet && !opts->status) {
+                digest_check_line(name, "OK");
+            }
+            if (opts->progress) {
+                digest_progress(t->checked, false, &t->last, app_name);
+            }
+            break;
+        case DIGEST_ENTRY_LIST_ERROR:
+            fflush(stdout);
+            fprintf(stderr, "%s: %s: %s\n", app_name, name, strerror(e->res.err));
+            ok = false;
+            t->unreadable = t->mismatched = 0;
+            break;
+        case DIGEST_ENTRY_LIST_END:
+            if (e->valid == 0) {
+                fflush(stdout);
+                fprintf(stderr, "%s: %s: no properly formatted checksum lines found\n", app_name, name);
+                ok = false;
+            } else if (!opts->status) {
+                fflush(stdout);
+                if (e->improper > 0) {
+                    fprintf(stderr, "%s: WARNING: %zu line%s improperly formatted\n", app_name,
+                            e->improper, e->improper == 1 ? " is" : "s are");
+                }
+                if (t->unreadable > 0) {
+                    fprintf(stderr, "%s: WARNING: %zu listed file%s could not be read\n", app_name,
+                            t->unreadable, t->unreadable == 1 ? "" : "s");
+                }
+                if (t->mismatched > 0) {
+                    fprintf(stderr, "%s: WARNING: %zu computed checksum%s did NOT match\n", app_name,
+                            t->mismatched, t->mismatched == 1 ? "" : "s");
+                }
+            }
+            if (t->unreadable > 0 || t->mismatched > 0) {
+                ok = false;
+            }
+            t->unreadable = t->mismatched = 0;
+            break;
+    }
+    return ok;
+}
+
+/*
+ * Hash and report every file from names, or with lists set verify
+ * every checksum list in it. Returns the exit status.
+ */
+static inline int digest_run(const struct digest_algo *algo, struct name_source *names,
+                             struct digest_lists *lists, const struct digest_opts *opts,
+                             const char *app_name)
+{
+    const size_t files = lists == nullptr && names->files0 == nullptr ? (size_t)names->argc : SIZE_MAX;
+
+    /* The kernels are picked on first use, which is not thread safe. */
+    (void)cpu_features();
+    struct digest_lanes l;
+    digest_lanes_init(algo, &l, app_name);
+
+    struct digest_source src = { .algo = algo, .names = names, .lists = lists };
+    struct pool pool = {
+        .job_size = sizeof(struct digest_entry),
+        .batch = DIGEST_BATCH_PER_LANE * (l.n > 0 ? l.n : 1),
+        .next = digest_next_job,
+        .run = digest_run_entries,
+        .enter = digest_enter,
+        .leave = digest_leave,
+        .arg = &src,
+        .app_name = app_name
+    };
+    pool_start(&pool, pool_workers(opts->jobs, files), DIGEST_BATCHES_PER_WORKER, DIGEST_PENDING, &l);
+
+    int status = EXIT_SUCCESS;
+    struct digest_tally tally = { 0 };
+    struct digest_entry *e;
+    while ((e = pool_take(&pool)) != nullptr) {
+        const bool ok = lists != nullptr ? digest_check_report(algo, e, opts, &tally, app_name)
+                                         : digest_report(algo, &e->res, opts, app_name);
+        if (!ok) {
+            status = EXIT_FAILURE;
+        }
+        if (e->res.owned) {
+            free(e->res.name);
+        }
+    }
+    if (lists != nullptr && opts->progress) {
+        digest_progress(tally.checked, true, &tally.last, app_name);
+    }
+
+    pool_stop(&pool);
+    digest_lanes_free(&l);
+    return status;
+}
+
+/*
+ * Hash the operands, or the files named in files0_from if that is set,
+ * or stdin if neither names any; or with opts->check verify the
+ * checksum lists named by the operands, or stdin.
+ */
+static inline int digest_main(const struct digest_algo *algo, char *const argv[], const int argc,
+                              const char *files0_from, const struct digest_opts *opts, const char *app_name)
+{
+    static char *const std_in[] = { "-" };
+    if (opts->check) {
+        if (files0_from != nullptr) {
+            fprintf(stderr, "%s: --files0-from cannot be combined with --check\n", app_name);
+            return EXIT_FAILURE;
+        }
+        struct digest_lists lists = { .argv = argc > 0 ? argv : std_in, .argc = argc > 0 ? argc : 1 };
+        const int status = digest_run(algo, nullptr, &lists, opts, app_name);
+        free(lists.line);
+        return status;
+    }
+    if (opts->quiet || opts->status || opts->progress) {
+        fprintf(stderr, "%s: --quiet, --status and --progress only apply to --check\n", app_name);
+        return EXIT_FAILURE;
+    }
+
+    struct name_source src = { .argv = argc > 0 ? argv : std_in, .argc = argc > 0 ? argc : 1 };
+    if (files0_from == nullptr) {
+        return digest_run(algo, &src, nullptr, opts, app_name);
+    }
+
+    if (argc > 0) {
+        fprintf(stderr, "%s: file operands cannot be combined with --files0-from\n", app_name);
+        return EXIT_FAILURE;
+    }
+    if (!names_open_files0(&src, files0_from, app_name)) {
+        return EXIT_FAILURE;
+    }
+
+    const int status = digest_run(algo, &src, nullptr, opts, app_name);
+    names_close(&src);
+    return status;
+}
+
+#endif /* DIGEST_H */
@@ -43,6 +43,7 @@ int main(int argc, char *argv[]) {
     const struct option longopts[] = {
         {.name = "help",    .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -63,6 +64,9 @@ int main(int argc, char *argv[]) {
                  /* getopt_long prints own error message */
                 return EXIT_FAILURE;
                 break;
+            case STATS_OPT:
+                 stats_enable(APP_NAME);
+                 break;
             case '?':
                  /* getopt_long prints own error message */
                 return EXIT_FAILURE;
@@ -73,7 +77,7 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    if (argc == 1) {
+    if (argc == optind) {
         show_help();
         return EXIT_FAILURE;
     }
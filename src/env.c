@@ -63,6 +63,7 @@ int main(const int argc, char *argv[])
         {.name = "unset",   .has_arg = 0, .flag = nullptr, .val = 'u'},
         {.name = "help",    .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -95,6 +96,7 @@ int main(const int argc, char *argv[])
                        __DATE__, __TIME__);
                 return EXIT_SUCCESS;
             case 'h': show_help(); return EXIT_SUCCESS;
+            case STATS_OPT: stats_enable(APP_NAME); break;
             default : show_help(); return EXIT_FAILURE;
         }
     }
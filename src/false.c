@@ -44,6 +44,7 @@ int main(const int argc, char *argv[])
     const struct option longopts[] = {
         {.name = "help",    .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -61,6 +62,9 @@ int main(const int argc, char *argv[])
                 show_help();
                 return EXIT_SUCCESS;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
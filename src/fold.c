@@ -25,6 +25,7 @@
 #include <stdlib.h>
 
 #include "common.h"
+#include "io.h"
 
 
 static const char *APP_NAME = "fold";
@@ -50,77 +51,34 @@ Options:\n\
 Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 }
 
-static FILE* open_file(char *file) {
-    errno = 0;
-    FILE *fp = fopen(file, "r");
-    if (!fp) {
-        fprintf(stderr, "%s: unable to open %s: %s", APP_NAME, file, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    return fp;
-}
+static struct io_writer out;
 
-static char* alloc_char_buffer() {
-    char *buf = malloc(opts.width + 1);
-    if (!buf) {
-        fprintf(stderr, "%s: unable to allocate memory!\n", APP_NAME);
-        exit(EXIT_FAILURE);
-    }
-    return buf;
-}
+/* Bytes and chars fold the same until multibyte support is added. */
+static void fold_file(char *file) {
+    struct io_reader in;
 
-static uint8_t* alloc_byte_buffer() {
-    uint8_t *buf = malloc(opts.width);
-    if (!buf) {
-        fprintf(stderr, "%s: unable to allocate memory!\n", APP_NAME);
+    if (!io_open(&in, file, APP_NAME)) {
+        fprintf(stderr, "%s: unable to open %s: %s", APP_NAME, file, strerror(errno));
         exit(EXIT_FAILURE);
     }
-    return buf;
-}
-
-static void fold_on_bytes(char *file) {
-    uint8_t *buf = alloc_byte_buffer();
-    FILE *fp;
-
-    if (*file == 0x2D) {
-        fp = stdin;
-    } else {
-        fp = open_file(file);
-    }
 
-    int c = '\0';
-    while (c != EOF) {
-        for (int i = 0; i < opts.width; i++) {
-            c = fgetc(fp);
-            if (c == EOF) break;
-            putc(c, stdout);
-            if (c == 10) break;
-        }
-        if (c != 10) {
-            putc(10, stdout);
+    /* Emit each line in pieces of at most opts.width
+     * bytes, ending every piece with a newline. */
+    const uint8_t *line;
+    size_t len;
+    while ((len = io_getline(&in, &line)) > 0) {
+        while (len > 0) {
+            const size_t n = len < opts.width ? len : opts.width;
+            io_write(&out, line, n);
+            if (line[n - 1] != '\n') {
+                io_putc(&out, '\n');
+            }
+            line += n;
+            len -= n;
         }
     }
 
-    fclose(fp);
-    free(buf);
-}
-
-static void fold_on_chars(char *file) {
-    char *buf = alloc_char_buffer();
-    FILE *fp;
-
-    if (*file == 0x2D) {
-        fp = stdin;
-    } else {
-        fp = open_file(file);
-    }
-
-    while (fgets(buf, opts.width + 1, fp) != NULL) {
-        printf("%s%s", buf, strchr(buf, '\n') != NULL ? "" : "\n");
-    }
-
-    fclose(fp);
-    free(buf);
+    io_close(&in);
 }
 
 int main(const int argc, char *argv[])
@@ -131,6 +89,7 @@ int main(const int argc, char *argv[])
         { .name = "width",   .has_arg = required_argument, .flag = nullptr, .val = 'w' },
         { .name = "chars",   .has_arg = no_argument,       .flag = nullptr, .val = 'c' },
         { .name = "bytes",   .has_arg = no_argument,       .flag = nullptr, .val = 'b' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -161,28 +120,26 @@ int main(const int argc, char *argv[])
             case 'w':
                 opts.width = (uint8_t)parse_numeric_arg(optarg, min, max, APP_NAME);
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
         }
     }
 
-    if (argc == optind || strcmp(argv[optind], "-") == 0) {  /* no file arguments */
-        if (opts.chars) {
-            fold_on_chars("-");
-        } else {
-            fold_on_bytes("-");
-        }
-        return EXIT_SUCCESS;
+    io_writer_fd(&out, STDOUT_FILENO, false, APP_NAME);
+
+    if (argc == optind) {  /* no file arguments */
+        fold_file("-");
     }
 
     while (optind < argc) {
-        if (opts.chars) {
-            fold_on_chars(argv[optind++]);
-        } else {
-            fold_on_bytes(argv[optind++]);
-        }
+        fold_file(argv[optind++]);
     }
 
+    io_writer_close(&out);
+
     return EXIT_SUCCESS;
 }
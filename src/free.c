@@ -345,6 +345,7 @@ int main(const int argc, char *argv[])
     static const struct option long_opts[] = {
         { .name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h' },
         { .name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
     
@@ -385,6 +386,9 @@ int main(const int argc, char *argv[])
         case 'h':
             showHelp();
             return EXIT_SUCCESS;
+        case STATS_OPT:
+            stats_enable(APP_NAME);
+            break;
         default:
             showHelp();
             return EXIT_FAILURE;
@@ -24,6 +24,7 @@
 #include <grp.h>
 
 #include "common.h"
+#include "idcache.h"
 
 /* Linux getgrouplist wants a gid_t,
  * stupid macOS wants an int. */
@@ -54,6 +55,7 @@ int main(const int argc, char *argv[])
     const struct option long_opts[] = {
         {.name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0}
     };
 
@@ -69,6 +71,9 @@ int main(const int argc, char *argv[])
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
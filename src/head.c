@@ -24,8 +24,7 @@
 #include <sys/fcntl.h>
 
 #include "common.h"
-
-#define MAX_LINE_LENGTH 2048
+#include "io.h"
 
 static const char *APP_NAME =  "head";
 
@@ -53,51 +52,60 @@ Options:\n\
 Report bugs to <bulliver@gmail.com>\n", APP_NAME);
 }
 
+static struct io_writer out;
+
 static int head_bytes(char *filename, const long int n_bytes)
 {
     if (opts.verbose) {
-        printf("==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
+        io_printf(&out, "==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
     }
 
-    FILE *fd = fopen(filename, "r");
-    if (fd == NULL) {
+    struct io_reader in;
+    if (!io_open(&in, filename, APP_NAME)) {
         fprintf(stderr, "Unable to open '%s': %s\n", filename, strerror(errno));
         return EXIT_FAILURE;
     }
 
-    for (long int i = 0; i < n_bytes; i++) {
-        const int ch = fgetc(fd);
-        if (ch == EOF) {
-            return EXIT_SUCCESS;
+    const uint8_t *buf;
+    size_t len;
+    long int remaining = n_bytes;
+    while (remaining > 0 && (len = io_read(&in, &buf)) > 0) {
+        if ((long int)len > remaining) {
+            len = remaining;
         }
-        printf("%c", ch);
+        io_write(&out, buf, len);
+        remaining -= len;
     }
-    printf("\n");
-    fclose(fd);
+    io_close(&in);
     return EXIT_SUCCESS;
 }
 
 static int head_lines(char *filename, long int n_lines)
 {
     if (opts.verbose) {
-        printf("==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
+        io_printf(&out, "==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
     }
 
-    FILE *fd = fopen(filename, "r");
-    if (!fd) {
+    struct io_reader in;
+    if (!io_open(&in, filename, APP_NAME)) {
         fprintf(stderr, "Unable to open '%s': %s\n", filename, strerror(errno));
         return EXIT_FAILURE;
     }
 
-    char buffer[MAX_LINE_LENGTH];
-    while (fgets(buffer, sizeof(buffer), fd) != NULL) {
-        if (n_lines == 0) {
-            return EXIT_SUCCESS;
+    /* Find the n_lines'th newline in each block, and
+     * write everything up to it in a single piece. */
+    const uint8_t *buf;
+    size_t len;
+    while (n_lines > 0 && (len = io_read(&in, &buf)) > 0) {
+        const uint8_t *p = buf;
+        const uint8_t *end = buf + len;
+        while (n_lines > 0 && (p = memchr(p, '\n', end - p)) != nullptr) {
+            p++;
+            n_lines--;
         }
-        printf("%s", buffer);
-        n_lines--;
+        io_write(&out, buf, n_lines > 0 ? len : (size_t)(p - buf));
     }
-    fclose(fd);
+    io_close(&in);
     return EXIT_SUCCESS;
 }
 
@@ -111,6 +119,7 @@ int main(const int argc, char *argv[]) {
         {.name = "bytes",   .has_arg = required_argument, .flag = nullptr, .val = 'b'},
         {.name = "quiet",   .has_arg = no_argument,       .flag = nullptr, .val = 'q'},
         {.name = "verbose", .has_arg = no_argument,       .flag = nullptr, .val = 'v'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = no_argument,       .flag = nullptr, .val = 0}
     };
 
@@ -146,6 +155,9 @@ int main(const int argc, char *argv[]) {
         opts.bytes = 1;
         n_units = strtol(optarg, nullptr, 10);
         break;
+      case STATS_OPT:
+        stats_enable(APP_NAME);
+        break;
       default:
         show_help();
         return EXIT_FAILURE;
@@ -166,6 +178,8 @@ int main(const int argc, char *argv[]) {
         }
     }
 
+    io_writer_fd(&out, STDOUT_FILENO, false, APP_NAME);
+
     for (; optind < argc; optind++) {
         if (opts.bytes) {
             head_bytes(argv[optind], n_units);
@@ -173,5 +187,6 @@ int main(const int argc, char *argv[]) {
             head_lines(argv[optind], n_units);
         }
     }
+    io_writer_close(&out);
     return EXIT_SUCCESS;
 }
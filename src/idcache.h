@@ -0,0 +1,329 @@
+/***************************************************************************
+ *   idcache.h - memoized user and group name lookups                      *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef IDCACHE_H
+#define IDCACHE_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+/*
+ * ls -l, ps and stat print an owner on every line, and each getpwuid()
+ * may be a network round trip when NSS is backed by LDAP or SSSD. Every
+ * answer, including "no such user", is kept for the life of the process
+ * so that each distinct id or name is looked up once.
+ *
+ * With ULL_IDCACHE=files the cache is first filled from /etc/passwd and
+ * /etc/group in one pass; only ids missing from those go through NSS.
+ */
+
+#define IDCACHE_MIN_SLOTS 64
+
+/* A name of nullptr records a failed lookup. */
+struct id_slot {
+    char *name;
+    uint32_t id;
+    bool used;
+};
+
+struct name_slot {
+    char *name;
+    uint32_t id;
+    bool found;
+};
+
+struct id_table {
+    struct id_slot *slots;
+    size_t cap;
+    size_t count;
+};
+
+struct name_table {
+    struct name_slot *slots;
+    size_t cap;
+    size_t count;
+};
+
+static struct {
+    struct id_table users;
+    struct id_table groups;
+    struct name_table user_names;
+    struct name_table group_names;
+    bool loaded;
+} idcache;
+
+static inline void *idcache_calloc(const size_t n, const size_t size)
+{
+    void *p = calloc(n, size);
+    if (p == nullptr) {
+        fprintf(stderr, "idcache: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static inline char *idcache_strdup(const char *s)
+{
+    char *p = strdup(s);
+    if (p == nullptr) {
+        fprintf(stderr, "idcache: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static inline size_t idcache_hash_id(const uint32_t id)
+{
+    return (size_t)(id * 0x9e3779b1u);
+}
+
+/* FNV-1a */
+static inline size_t idcache_hash_name(const char *name)
+{
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Return the slot for 'id': either the cached entry or the empty slot to fill. */
+static inline struct id_slot *id_table_slot(const struct id_table *t, const uint32_t id)
+{
+    size_t i = idcache_hash_id(id) & (t->cap - 1);
+    while (t->slots[i].used && t->slots[i].id != id) {
+        i = (i + 1) & (t->cap - 1);
+    }
+    return &t->slots[i];
+}
+
+static inline struct name_slot *name_table_slot(const struct name_table *t, const char *name)
+{
+    size_t i = idcache_hash_name(name) & (t->cap - 1);
+    while (t->slots[i].name != nullptr && strcmp(t->slots[i].name, name) != 0) {
+        i = (i + 1) & (t->cap - 1);
+    }
+    return &t->slots[i];
+}
+
+/* Keep the tables at most 3/4 full, so that probes stay short. */
+static inline void id_table_reserve(struct id_table *t)
+{
+    if (t->slots != nullptr && (t->count + 1) * 4 <= t->cap * 3) {
+        return;
+    }
+
+    const struct id_table old = *t;
+    t->cap = old.cap ? old.cap * 2 : IDCACHE_MIN_SLOTS;
+    t->slots = idcache_calloc(t->cap, sizeof(*t->slots));
+    for (size_t i = 0; i < old.cap; i++) {
+        if (old.slots[i].used) {
+            *id_table_slot(t, old.slots[i].id) = old.slots[i];
+        }
+    }
+    free(old.slots);
+}
+
+static inline void name_table_reserve(struct name_table *t)
+{
+    if (t->slots != nullptr && (t->count + 1) * 4 <= t->cap * 3) {
+        return;
+    }
+
+    const struct name_table old = *t;
+    t->cap = old.cap ? old.cap * 2 : IDCACHE_MIN_SLOTS;
+    t->slots = idcache_calloc(t->cap, sizeof(*t->slots));
+    for (size_t i = 0; i < old.cap; i++) {
+        if (old.slots[i].name != nullptr) {
+            *name_table_slot(t, old.slots[i].name) = old.slots[i];
+        }
+    }
+    free(old.slots);
+}
+
+/* Record an answer. The first entry for an id or name wins, as with getpwuid(). */
+static inline void id_table_add(struct id_table *t, const uint32_t id, const char *name)
+{
+    id_table_reserve(t);
+    struct id_slot *s = id_table_slot(t, id);
+    if (s->used) {
+        return;
+    }
+    s->used = true;
+    s->id = id;
+    s->name = name ? idcache_strdup(name) : nullptr;
+    t->count++;
+}
+
+static inline void name_table_add(struct name_table *t, const char *name,
+                                  const uint32_t id, const bool found)
+{
+    name_table_reserve(t);
+    struct name_slot *s = name_table_slot(t, name);
+    if (s->name != nullptr) {
+        return;
+    }
+    s->name = idcache_strdup(name);
+    s->id = id;
+    s->found = found;
+    t->count++;
+}
+
+/*
+ * Add every 'name:passwd:id:...' line of 'path' to both tables.
+ * A missing or unreadable file just leaves the work to NSS.
+ */
+static inline void idcache_load_file(const char *path, struct id_table *ids,
+                                     struct name_table *names)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return;
+    }
+
+    char *line = nullptr;
+    size_t cap = 0;
+    while (getline(&line, &cap, fp) != -1) {
+        if (line[0] == '#' || line[0] == '+' || line[0] == '-') {
+            continue;
+        }
+        char *pw = strchr(line, ':');
+        char *id_s = pw ? strchr(pw + 1, ':') : nullptr;
+        if (id_s == nullptr || pw == line) {
+            continue;
+        }
+        *pw = '\0';
+
+        char *end;
+        errno = 0;
+        const unsigned long id = strtoul(id_s + 1, &end, 10);
+        if (errno != 0 || end == id_s + 1 || *end != ':' || id > UINT32_MAX) {
+            continue;
+        }
+        id_table_add(ids, (uint32_t)id, line);
+        name_table_add(names, line, (uint32_t)id, true);
+    }
+    free(line);
+    fclose(fp);
+}
+
+static inline void idcache_init(void)
+{
+    if (idcache.loaded) {
+        return;
+    }
+    idcache.loaded = true;
+
+    const char *mode = getenv("ULL_IDCACHE");
+    if (mode != nullptr && strcmp(mode, "files") == 0) {
+        idcache_load_file("/etc/passwd", &idcache.users, &idcache.user_names);
+        idcache_load_file("/etc/group", &idcache.groups, &idcache.group_names);
+    }
+}
+
+static inline const char *get_username(const uid_t uid)
+{
+    idcache_init();
+    if (idcache.users.slots != nullptr) {
+        const struct id_slot *s = id_table_slot(&idcache.users, uid);
+        if (s->used) {
+            return s->name ? s->name : "unknown username";
+        }
+    }
+
+    errno = 0;
+    const struct passwd *pwd = getpwuid(uid);
+    if (pwd == nullptr && errno != 0) {
+        fprintf(stderr, "username lookup failed");
+        exit(EXIT_FAILURE);
+    }
+
+    id_table_add(&idcache.users, uid, pwd ? pwd->pw_name : nullptr);
+    return pwd ? id_table_slot(&idcache.users, uid)->name : "unknown username";
+}
+
+static inline const char *get_groupname(const gid_t gid)
+{
+    idcache_init();
+    if (idcache.groups.slots != nullptr) {
+        const struct id_slot *s = id_table_slot(&idcache.groups, gid);
+        if (s->used) {
+            return s->name ? s->name : "unknown group name";
+        }
+    }
+
+    errno = 0;
+    const struct group *grp = getgrgid(gid);
+    if (grp == nullptr && errno != 0) {
+        fprintf(stderr, "group name lookup failed");
+        exit(EXIT_FAILURE);
+    }
+
+    id_table_add(&idcache.groups, gid, grp ? grp->gr_name : nullptr);
+    return grp ? id_table_slot(&idcache.groups, gid)->name : "unknown group name";
+}
+
+/* Resolve a user name to its uid. Returns false if there is no such user. */
+static inline bool get_uid(const char *name, uid_t *uid)
+{
+    idcache_init();
+    if (idcache.user_names.slots != nullptr) {
+        const struct name_slot *s = name_table_slot(&idcache.user_names, name);
+        if (s->name != nullptr) {
+            *uid = s->id;
+            return s->found;
+        }
+    }
+
+    const struct passwd *pwd = getpwnam(name);
+    name_table_add(&idcache.user_names, name, pwd ? pwd->pw_uid : 0, pwd != nullptr);
+    if (pwd == nullptr) {
+        return false;
+    }
+    *uid = pwd->pw_uid;
+    return true;
+}
+
+/* Resolve a group name to its gid. Returns false if there is no such group. */
+static inline bool get_gid(const char *name, gid_t *gid)
+{
+    idcache_init();
+    if (idcache.group_names.slots != nullptr) {
+        const struct name_slot *s = name_table_slot(&idcache.group_names, name);
+        if (s->name != nullptr) {
+            *gid = s->id;
+            return s->found;
+        }
+    }
+
+    const struct group *grp = getgrnam(name);
+    name_table_add(&idcache.group_names, name, grp ? grp->gr_gid : 0, grp != nullptr);
+    if (grp == nullptr) {
+        return false;
+    }
+    *gid = grp->gr_gid;
+    return true;
+}
+
+#endif /* IDCACHE_H */
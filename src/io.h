@@ -0,0 +1,534 @@
+/***************************************************************************
+ *   io.h - block-buffered reader and writer for the data-path tools       *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef IO_H
+#define IO_H
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "common.h"
+
+/* Size and alignment of the reader and writer buffers. */
+#define IO_BUF_SIZE  (128 * 1024)
+#define IO_BUF_ALIGN 4096
+
+/* Writes at least this large bypass the write buffer. */
+#define IO_DIRECT_MIN (IO_BUF_SIZE / 2)
+
+struct io_reader {
+    int fd;
+    uint8_t *buf;
+    size_t cap;    /* Grows to hold lines longer than IO_BUF_SIZE. */
+    size_t pos;    /* Start of the unconsumed bytes. */
+    size_t len;    /* End of the valid bytes. */
+    bool eof;
+    const char *app_name;
+};
+
+struct io_writer {
+    int fd;
+    uint8_t *buf;
+    size_t len;
+    bool unbuffered;
+    const char *app_name;
+};
+
+static inline void *io_alloc(const size_t size, const char *app_name)
+{
+    void *p = nullptr;
+    if (posix_memalign(&p, IO_BUF_ALIGN, size) != 0) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", app_name);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* Set up a reader on an open descriptor. */
+static inline void io_reader_fd(struct io_reader *r, const int fd, const char *app_name)
+{
+    r->fd = fd;
+    r->buf = io_alloc(IO_BUF_SIZE, app_name);
+    r->cap = IO_BUF_SIZE;
+    r->pos = 0;
+    r->len = 0;
+    r->eof = false;
+    r->app_name = app_name;
+}
+
+/* Open path for reading, "-" being stdin. Returns false
+ * with errno set if the file cannot be opened. */
+static inline bool io_open(struct io_reader *r, const char *path, const char *app_name)
+{
+    int fd = STDIN_FILENO;
+    if (strcmp(path, "-") != 0) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+    }
+    io_reader_fd(r, fd, app_name);
+    return true;
+}
+
+static inline void io_close(struct io_reader *r)
+{
+    if (r->fd != STDIN_FILENO) {
+        close(r->fd);
+    }
+    free(r->buf);
+    r->buf = nullptr;
+}
+
+/* Read more data after the valid bytes. Returns the number
+ * of bytes added, or 0 at end of file. Exits on error. */
+static inline size_t io_fill(struct io_reader *r)
+{
+    if (r->eof) {
+        return 0;
+    }
+
+    ssize_t n;
+    do {
+        n = read(r->fd, r->buf + r->len, r->cap - r->len);
+        io_counters.reads++;
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        fprintf(stderr, "%s: read error: %s\n", r->app_name, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (n == 0) {
+        r->eof = true;
+        return 0;
+    }
+    r->len += n;
+    io_counters.bytes_read += n;
+    return n;
+}
+
+/* Point *data at the next run of unread bytes, and return its length,
+ * or 0 at end of file. The bytes are consumed and are valid until the
+ * next call on the reader. */
+static inline size_t io_read(struct io_reader *r, const uint8_t **data)
+{
+    if (r->pos == r->len) {
+        r->pos = r->len = 0;
+        if (io_fill(r) == 0) {
+            return 0;
+        }
+    }
+    *data = r->buf + r->pos;
+    const size_t n = r->len - r->pos;
+    r->pos = r->len;
+    return n;
+}
+
+/* Point *line at the next line, and return its length including the
+ * newline, or 0 at end of file. The last line may lack a newline. The
+ * line is valid until the next call on the reader. */
+static inline size_t io_getline(struct io_reader *r, const uint8_t **line)
+{
+    size_t scanned = r->pos;
+
+    while (true) {
+        const uint8_t *nl = memchr(r->buf + scanned, '\n', r->len - scanned);
+        if (nl) {
+            const size_t end = nl - r->buf + 1;
+            *line = r->buf + r->pos;
+            const size_t n = end - r->pos;
+            r->pos = end;
+            return n;
+        }
+        scanned = r->len;
+
+        if (r->eof) {
+            break;
+        }
+
+        /* No newline in the buffer. Slide the partial line to
+         * the front, growing the buffer if it already fills it. */
+        if (r->pos > 0) {
+            memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+            r->len -= r->pos;
+            scanned -= r->pos;
+            r->pos = 0;
+        } else if (r->len == r->cap) {
+            uint8_t *grown = realloc(r->buf, r->cap * 2);
+            if (!grown) {
+                fprintf(stderr, "%s: unable to allocate memory!\n", r->app_name);
+                exit(EXIT_FAILURE);
+            }
+            r->buf = grown;
+            r->cap *= 2;
+        }
+        io_fill(r);
+    }
+
+    /* A final line without a newline. */
+    *line = r->buf + r->pos;
+    const size_t n = r->len - r->pos;
+    r->pos = r->len = 0;
+    return n;
+}
+
+static inline void io_writer_fd(struct io_writer *w, const int fd, const bool unbuffered, const char *app_name)
+{
+    w->fd = fd;
+    w->buf = io_alloc(IO_BUF_SIZE, app_name);
+    w->len = 0;
+    w->unbuffered = unbuffered;
+    w->app_name = app_name;
+}
+
+/* Write out iov[0..cnt), retrying short writes. Exits on error. */
+static inline void io_writev_all(const struct io_writer *w, struct iovec *iov, int cnt)
+{
+    while (cnt > 0) {
+        const ssize_t n = writev(w->fd, iov, cnt);
+        io_counters.writes++;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "%s: write error: %s\n", w->app_name, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        io_counters.bytes_written += n;
+        size_t done = n;
+        while (cnt > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+}
+
+static inline void io_flush(struct io_writer *w)
+{
+    if (w->len > 0) {
+        struct iovec iov = { .iov_base = w->buf, .iov_len = w->len };
+        io_writev_all(w, &iov, 1);
+        w->len = 0;
+    }
+}
+
+static inline void io_write(struct io_writer *w, const void *data, const size_t len)
+{
+    if (len >= IO_DIRECT_MIN) {
+        /* Large writes go straight out, together with anything
+         * already buffered, rather than being copied first. */
+        struct iovec iov[2] = {
+            { .iov_base = w->buf,       .iov_len = w->len },
+            { .iov_base = (void *)data, .iov_len = len }
+        };
+        if (w->len > 0) {
+            io_writev_all(w, iov, 2);
+        } else {
+            io_writev_all(w, iov + 1, 1);
+        }
+        w->len = 0;
+        return;
+    }
+
+    if (len > IO_BUF_SIZE - w->len) {
+        io_flush(w);
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+
+    if (w->unbuffered) {
+        io_flush(w);
+    }
+}
+
+static inline void io_putc(struct io_writer *w, const uint8_t c)
+{
+    if (w->len == IO_BUF_SIZE) {
+        io_flush(w);
+    }
+    w->buf[w->len++] = c;
+
+    if (w->unbuffered) {
+        io_flush(w);
+    }
+}
+
+[[gnu::format(printf, 2, 3)]]
+static inline void io_printf(struct io_writer *w, const char *fmt, ...)
+{
+    va_list ap;
+
+    /* Formatted output is short, so make sure
+     * a reasonable amount of room is free first. */
+    if (IO_BUF_SIZE - w->len < 256) {
+        io_flush(w);
+    }
+
+    va_start(ap, fmt);
+    const int n = vsnprintf((char *)w->buf + w->len, IO_BUF_SIZE - w->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n >= IO_BUF_SIZE - w->len) {
+        /* Did not fit; format it separately. */
+        char *tmp = malloc(n + 1);
+        if (!tmp) {
+            fprintf(stderr, "%s: unable to allocate memory!\n", w->app_name);
+            exit(EXIT_FAILURE);
+        }
+        va_start(ap, fmt);
+        vsnprintf(tmp, n + 1, fmt, ap);
+        va_end(ap);
+        io_write(w, tmp, n);
+        free(tmp);
+        return;
+    }
+    w->len += n;
+
+    if (w->unbuffered) {
+        io_flush(w);
+    }
+}
+
+/* Flush and release the writer. */
+static inline void io_writer_close(struct io_writer *w)
+{
+    io_flush(w);
+    free(w->buf);
+    w->buf = nullptr;
+}
+
+/*
+ * Field emitters for tabular output. These format straight into the
+ * writer's buffer without parsing a format string. A positive width
+ * right-aligns the field as printf("%*...") does, and a negative width
+ * left-aligns it, as "%-*..." does.
+ */
+
+/* Longest field: a 64-bit value in octal. */
+#define IO_NUM_MAX 24
+
+static const char io_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char io_hex_digits[] = "0123456789abcdef";
+
+/* Return room for n bytes at the end of the buffer, flushing if needed.
+ * The caller fills them and then calls io_commit(). */
+static inline uint8_t *io_reserve(struct io_writer *w, const size_t n)
+{
+    if (n > IO_BUF_SIZE - w->len) {
+        io_flush(w);
+    }
+    return w->buf + w->len;
+}
+
+static inline void io_commit(struct io_writer *w, const size_t n)
+{
+    w->len += n;
+    if (w->unbuffered) {
+        io_flush(w);
+    }
+}
+
+/* Write v in base 8, 10 or 16 so that it ends just before 'end'.
+ * Returns the start of the digits. */
+static inline char *io_fmt_num(char *end, uint64_t v, const unsigned base)
+{
+    if (base == 10) {
+        while (v >= 100) {
+            const unsigned pair = (v % 100) * 2;
+            v /= 100;
+            *--end = io_digit_pairs[pair + 1];
+            *--end = io_digit_pairs[pair];
+        }
+        if (v >= 10) {
+            *--end = io_digit_pairs[v * 2 + 1];
+            *--end = io_digit_pairs[v * 2];
+        } else {
+            *--end = (char)('0' + v);
+        }
+        return end;
+    }
+
+    const unsigned shift = base == 16 ? 4 : 3;
+    do {
+        *--end = io_hex_digits[v & (base - 1)];
+        v >>= shift;
+    } while (v != 0);
+    return end;
+}
+
+static inline void io_pad(struct io_writer *w, const char c, size_t n)
+{
+    while (n > 0) {
+        const size_t run = n < IO_BUF_SIZE ? n : IO_BUF_SIZE;
+        memset(io_reserve(w, run), c, run);
+        io_commit(w, run);
+        n -= run;
+    }
+}
+
+/* Write s, padded with spaces to 'width'. */
+static inline void io_put_field(struct io_writer *w, const char *s, const size_t len, const int width)
+{
+    const size_t abs_width = width < 0 ? -(size_t)width : (size_t)width;
+    const size_t pad = abs_width > len ? abs_width - len : 0;
+
+    if (width > 0) {
+        io_pad(w, ' ', pad);
+    }
+    io_write(w, s, len);
+    if (width < 0) {
+        io_pad(w, ' ', pad);
+    }
+}
+
+static inline void io_puts(struct io_writer *w, const char *s)
+{
+    io_write(w, s, strlen(s));
+}
+
+static inline void io_put_str(struct io_writer *w, const char *s, const int width)
+{
+    io_put_field(w, s, strlen(s), width);
+}
+
+/* Write v in base 8, 10 or 16. A right-aligned field is
+ * padded with 'fill', so '0' gives printf's "%0*". */
+static inline void io_put_num(struct io_writer *w, const uint64_t v, const unsigned base,
+                              const int width, const char fill)
+{
+    char buf[IO_NUM_MAX];
+    char *end = buf + sizeof(buf);
+    char *start = io_fmt_num(end, v, base);
+
+    if (fill != ' ' && width > 0) {
+        while (end - start < width && start > buf) {
+            *--start = fill;
+        }
+    }
+    io_put_field(w, start, end - start, width);
+}
+
+static inline void io_put_uint(struct io_writer *w, const uint64_t v, const int width)
+{
+    io_put_num(w, v, 10, width, ' ');
+}
+
+static inline void io_put_int(struct io_writer *w, const int64_t v, const int width)
+{
+    char buf[IO_NUM_MAX];
+    char *end = buf + sizeof(buf);
+    char *start = io_fmt_num(end, v < 0 ? -(uint64_t)v : (uint64_t)v, 10);
+
+    if (v < 0) {
+        *--start = '-';
+    }
+    io_put_field(w, start, end - start, width);
+}
+
+/* Write v with 'prec' (at most 9) decimal places, as printf("%*.*f"). */
+static inline void io_put_fixed(struct io_writer *w, const double v, const int prec, const int width)
+{
+    static const uint32_t scale[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+
+    /* Leave anything out of range, and NaN, to printf. */
+    if (!(v > -1e15 && v < 1e15)) {
+        io_printf(w, "%*.*f", width, prec, v);
+        return;
+    }
+
+    const double mag = v < 0 ? -v : v;
+    const uint64_t scaled = (uint64_t)(mag * scale[prec] + 0.5);
+
+    char buf[IO_NUM_MAX + 2];
+    char *end = buf + sizeof(buf);
+    char *start = end;
+
+    if (prec > 0) {
+        uint64_t frac = scaled % scale[prec];
+        for (int i = 0; i < prec; i++) {
+            *--start = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        *--start = '.';
+    }
+    start = io_fmt_num(start, scaled / scale[prec], 10);
+    /* Like printf, a negative value that rounds to zero keeps its sign. */
+    if (signbit(v)) {
+        *--start = '-';
+    }
+    io_put_field(w, start, end - start, width);
+}
+
+/* Write s between an ANSI colour sequence and a reset,
+ * or just s if colour is nullptr. */
+static inline void io_put_colour(struct io_writer *w, const char *colour, const char *s, const size_t len)
+{
+    if (colour == nullptr) {
+        io_write(w, s, len);
+        return;
+    }
+    io_puts(w, colour);
+    io_write(w, s, len);
+    io_puts(w, ANSI_RESET);
+}
+
+/* A writer on stdout shared by the whole program, and flushed on exit
+ * like stdio's, for tools whose output is spread over many functions.
+ * Its handler runs before stdio flushes at exit, so anything already
+ * printed through stdio, such as help for a bad option, is flushed
+ * when the writer is set up to keep it ahead. */
+static struct io_writer io_out;
+
+static inline void io_out_flush(void)
+{
+    io_flush(&io_out);
+}
+
+static inline struct io_writer *io_stdout(const char *app_name)
+{
+    if (io_out.buf == nullptr) {
+        fflush(stdout);
+        io_writer_fd(&io_out, STDOUT_FILENO, false, app_name);
+        atexit(io_out_flush);
+    }
+    return &io_out;
+}
+
+#endif /* IO_H */
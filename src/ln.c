@@ -63,6 +63,7 @@ int main(const int argc, char *argv[])
         {.name = "verbose",     .has_arg = 0, .flag = nullptr, .val = 'v'},
         {.name = "help",        .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version",     .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,       .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -90,6 +91,9 @@ int main(const int argc, char *argv[])
             case 'i':
                 opts.interactive = true;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default :
                 show_help();
                 return EXIT_FAILURE;
@@ -30,6 +30,8 @@
 #endif
 
 #include "common.h"
+#include "idcache.h"
+#include "io.h"
 
 #define PATH_MAX 4096
 
@@ -54,7 +56,7 @@
 
 extern char* APP_NAME;
 
-extern inline void show_help()
+static inline void show_help()
 {
     printf("Usage: %s [OPTION]... [FILE]...\n\n\
 List and show info for files and directories\n\n\
@@ -121,7 +123,7 @@ struct Opts {
 
 extern struct Opts opts;
 
-extern inline int process_args(const int argc, char** argv)
+static inline int process_args(const int argc, char** argv)
 {
         const struct option long_opts[] = {
          { .name = "help",        .has_arg = no_argument,       .flag = nullptr, .val = 'h' },
@@ -150,6 +152,7 @@ extern inline int process_args(const int argc, char** argv)
          { .name = "print-atime", .has_arg = no_argument,       .flag = nullptr, .val = OPT_P_ATIME },
          { .name = "print-mtime", .has_arg = no_argument,       .flag = nullptr, .val = OPT_P_MTIME },
          { .name = "print-ctime", .has_arg = no_argument,       .flag = nullptr, .val = OPT_P_CTIME },
+         STATS_LONG_OPT,
          { .name = nullptr,       .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -250,6 +253,9 @@ extern inline int process_args(const int argc, char** argv)
                 opts.fields |= 1 << CTIME_BIT;
                 opts.ls_long = true;   /* Implies '-l' */
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             case ':':
             case '?':
             default:
@@ -262,7 +268,7 @@ extern inline int process_args(const int argc, char** argv)
 
 /* Return actual terminal width, or
  * the value 82 if no terminal attached. */
-extern inline uint16_t get_screen_width()
+static inline uint16_t get_screen_width()
 {
     uint16_t screen_width;
     /* Check if stdout is redirected to a file or a pipe. */
@@ -283,7 +289,7 @@ extern inline uint16_t get_screen_width()
 
 /* Returns the file dereferenced from
  * a symbolic link. */
-extern inline void resolve_link(const char *path, char buf[])
+static inline void resolve_link(const char *path, char buf[])
 {
     const ssize_t len = readlink(path, buf, PATH_MAX);
     if (len == -1) {
@@ -296,70 +302,72 @@ extern inline void resolve_link(const char *path, char buf[])
 
 /* Print a filename to the screen, coloured
  * and with classification glyphs is specified. */
-extern inline int p_filename(char *filename, const struct stat buf,
+static inline int p_filename(char *filename, const struct stat buf,
                                    const bool colour, const bool classify)
 {
-    int len = strlen(filename);
+    struct io_writer *out = io_stdout(APP_NAME);
+    const size_t len = strlen(filename);
+    const char *colour_seq = nullptr;
+    char glyph = '\0';
+
     switch (buf.st_mode & S_IFMT) {
         /* block device */
         case S_IFBLK:
-            printf("%s%s%s", colour ? ANSI_YELLOW : "", filename,
-                               colour ? ANSI_RESET : "");
+            colour_seq = ANSI_YELLOW;
             break;
         /* character device */
         case S_IFCHR:
-            printf("%s%s%s", colour ? ANSI_YELLOW_B : "", filename,
-                               colour ? ANSI_RESET : "");
+            colour_seq = ANSI_YELLOW_B;
             break;
         /* directory */
         case S_IFDIR:
-            if (classify) len++;
-            printf("%s%s%s%s", colour ? ANSI_BLUE_B : "", filename,
-                               colour ? ANSI_RESET : "",  classify ? "/" : "");
+            colour_seq = ANSI_BLUE_B;
+            glyph = '/';
             break;
         /* FIFO/pipe */
         case S_IFIFO:
-            if (classify) len++;
-            printf("%s%s%s%s", colour ? ANSI_YELLOW : "", filename,
-                               colour ? ANSI_RESET : "",  classify ? "|" : "");
+            colour_seq = ANSI_YELLOW;
+            glyph = '|';
             break;
         /* symlink */
         case S_IFLNK: {
+            colour_seq = ANSI_CYAN_B;
             if (opts.ls_long) {
-            char l_buf[PATH_MAX];
-            resolve_link(filename, l_buf);
-            printf("%s%s%s -> %s", colour ? ANSI_CYAN_B : "", filename,
-                                   colour ? ANSI_RESET : "", l_buf);
-            } else {
-                if (classify) len++;
-                printf("%s%s%s%s", colour ? ANSI_CYAN_B : "", filename,
-                                   colour ? ANSI_RESET : "", classify ? "@" : "");
+                char l_buf[PATH_MAX];
+                resolve_link(filename, l_buf);
+                io_put_colour(out, colour ? colour_seq : nullptr, filename, len);
+                io_write(out, " -> ", 4);
+                io_puts(out, l_buf);
+                return (int)len;
             }
+            glyph = '@';
             break;
         }
         /* socket */
         case S_IFSOCK:
-            if (classify) len++;
-            printf("%s%s%s%s", colour ? ANSI_MAGENTA_B : "", filename,
-                               colour ? ANSI_RESET    : "",  classify ? "=" : "");
+            colour_seq = ANSI_MAGENTA_B;
+            glyph = '=';
             break;
         /* regular file */
         default:
             /* Is it executable ? */
             if (buf.st_mode & S_IXUSR || buf.st_mode & S_IXGRP || buf.st_mode & S_IXOTH) {
-                if (classify) len++;
-                printf("%s%s%s%s", colour ? ANSI_GREEN_B : "", filename,
-                                   colour ? ANSI_RESET : "",  classify ? "*" : "");
-            } else {
-                printf("%s", filename);
+                colour_seq = ANSI_GREEN_B;
+                glyph = '*';
             }
             break;
     }
-    return len;
+
+    io_put_colour(out, colour ? colour_seq : nullptr, filename, len);
+    if (classify && glyph != '\0') {
+        io_putc(out, glyph);
+        return (int)len + 1;
+    }
+    return (int)len;
 }
 
 /* Display files in short format, one file per line. */
-extern inline void print_one_format(const int32_t n_files, char* filenames[])
+static inline void print_one_format(const int32_t n_files, char* filenames[])
 {
     for (int f = 0; f < n_files; f++) {
         struct stat buf;
@@ -369,33 +377,45 @@ extern inline void print_one_format(const int32_t n_files, char* filenames[])
         }
 
         p_filename(filenames[f], buf, opts.colour, opts.classify);
-        putchar('\n');
+        io_putc(io_stdout(APP_NAME), '\n');
     }
 }
 
 /* Given a struct timespec, return a formatted
  * string suitable for use in ls/dir/vdir. */
-extern inline char* fmt_time(const struct timespec time_d, char string_time[])
+static inline char* fmt_time(const struct timespec time_d, char string_time[])
 {
-    time_t now_t;
-    (void) time(&now_t);
-    const struct tm *now = localtime(&now_t);
-    const int current_year = now->tm_year + 1900;
+    /* The year only matters for picking the format,
+     * so it is looked up once rather than per file. */
+    static int current_year = 0;
+    if (current_year == 0) {
+        time_t now_t;
+        (void) time(&now_t);
+        current_year = localtime(&now_t)->tm_year + 1900;
+    }
 
     const struct tm *fil = localtime(&time_d.tv_sec);
     if (current_year != fil->tm_year + 1900) {
-        strftime(string_time, sizeof("Jan 01  1970"), "%b %d  %Y",
-                 localtime(&time_d.tv_sec));
+        strftime(string_time, sizeof("Jan 01  1970"), "%b %d  %Y", fil);
     } else {
-        strftime(string_time, sizeof("Jan 01 12:00"), "%b %d %H:%M",
-                 localtime(&time_d.tv_sec));
+        strftime(string_time, sizeof("Jan 01 12:00"), "%b %d %H:%M", fil);
     }
     return string_time;
 }
 
+/* Print a time field of the long format. */
+static inline void p_time(struct io_writer *out, const struct timespec time_d)
+{
+    char t_buf[13];
+    io_putc(out, ' ');
+    io_puts(out, fmt_time(time_d, t_buf));
+    io_putc(out, ' ');
+}
+
 /*  Display files long format, one file per line. */
-extern inline void print_long_format(const int32_t n_files, char *filenames[])
+static inline void print_long_format(const int32_t n_files, char *filenames[])
 {
+    struct io_writer *out = io_stdout(APP_NAME);
     struct stat buf;
 
     for (int f = 0; f < n_files; f++) {
@@ -412,63 +432,78 @@ extern inline void print_long_format(const int32_t n_files, char *filenames[])
         }
 
         if (opts.fields & (1 << INODE_BIT)) {
-            printf("%8" PRId64 " ", buf.st_ino);
+            io_put_uint(out, buf.st_ino, 8);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << BLOCK_BIT)) {
-            printf("%3" PRId64 " ", buf.st_blocks);
+            io_put_int(out, buf.st_blocks, 3);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << BLK_S_BIT)) {
-            printf("%4" PRIi64 " ", (int64_t)buf.st_blksize);
+            io_put_int(out, buf.st_blksize, 4);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << DEV_BIT)) {
-            printf("%d/%d ", major(buf.st_dev), minor(buf.st_dev));
+            io_put_uint(out, major(buf.st_dev), 0);
+            io_putc(out, '/');
+            io_put_uint(out, minor(buf.st_dev), 0);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << PERMS_BIT)) {
-            printf("%s", filetype(buf.st_mode, 0));
-            printf("%s ", file_perm_str(buf.st_mode, 1));
+            char perms[PERM_STR_SIZE];
+            io_puts(out, filetype(buf.st_mode, 0));
+            io_puts(out, file_perm_str(buf.st_mode, 1, perms));
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << LINKS_BIT)) {
-            printf("%3" PRIu64 " ", (int64_t)buf.st_nlink);
+            io_put_uint(out, buf.st_nlink, 3);
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << USER_BIT)) {
-            printf("%s ", get_username(buf.st_uid));
+            io_puts(out, get_username(buf.st_uid));
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << GROUP_BIT)) {
-            printf("%s ", get_groupname(buf.st_gid));
+            io_puts(out, get_groupname(buf.st_gid));
+            io_putc(out, ' ');
         }
 
         if (opts.fields & (1 << SIZE_BIT)) {
-            !opts.human ? (void)printf("%6" PRId64 " ", buf.st_size) :
-                format_ls(buf.st_size);    /* ie: 16k */
+            if (opts.human) {
+                char size_buf[22];
+                io_put_str(out, format_ls(buf.st_size, size_buf), 6);    /* ie: 16k */
+            } else {
+                io_put_int(out, buf.st_size, 6);
+            }
+            io_putc(out, ' ');
         }
 
-        char t_buf[13];
         if (opts.fields & (1 << MTIME_BIT)) {
-            printf(" %s ", fmt_time(buf.st_mtim, t_buf));
+            p_time(out, buf.st_mtim);
         }
 
         if (opts.fields & (1 << ATIME_BIT)) {
-            printf(" %s ", fmt_time(buf.st_atim, t_buf));
+            p_time(out, buf.st_atim);
         }
 
         if (opts.fields & (1 << CTIME_BIT)) {
-            printf(" %s ", fmt_time(buf.st_ctim, t_buf));
+            p_time(out, buf.st_ctim);
         }
 
         p_filename(filenames[f], buf, opts.colour, opts.classify);
-        putchar('\n');
+        io_putc(out, '\n');
     }
 }
 
 /* Display files hort-format. As many as can fit per line. */
-extern inline void print_short_format(const int32_t n_files, char *filenames[],
+static inline void print_short_format(const int32_t n_files, char *filenames[],
     const uint32_t longest_so_far)
 {
     constexpr int padding = 2;
@@ -551,19 +586,17 @@ extern inline void print_short_format(const int32_t n_files, char *filenames[],
                     const int pad_spaces = col_widths[c] + padding - printed_len;
 
                     if (pad_spaces > 0) {
-                        /* The %*s idiom right-justifies an empty string,
-                           effectively printing exactly 'pad_spaces' spaces */
-                        printf("%*s", pad_spaces, "");
+                        io_pad(io_stdout(APP_NAME), ' ', pad_spaces);
                     }
                 }
             }
         }
-        printf("\n");
+        io_putc(io_stdout(APP_NAME), '\n');
     }
 }
 
 /* Comparison function for alphabetizing filenames used by qsort. */
-extern inline int compare_strings(const void *a, const void *b)
+static inline int compare_strings(const void *a, const void *b)
 {
     const char *str_a = *(const char **)a;
     const char *str_b = *(const char **)b;
@@ -572,7 +605,7 @@ extern inline int compare_strings(const void *a, const void *b)
 }
 
 /* Comparison function for sorting by size. */
-extern inline int compare_size(const void *a, const void *b)
+static inline int compare_size(const void *a, const void *b)
 {
     struct stat buf_a;
     struct stat buf_b;
@@ -603,7 +636,7 @@ extern inline int compare_size(const void *a, const void *b)
 }
 
 /* Comparison function for sorting by atime. */
-extern inline int compare_atime(const void *a, const void *b)
+static inline int compare_atime(const void *a, const void *b)
 {
     struct stat buf_a;
     struct stat buf_b;
@@ -635,7 +668,7 @@ extern inline int compare_atime(const void *a, const void *b)
 }
 
 /* Comparison function for sorting by mtime. */
-extern inline int compare_mtime(const void *a, const void *b)
+static inline int compare_mtime(const void *a, const void *b)
 {
     struct stat buf_a;
     struct stat buf_b;
@@ -667,7 +700,7 @@ extern inline int compare_mtime(const void *a, const void *b)
 }
 
 /* Comparison function for sorting by ctime. */
-extern inline int compare_ctime(const void *a, const void *b)
+static inline int compare_ctime(const void *a, const void *b)
 {
     struct stat buf_a;
     struct stat buf_b;
@@ -699,7 +732,7 @@ extern inline int compare_ctime(const void *a, const void *b)
 }
 
 /* Reverse the sorted array for --reverse. */
-extern inline void reverse_array(char* arr[], const int size)
+static inline void reverse_array(char* arr[], const int size)
 {
     int left = 0;
     int right = size - 1;
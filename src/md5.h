@@ -0,0 +1,446 @@
+/***************************************************************************
+ *   md5.h - the MD5 compression function used by md5sum                   *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef MD5_H
+#define MD5_H
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "cpu.h"
+
+#define INT_BITS 32
+
+#define MD5_BLOCK_SIZE  64
+#define MD5_DIGEST_SIZE 16
+
+
+/* The per-round shift amounts. */
+static constexpr uint8_t shift_n[] = { 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                                       5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+                                       4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                                       6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21 };
+
+/* A 64-element array k[1 ... 64] constructed from the sine function.
+ * Let k[i] denote the i-th element of the table, which is equal to the
+ * integer part of 4294967296 times abs(sin(i)), where i is in radians. */
+static constexpr uint32_t k[] = { 0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+                                  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+                                  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+                                  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+                                  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+                                  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+                                  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+                                  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+                                  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+                                  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+                                  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+                                  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+                                  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+                                  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+                                  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+                                  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+
+/* The message word added at each step: i, 5i + 1, 3i + 5 and 7i,
+ * all modulo 16, for the four rounds. */
+static constexpr uint8_t md5_index[] = {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+                                          1,  6, 11,  0,  5, 10, 15,  4,  9, 14,  3,  8, 13,  2,  7, 12,
+                                          5,  8, 11, 14,  1,  4,  7, 10, 13,  0,  3,  6,  9, 12, 15,  2,
+                                          0,  7, 14,  5, 12,  3, 10,  1,  8, 15,  6, 13,  4, 11,  2,  9 };
+
+/* The initial values of the four 32-bit registers a, b, c and d. */
+static constexpr uint32_t md5_init_regs[] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+/* Left-rotate n by d bits. */
+static inline uint32_t left_rotate(const uint32_t n, const uint8_t d)
+{
+    return (n << d) | (n >> (INT_BITS - d));
+}
+
+/* Encode the chunk as 16 4-byte little-endian words. */
+static inline void encode_words(const uint8_t *chunk, uint32_t words[16])
+{
+    for (int j = 0; j < 16; j++) {
+        words[j] = ((uint32_t)chunk[4*j + 3] << 24) |
+                   ((uint32_t)chunk[4*j + 2] << 16) |
+                   ((uint32_t)chunk[4*j + 1] <<  8) |
+                    (uint32_t)chunk[4*j];
+    }
+}
+
+/* The four round functions. */
+#define MD5_FN_F(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define MD5_FN_G(b, c, d) ((c) ^ ((d) & ((b) ^ (c))))
+#define MD5_FN_H(b, c, d) ((b) ^ (c) ^ (d))
+#define MD5_FN_I(b, c, d) ((c) ^ ((b) | ~(d)))
+
+/* Step i, with the roles of the registers rotated through the
+ * arguments so that no values move between steps. */
+#define MD5_STEP(fn, a, b, c, d, i) \
+    ((a) = (b) + left_rotate((a) + fn((b), (c), (d)) + k[(i)] + words[md5_index[(i)]], shift_n[(i)]))
+
+/* Mix one 64-byte chunk into the registers reg[0..3] (a, b, c, d). */
+static inline void process_chunk(uint32_t reg[4], const uint8_t *chunk)
+{
+    uint32_t words[16];
+    uint32_t a = reg[0];
+    uint32_t b = reg[1];
+    uint32_t c = reg[2];
+    uint32_t d = reg[3];
+
+    encode_words(chunk, words);
+
+#pragma GCC unroll 4
+    for (int i = 0; i < 16; i += 4) {
+        MD5_STEP(MD5_FN_F, a, b, c, d, i);
+        MD5_STEP(MD5_FN_F, d, a, b, c, i + 1);
+        MD5_STEP(MD5_FN_F, c, d, a, b, i + 2);
+        MD5_STEP(MD5_FN_F, b, c, d, a, i + 3);
+    }
+#pragma GCC unroll 4
+    for (int i = 16; i < 32; i += 4) {
+        MD5_STEP(MD5_FN_G, a, b, c, d, i);
+        MD5_STEP(MD5_FN_G, d, a, b, c, i + 1);
+        MD5_STEP(MD5_FN_G, c, d, a, b, i + 2);
+        MD5_STEP(MD5_FN_G, b, c, d, a, i + 3);
+    }
+#pragma GCC unroll 4
+    for (int i = 32; i < 48; i += 4) {
+        MD5_STEP(MD5_FN_H, a, b, c, d, i);
+        MD5_STEP(MD5_FN_H, d, a, b, c, i + 1);
+        MD5_STEP(MD5_FN_H, c, d, a, b, i + 2);
+        MD5_STEP(MD5_FN_H, b, c, d, a, i + 3);
+    }
+#pragma GCC unroll 4
+    for (int i = 48; i < 64; i += 4) {
+        MD5_STEP(MD5_FN_I, a, b, c, d, i);
+        MD5_STEP(MD5_FN_I, d, a, b, c, i + 1);
+        MD5_STEP(MD5_FN_I, c, d, a, b, i + 2);
+        MD5_STEP(MD5_FN_I, b, c, d, a, i + 3);
+    }
+
+    reg[0] += a;
+    reg[1] += b;
+    reg[2] += c;
+    reg[3] += d;
+}
+
+/* Mix n consecutive 64-byte chunks into reg[0..3]. */
+static inline void md5_blocks(uint32_t reg[4], const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += MD5_BLOCK_SIZE) {
+        process_chunk(reg, p);
+    }
+}
+
+/*
+ * Multi-lane MD5. One message cannot be split across lanes, since
+ * every step depends on the one before, but independent files can: each
+ * SIMD lane hashes its own. The state is word-major, st[register][lane],
+ * and a call hashes n chunks from each lane's data pointer. Lanes with
+ * no message may point at another lane's data; their state is ignored.
+ */
+#define MD5_MB_MAX_LANES 16
+
+typedef void (*md5_mb_fn)(uint32_t st[4][MD5_MB_MAX_LANES], const uint8_t *const data[], size_t n);
+
+#if defined(__x86_64__) || defined(__i386__)
+CPU_TARGET_SSE42
+static inline __m128i md5_mb_rol_sse42(const __m128i x, const int n)
+{
+    return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+CPU_TARGET_SSE42
+static void md5_mb_sse42(uint32_t st[4][MD5_MB_MAX_LANES], const uint8_t *const data[], size_t n)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i reg[4];
+    for (int j = 0; j < 4; j++) {
+        reg[j] = _mm_loadu_si128((const __m128i *)st[j]);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        /* Four 4x4 transposes give w[word][lane]. */
+        __m128i w[16];
+        for (int q = 0; q < 4; q++) {
+            __m128i r[4];
+            for (int l = 0; l < 4; l++) {
+                r[l] = _mm_loadu_si128((const __m128i *)(data[l] + i * 64 + q * 16));
+            }
+            const __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+            const __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+            const __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+            const __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+            w[q * 4]     = _mm_unpacklo_epi64(t0, t1);
+            w[q * 4 + 1] = _mm_unpackhi_epi64(t0, t1);
+            w[q * 4 + 2] = _mm_unpacklo_epi64(t2, t3);
+            w[q * 4 + 3] = _mm_unpackhi_epi64(t2, t3);
+        }
+
+        __m128i a = reg[0], b = reg[1], c = reg[2], d = reg[3];
+        for (int t = 0; t < 64; t++) {
+            __m128i f;
+            if (t < 16) {
+                f = _mm_xor_si128(d, _mm_and_si128(b, _mm_xor_si128(c, d)));
+            } else if (t < 32) {
+                f = _mm_xor_si128(c, _mm_and_si128(d, _mm_xor_si128(b, c)));
+            } else if (t < 48) {
+                f = _mm_xor_si128(_mm_xor_si128(b, c), d);
+            } else {
+                f = _mm_xor_si128(c, _mm_or_si128(b, _mm_xor_si128(d, ones)));
+            }
+            f = _mm_add_epi32(_mm_add_epi32(a, f),
+                              _mm_add_epi32(w[md5_index[t]], _mm_set1_epi32((int)k[t])));
+            a = d;
+            d = c;
+            c = b;
+            b = _mm_add_epi32(b, md5_mb_rol_sse42(f, shift_n[t]));
+        }
+
+        reg[0] = _mm_add_epi32(reg[0], a);
+        reg[1] = _mm_add_epi32(reg[1], b);
+        reg[2] = _mm_add_epi32(reg[2], c);
+        reg[3] = _mm_add_epi32(reg[3], d);
+    }
+
+    for (int j = 0; j < 4; j++) {
+        _mm_storeu_si128((__m128i *)st[j], reg[j]);
+    }
+}
+
+CPU_TARGET_AVX2
+static inline __m256i md5_mb_rol_avx2(const __m256i x, const int n)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+/* Load words 8 * half .. 8 * half + 7 of chunk i of eight lanes, as w[word][lane]. */
+CPU_TARGET_AVX2
+static inline void md5_mb_load8_avx2(__m256i w[8], const uint8_t *const data[8],
+                                     const size_t i, const int half)
+{
+    __m256i r[8], t[8];
+    for (int l = 0; l < 8; l++) {
+        r[l] = _mm256_loadu_si256((const __m256i *)(data[l] + i * 64 + half * 32));
+    }
+
+    /* An 8x8 transpose of 32-bit words. */
+    for (int l = 0; l < 8; l += 2) {
+        t[l]     = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+        t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+    }
+    for (int l = 0; l < 8; l += 4) {
+        r[l]     = _mm256_unpacklo_epi64(t[l], t[l + 2]);
+        r[l + 1] = _mm256_unpackhi_epi64(t[l], t[l + 2]);
+        r[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+        r[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+    }
+    for (int j = 0; j < 4; j++) {
+        w[j]     = _mm256_permute2x128_si256(r[j], r[j + 4], 0x20);
+        w[j + 4] = _mm256_permute2x128_si256(r[j], r[j + 4], 0x31);
+    }
+}
+
+CPU_TARGET_AVX2
+static void md5_mb_avx2(uint32_t st[4][MD5_MB_MAX_LANES], const uint8_t *const data[], size_t n)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i reg[4];
+    for (int j = 0; j < 4; j++) {
+        reg[j] = _mm256_loadu_si256((const __m256i *)st[j]);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        __m256i w[16];
+        md5_mb_load8_avx2(w, data, i, 0);
+        md5_mb_load8_avx2(w + 8, data, i, 1);
+
+        __m256i a = reg[0], b = reg[1], c = reg[2], d = reg[3];
+        for (int t = 0; t < 64; t++) {
+            __m256i f;
+            if (t < 16) {
+                f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+            } else if (t < 32) {
+                f = _mm256_xor_si256(c, _mm256_and_si256(d, _mm256_xor_si256(b, c)));
+            } else if (t < 48) {
+                f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            } else {
+                f = _mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, ones)));
+            }
+            f = _mm256_add_epi32(_mm256_add_epi32(a, f),
+                                 _mm256_add_epi32(w[md5_index[t]], _mm256_set1_epi32((int)k[t])));
+            a = d;
+            d = c;
+            c = b;
+            b = _mm256_add_epi32(b, md5_mb_rol_avx2(f, shift_n[t]));
+        }
+
+        reg[0] = _mm256_add_epi32(reg[0], a);
+        reg[1] = _mm256_add_epi32(reg[1], b);
+        reg[2] = _mm256_add_epi32(reg[2], c);
+        reg[3] = _mm256_add_epi32(reg[3], d);
+    }
+
+    for (int j = 0; j < 4; j++) {
+        _mm256_storeu_si256((__m256i *)st[j], reg[j]);
+    }
+}
+
+/* Sixteen lanes, with native rotates and each round function as one ternary-logic op. */
+CPU_TARGET_AVX512
+static void md5_mb_avx512(uint32_t st[4][MD5_MB_MAX_LANES], const uint8_t *const data[], size_t n)
+{
+    __m512i reg[4];
+    for (int j = 0; j < 4; j++) {
+        reg[j] = _mm512_loadu_si512(st[j]);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        __m512i w[16];
+        for (int half = 0; half < 2; half++) {
+            __m256i lo[8], hi[8];
+            md5_mb_load8_avx2(lo, data, i, half);
+            md5_mb_load8_avx2(hi, data + 8, i, half);
+            for (int j = 0; j < 8; j++) {
+                w[half * 8 + j] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[j]), hi[j], 1);
+            }
+        }
+
+        __m512i a = reg[0], b = reg[1], c = reg[2], d = reg[3];
+        for (int t = 0; t < 64; t++) {
+            __m512i f;
+            if (t < 16) {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0xca);
+            } else if (t < 32) {
+                f = _mm512_ternarylogic_epi32(d, b, c, 0xca);
+            } else if (t < 48) {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0x96);
+            } else {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0x39);
+            }
+            f = _mm512_add_epi32(_mm512_add_epi32(a, f),
+                                 _mm512_add_epi32(w[md5_index[t]], _mm512_set1_epi32((int)k[t])));
+            a = d;
+            d = c;
+            c = b;
+            b = _mm512_add_epi32(b, _mm512_rolv_epi32(f, _mm512_set1_epi32(shift_n[t])));
+        }
+
+        reg[0] = _mm512_add_epi32(reg[0], a);
+        reg[1] = _mm512_add_epi32(reg[1], b);
+        reg[2] = _mm512_add_epi32(reg[2], c);
+        reg[3] = _mm512_add_epi32(reg[3], d);
+    }
+
+    for (int j = 0; j < 4; j++) {
+        _mm512_storeu_si512(st[j], reg[j]);
+    }
+}
+#endif
+
+/* With no lanes, files are hashed one at a time. */
+static const struct {
+    uint32_t needs;
+    const char *isa;
+    size_t lanes;
+    md5_mb_fn fn;
+} md5_mb_impls[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { .needs = CPU_AVX512, .isa = "avx512", .lanes = 16, .fn = md5_mb_avx512 },
+    { .needs = CPU_AVX2,   .isa = "avx2",   .lanes = 8,  .fn = md5_mb_avx2 },
+    { .needs = CPU_SSE42,  .isa = "sse4.2", .lanes = 4,  .fn = md5_mb_sse42 },
+#endif
+    { .needs = 0,          .isa = "scalar", .lanes = 0,  .fn = nullptr },
+};
+
+/* A digest in progress. */
+struct md5_ctx {
+    uint32_t reg[4];
+    uint64_t length;                /* Bytes hashed so far. */
+    uint8_t buf[MD5_BLOCK_SIZE];    /* A partial chunk. */
+    size_t buf_len;
+};
+
+static inline void md5_init(struct md5_ctx *ctx)
+{
+    memcpy(ctx->reg, md5_init_regs, sizeof(ctx->reg));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+}
+
+/* Hash len more bytes of the message. */
+static inline void md5_update(struct md5_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    ctx->length += len;
+
+    if (ctx->buf_len > 0) {
+        const size_t take = len < MD5_BLOCK_SIZE - ctx->buf_len ? len : MD5_BLOCK_SIZE - ctx->buf_len;
+        memcpy(ctx->buf + ctx->buf_len, p, take);
+        ctx->buf_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buf_len < MD5_BLOCK_SIZE) {
+            return;
+        }
+        process_chunk(ctx->reg, ctx->buf);
+        ctx->buf_len = 0;
+    }
+
+    const size_t n = len / MD5_BLOCK_SIZE;
+    md5_blocks(ctx->reg, p, n);
+    p += n * MD5_BLOCK_SIZE;
+    len -= n * MD5_BLOCK_SIZE;
+    memcpy(ctx->buf, p, len);
+    ctx->buf_len = len;
+}
+
+/* Pad the message, and write the digest to out. */
+static inline void md5_final(struct md5_ctx *ctx, uint8_t out[MD5_DIGEST_SIZE])
+{
+    const uint64_t bits = ctx->length * 8;
+
+    ctx->buf[ctx->buf_len++] = 0x80;
+    if (ctx->buf_len > 56) {
+        /* No room for the size; it goes in a chunk of its own. */
+        memset(ctx->buf + ctx->buf_len, 0, MD5_BLOCK_SIZE - ctx->buf_len);
+        process_chunk(ctx->reg, ctx->buf);
+        ctx->buf_len = 0;
+    }
+    memset(ctx->buf + ctx->buf_len, 0, 56 - ctx->buf_len);
+
+    /* The 64-bit message size in bits, little-endian. */
+    for (int i = 0; i < 8; i++) {
+        ctx->buf[56 + i] = (uint8_t)(bits >> (8 * i));
+    }
+    process_chunk(ctx->reg, ctx->buf);
+
+    for (int i = 0; i < 16; i++) {
+        out[i] = (uint8_t)(ctx->reg[i / 4] >> (8 * (i % 4)));
+    }
+}
+
+#endif /* MD5_H */
@@ -46,6 +46,7 @@ int main(const int argc, char *argv[]) {
         {.name = "mode",    .has_arg = required_argument, .flag = nullptr, .val = 'm'},
         {.name = "help",    .has_arg = no_argument,       .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = no_argument,       .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = no_argument,       .flag = nullptr, .val = 0}
     };
 
@@ -68,6 +69,9 @@ int main(const int argc, char *argv[]) {
                 show_help();
                 return EXIT_SUCCESS;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -72,6 +72,7 @@ int main(const int argc, char *argv[])
         {.name = "verbose",     .has_arg = 0, .flag = NULL, .val = 'v'},
         {.name = "help",        .has_arg = 0, .flag = NULL, .val = 'h'},
         {.name = "version",     .has_arg = 0, .flag = NULL, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = NULL,          .has_arg = 0, .flag = NULL, .val = 0}
     };
 
@@ -100,6 +101,9 @@ int main(const int argc, char *argv[])
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
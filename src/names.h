@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   names.h - file name operands and --files0-from lists                  *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef NAMES_H
+#define NAMES_H
+
+#include <stdio.h>
+
+#include "common.h"
+
+/*
+ * The file names a tool that takes many files works through: its
+ * operands, or the NUL-terminated names in a --files0-from list. The
+ * list is read one name at a time, so it may be longer than memory.
+ */
+struct name_source {
+    char *const *argv;
+    int argc;
+    FILE *files0;           /* The list, or nullptr for the operands. */
+    const char *files0_name;
+    char *line;
+    size_t cap;
+};
+
+/* Read names from the list path, or stdin for "-", instead of the
+ * operands. Prints an error and returns false if it cannot be opened. */
+static inline bool names_open_files0(struct name_source *src, const char *path, const char *app_name)
+{
+    src->argc = 0;
+    src->files0_name = path;
+    src->files0 = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (src->files0 == nullptr) {
+        fprintf(stderr, "%s: cannot open %s for reading: %s\n", app_name, path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static inline void names_close(struct name_source *src)
+{
+    free(src->line);
+    src->line = nullptr;
+    if (src->files0 != nullptr && src->files0 != stdin) {
+        fclose(src->files0);
+    }
+    src->files0 = nullptr;
+}
+
+/* The next file name, or nullptr at the end. Names read from the list
+ * are allocated, and *owned is set. */
+static inline char *names_next(struct name_source *src, bool *owned, const char *app_name)
+{
+    *owned = false;
+    if (src->files0 == nullptr) {
+        if (src->argc == 0) {
+            return nullptr;
+        }
+        src->argc--;
+        return *src->argv++;
+    }
+
+    errno = 0;
+    if (getdelim(&src->line, &src->cap, '\0', src->files0) == -1) {
+        if (errno != 0) {
+            fprintf(stderr, "%s: %s: read error: %s\n", app_name, src->files0_name, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        return nullptr;
+    }
+    char *name = strdup(src->line);
+    if (name == nullptr) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", app_name);
+        exit(EXIT_FAILURE);
+    }
+    *owned = true;
+    return name;
+}
+
+#endif /* NAMES_H */
@@ -24,9 +24,7 @@
 #include <math.h>
 
 #include "common.h"
-
-#define LINE_SIZE 1024
-#define BUFF_SIZE 4096
+#include "io.h"
 
 static const char *APP_NAME =  "nl";
 
@@ -39,18 +37,28 @@ Options:\n\
 Report bugs to <bulliver@gmail.com>\n", APP_NAME);
 }
 
-static int count_lines(FILE *fp) {
-    char buf[BUFF_SIZE];
+static struct io_writer out;
+
+static int count_lines(char *filename) {
+    struct io_reader in;
+
+    if (!io_open(&in, filename, APP_NAME)) {
+        fprintf(stderr, "%s: unable to open %s: %s\n", APP_NAME, filename, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    const uint8_t *buf;
     size_t bytes_read;
     int lines = 0;
 
-    while ((bytes_read = fread(buf, 1, BUFF_SIZE, fp)) > 0) {
-        for (size_t i = 0; i < bytes_read; i++) {
-            if (buf[i] == '\n') {
-                lines++;
-            }
+    while ((bytes_read = io_read(&in, &buf)) > 0) {
+        const uint8_t *end = buf + bytes_read;
+        while ((buf = memchr(buf, '\n', end - buf)) != nullptr) {
+            lines++;
+            buf++;
         }
     }
+    io_close(&in);
 
     if (lines == 0) {
         return 2;
@@ -59,33 +67,26 @@ static int count_lines(FILE *fp) {
     return (int)log10(lines) + 2;
 }
 
-static void nl_stdin(const int unbuffered) {
-    int c;
-    int line_number = 1;
+/* Number the lines of filename with the given width. */
+static void nl_file(char *filename, const int width) {
+    struct io_reader in;
 
-    if (unbuffered == 1) {
-        setvbuf(stdout, nullptr, _IONBF, 1);
+    if (!io_open(&in, filename, APP_NAME)) {
+        fprintf(stderr, "%s: unable to open %s: %s\n", APP_NAME, filename, strerror(errno));
+        exit(EXIT_FAILURE);
     }
 
-    printf("%4i | ", line_number);
-    line_number++;
-    while (( c = getc(stdin)) != EOF ) {
-        if  (c == 10) {
-            putc(c, stdout);
-            /*
-             * we cannot precalculate number of lines in stdin,
-             * so our width is just fixed and arbitrary. Surely,
-             * noone would cat a file with more than 9999 lines
-             * into the terminal?
-             */
-            printf("%4i | ", line_number);
-            line_number++;
-        } else {
-            putc(c, stdout);
-        }
+    const uint8_t *line;
+    size_t len;
+    int lineno = 1;
+
+    while ((len = io_getline(&in, &line)) > 0) {
+        io_put_int(&out, lineno, width);
+        io_write(&out, " | ", 3);
+        io_write(&out, line, len);
+        lineno++;
     }
-    printf("\n");
-    exit(EXIT_SUCCESS);
+    io_close(&in);
 }
 
 int main(const int argc, char *argv[])
@@ -95,15 +96,12 @@ int main(const int argc, char *argv[])
     const struct option longopts[] = {
         {.name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h'},
         {.name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V'},
-        {.name = "stats",   .has_arg = no_argument, .flag = nullptr, .val = 's'},
+        STATS_LONG_OPT,
         {.name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0}
     };
 
-    while ((opt = getopt_long(argc, argv, "Vhs", longopts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "Vh", longopts, nullptr)) != -1) {
         switch(opt) {
-            case 's':
-                printf("Stats coming soon\n");
-                break;
             case 'V':
                 printf("%s (%s) version %s\n", APP_NAME, APP_SUITE, APP_VERSION);
                 printf("%s compiled on %s at %s\n",
@@ -113,30 +111,29 @@ int main(const int argc, char *argv[])
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
         }
     }
 
-
-    char buf[LINE_SIZE];
-    int lineno = 1;
-    constexpr int unbuffered = 0;
-
-    if (argc == 1)
-        nl_stdin(unbuffered);
-
-    FILE *fd = fopen(argv[1], "r");
-
-    const int width = count_lines(fd);
-    rewind(fd);
-
-    while (fgets(buf, LINE_SIZE, fd) != NULL) {
-        printf("%*i | %s", width, lineno, buf);
-        lineno++;
+    io_writer_fd(&out, STDOUT_FILENO, false, APP_NAME);
+
+    if (argc == optind) {
+        /*
+         * we cannot precalculate number of lines in stdin,
+         * so our width is just fixed and arbitrary. Surely,
+         * noone would cat a file with more than 9999 lines
+         * into the terminal?
+         */
+        nl_file("-", 4);
+    } else {
+        nl_file(argv[optind], count_lines(argv[optind]));
     }
 
-
+    io_writer_close(&out);
     return EXIT_SUCCESS;
 }
@@ -30,9 +30,11 @@
 #include <locale.h>
 #include <limits.h>
 #include <sys/stat.h>
+#include <wchar.h>
 
 
 #include "common.h"
+#include "io.h"
 
 /* Constants for box-drawing, and others. */
 #define WELL_WIDTH 12
@@ -93,6 +95,11 @@ static size_t read_size = 0;
 static int32_t bin_width;
 /* Print ascii dump? */
 static bool ascii = false;
+/* MID_DOT in the locale's encoding. */
+static char mid_dot[MB_LEN_MAX];
+static size_t mid_dot_len;
+
+static struct io_writer *out;
 
 
 static void show_help()
@@ -197,28 +204,21 @@ static bool write_well(const uint64_t offset, const size_t bytes_read)
 {
     switch (format) {
     case F_OCT:
-        if (bytes_read == 0) {
-            printf(" 0o%08" PRIo64 "  ", offset);
-            return true;
-        }
-        printf(" 0o%08" PRIo64 "  ", offset);
-        return false;
+        io_write(out, " 0o", 3);
+        io_put_num(out, offset, 8, 8, '0');
+        break;
     case F_UNSIGNED:
     case F_SIGNED:
-        if (bytes_read == 0) {
-            printf(" 0d%08" PRIu64 "  ", offset);
-            return true;
-        }
-        printf(" 0d%08" PRIu64 "  ", offset);
-        return false;
+        io_write(out, " 0d", 3);
+        io_put_num(out, offset, 10, 8, '0');
+        break;
     default:
-        if (bytes_read == 0) {
-            printf(" 0x%08" PRIx64 "  ", offset);
-            return true;
-        }
-        printf(" 0x%08" PRIx64 "  ", offset);
-        return false;
+        io_write(out, " 0x", 3);
+        io_put_num(out, offset, 16, 8, '0');
+        break;
     }
+    io_write(out, "  ", 2);
+    return bytes_read == 0;
 }
 
 /* Build a half-word from 2 bytes. */
@@ -357,12 +357,30 @@ static size_t write_oct_dump(char *line_buf, const uint8_t *buffer, const size_t
     return pos;
 }
 
+/* Write v right-aligned in a field of width chars, and a space. */
+static size_t write_dec_field(char *dst, const int64_t v, const int width)
+{
+    char tmp[IO_NUM_MAX];
+    char *end = tmp + sizeof(tmp);
+    char *start = io_fmt_num(end, v < 0 ? -(uint64_t)v : (uint64_t)v, 10);
+    if (v < 0) {
+        *--start = '-';
+    }
+
+    const int len = (int)(end - start);
+    const int pad = width > len ? width - len : 0;
+    memset(dst, ' ', pad);
+    memcpy(dst + pad, start, len);
+    dst[pad + len] = ' ';
+    return pad + len + 1;
+}
+
 static size_t write_signed_dump(char *line_buf, const uint8_t *buffer, const size_t bytes_read) {
     size_t pos = 0;
 
     if (output == O_BYTE) {
         for (size_t i = 0; i < bytes_read; i++) {
-            pos += snprintf(&line_buf[pos], MAX_LINE_BUF_LEN - pos, "%4d ", (int8_t)buffer[i]);
+            pos += write_dec_field(&line_buf[pos], (int8_t)buffer[i], 4);
         }
         return pos;
     }
@@ -370,14 +388,14 @@ static size_t write_signed_dump(char *line_buf, const uint8_t *buffer, const siz
     if (output == O_HALF_WORD) {
         for (size_t i = 0; i < bytes_read; i+=2) {
             const uint16_t half_word = load_half_word(&buffer[i], bytes_read - i);
-            pos += snprintf(&line_buf[pos], MAX_LINE_BUF_LEN - pos, "%6d ", (int16_t)half_word);
+            pos += write_dec_field(&line_buf[pos], (int16_t)half_word, 6);
         }
         return pos;
     }
 
     for (size_t i = 0; i < bytes_read; i+=4) {
         const uint32_t word = load_word(&buffer[i], bytes_read - i);
-        pos += snprintf(&line_buf[pos], MAX_LINE_BUF_LEN - pos, "%11d ", (int32_t)word);
+        pos += write_dec_field(&line_buf[pos], (int32_t)word, 11);
     }
     return pos;
 }
@@ -388,7 +406,7 @@ static size_t write_unsigned_dump(char *line_buf, const uint8_t *buffer, const s
 
     if (output == O_BYTE) {
         for (size_t i = 0; i < bytes_read; i++) {
-            pos += snprintf(&line_buf[pos], MAX_LINE_BUF_LEN - pos, "%3u ", buffer[i]);
+            pos += write_dec_field(&line_buf[pos], buffer[i], 3);
         }
         return pos;
     }
@@ -396,14 +414,14 @@ static size_t write_unsigned_dump(char *line_buf, const uint8_t *buffer, const s
     if (output == O_HALF_WORD) {
         for (size_t i = 0; i < bytes_read; i+=2) {
             const uint16_t half_word = load_half_word(&buffer[i], bytes_read - i);
-            pos += snprintf(&line_buf[pos], MAX_LINE_BUF_LEN - pos, "%5u ", half_word);
+            pos += write_dec_field(&line_buf[pos], half_word, 5);
         }
         return pos;
     }
 
     for (size_t i = 0; i < bytes_read; i+=4) {
         const uint32_t word = load_word(&buffer[i], bytes_read - i);
-        pos += snprintf(&line_buf[pos], MAX_LINE_BUF_LEN - pos, "%10u ", word);
+        pos += write_dec_field(&line_buf[pos], word, 10);
     }
     return pos;
 }
@@ -456,32 +474,23 @@ static void print_elide_line(const uint32_t n_lines)
     /* We need the length of msg to calculate padding,
      * so format the message into a temporary buffer. */
     char msg[128];
-    int msg_len = snprintf(msg, sizeof(msg), "   *** %u line%s of zero-bytes elided ***",
+    const int msg_len = snprintf(msg, sizeof(msg), "   *** %u line%s of zero-bytes elided ***",
         n_lines, n_lines == 1 ? "" : "s");
 
     /* Print the left well (12 spaces). */
-    for (int i = 0; i < WELL_WIDTH; i++) {
-        printf(" ");
-    }
+    io_pad(out, ' ', WELL_WIDTH);
 
     /* Print the elision message. */
-    printf("%s", msg);
+    io_write(out, msg, msg_len);
 
     /* Calculate and print the remaining gap to the next border. */
     if (msg_len < bin_width) {
-        int gap = bin_width - msg_len;
-        for (int i = 0; i < gap; i++) {
-            printf(" ");
-        }
+        io_pad(out, ' ', bin_width - msg_len);
     }
 
-    /* Pad the ASCII section. */
-    for (int i = 0; i < line_width + 2; i++) {
-        printf(" ");
-    }
-
-    /* Print the final newline. */
-    printf("\n");
+    /* Pad the ASCII section, and end the line. */
+    io_pad(out, ' ', line_width + 2);
+    io_putc(out, '\n');
 }
 
 /* Write the binary dump section of output. */
@@ -518,33 +527,30 @@ static void write_binary_dump(const uint8_t *buffer, const size_t bytes_read)
         pos += gap * pad_chars;
     }
 
-    fwrite(line_buf, 1, pos, stdout);
-    printf(" ");
+    line_buf[pos++] = ' ';
+    io_write(out, line_buf, pos);
 }
 
 static void write_ascii(const uint8_t *buffer, const size_t bytes_read)
 {
     if (!ascii) {
-        printf("\n");
+        io_putc(out, '\n');
         return;
     }
 
     for (size_t i = 0; i < bytes_read; i++) {
         if (buffer[i] >= 0x20 && buffer[i] < 0x7F) {
-            putchar(buffer[i]);
+            io_putc(out, buffer[i]);
         } else {
-            printf("%lc", MID_DOT);
+            io_write(out, mid_dot, mid_dot_len);
         }
     }
 
     /* Handle the padding gap. */
     if (bytes_read < line_width) {
-        const size_t gap = line_width - bytes_read;
-        for (size_t i = 0; i < gap; i++) {
-            putchar(' ');
-        }
+        io_pad(out, ' ', line_width - bytes_read);
     }
-    printf("\n");
+    io_putc(out, '\n');
 }
 
 /* Write the output. */
@@ -552,14 +558,7 @@ static void write_output(const uint8_t *buffer, const uint64_t offset, const siz
 {
     if (write_well(offset, bytes_read)) {
         /* Write the vertical bars for the last line. */
-        for (int i = 0; i < bin_width; i++) {
-            printf(" ");
-        }
-
-        for (size_t i = 0; i < line_width; i++) {
-            printf(" ");
-        }
-        printf("  ");
+        io_pad(out, ' ', bin_width + line_width + 2);
         return;
     }
     write_binary_dump(buffer, bytes_read);
@@ -638,6 +637,7 @@ int main(const int argc, char *argv[])
         { .name = "help",          .has_arg = no_argument,       .flag = nullptr, .val = 'h' },
         { .name = "version",       .has_arg = no_argument,       .flag = nullptr, .val = 'V' },
         { .name = "ascii",         .has_arg = no_argument,       .flag = nullptr, .val = 'a' },
+        STATS_LONG_OPT,
         { .name = nullptr,         .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -694,6 +694,9 @@ int main(const int argc, char *argv[])
             case 'h':
                 show_help();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -756,9 +759,15 @@ int main(const int argc, char *argv[])
     }
 
 
-    /* This forces printf to buffer CHUNK_SIZE before calling write(). */
-    char stdout_buffer[CHUNK_SIZE];
-    setvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));
+    /* Encode the ascii dump's placeholder once, rather than per byte. */
+    mbstate_t mbs = {0};
+    mid_dot_len = wcrtomb(mid_dot, MID_DOT, &mbs);
+    if (mid_dot_len == (size_t)-1) {
+        mid_dot[0] = '.';
+        mid_dot_len = 1;
+    }
+
+    out = io_stdout(APP_NAME);
 
     uint8_t file_buf[CHUNK_SIZE];
 
@@ -0,0 +1,241 @@
+/***************************************************************************
+ *   pool.h - an ordered pool of workers for many files                    *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+#include "common.h"
+
+/*
+ * Tools that take many files run them on a pool of workers. The main
+ * thread fills a ring of jobs a few batches per worker long, and takes
+ * each job back in turn once it is done, so results come out in the
+ * order given and memory stays bounded however many files there are.
+ * A worker claims up to a batch of consecutive jobs at once, a fair
+ * share of what is waiting so that a short ring still spreads over the
+ * pool. When no worker starts, the main thread runs each batch itself.
+ */
+#define POOL_MIN_WORKERS 8      /* Small files mostly wait on storage. */
+#define POOL_MAX_WORKERS 256
+
+struct pool;
+
+/* Fill job with the next one. Returns false when there are no more.
+ * Only the main thread calls it. */
+typedef bool (*pool_next_fn)(struct pool *p, void *job);
+
+/* Run the n jobs from first on, with the state of the thread running them. */
+typedef void (*pool_run_fn)(struct pool *p, void *state, size_t first, size_t n);
+
+struct pool {
+    /* Set by the caller. */
+    size_t job_size;
+    size_t batch;               /* The most jobs a worker claims at once. */
+    pool_next_fn next;
+    pool_run_fn run;
+    void *(*enter)(struct pool *p);     /* A worker's state, or nullptr. */
+    void (*leave)(struct pool *p, void *state);
+    void *arg;
+    const char *app_name;
+
+    /* Set by pool_start(). */
+    unsigned workers;           /* The workers that started. */
+    size_t window;
+    unsigned char *jobs;
+    bool *done;
+    void *self;                 /* The main thread's state. */
+    size_t added;               /* Jobs put in the ring so far. */
+    size_t claimed;             /* Jobs taken by workers so far. */
+    size_t taken;               /* Jobs handed back by pool_take(). */
+    bool holding;               /* The last of those is still in use. */
+    bool finished;              /* No more jobs are coming. */
+    pthread_t tids[POOL_MAX_WORKERS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done_cond;
+};
+
+/* The workers to ask for: requested, or with 0 one per CPU and at
+ * least POOL_MIN_WORKERS, but no more than files. Returns 0 when one
+ * thread will do. */
+static inline unsigned pool_workers(const unsigned requested, const size_t files)
+{
+    unsigned workers = requested;
+    if (workers == 0) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > POOL_MIN_WORKERS ? (unsigned)cpus : POOL_MIN_WORKERS;
+    }
+    if (files < workers) {
+        workers = files;
+    }
+    if (workers > POOL_MAX_WORKERS) {
+        workers = POOL_MAX_WORKERS;
+    }
+    return workers < 2 ? 0 : workers;
+}
+
+static inline void *pool_job(const struct pool *p, const size_t i)
+{
+    return p->jobs + (i % p->window) * p->job_size;
+}
+
+static inline void *pool_worker(void *arg)
+{
+    struct pool *p = arg;
+    void *state = p->enter != nullptr ? p->enter(p) : nullptr;
+
+    pthread_mutex_lock(&p->lock);
+    while (true) {
+        while (p->claimed == p->added && !p->finished) {
+            pthread_cond_wait(&p->work, &p->lock);
+        }
+        if (p->claimed == p->added) {
+            break;
+        }
+        const size_t waiting = p->added - p->claimed;
+        size_t n = (waiting + p->workers - 1) / p->workers;
+        n = n < p->batch ? n : p->batch;
+        const size_t first = p->claimed;
+        p->claimed += n;
+        pthread_mutex_unlock(&p->lock);
+
+        p->run(p, state, first, n);
+
+        pthread_mutex_lock(&p->lock);
+        for (size_t i = 0; i < n; i++) {
+            p->done[(first + i) % p->window] = true;
+        }
+        pthread_cond_broadcast(&p->done_cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    if (p->leave != nullptr) {
+        p->leave(p, state);
+    }
+    return nullptr;
+}
+
+/*
+ * Start up to workers threads, and make the ring per_worker batches
+ * long for each that started, or alone jobs long if none did. self is
+ * the state the main thread runs jobs with then.
+ */
+static inline void pool_start(struct pool *p, const unsigned workers, const size_t per_worker,
+                              const size_t alone, void *self)
+{
+    pthread_mutex_init(&p->lock, nullptr);
+    pthread_cond_init(&p->work, nullptr);
+    pthread_cond_init(&p->done_cond, nullptr);
+    p->added = p->claimed = p->taken = 0;
+    p->holding = p->finished = false;
+    p->self = self;
+
+    unsigned started = 0;
+    while (started < workers && started < POOL_MAX_WORKERS &&
+           pthread_create(&p->tids[started], nullptr, pool_worker, p) == 0) {
+        started++;
+    }
+
+    /* The workers wait for the first jobs, which are added under the lock. */
+    p->workers = started;
+    p->window = started ? started * p->batch * per_worker : alone;
+    p->jobs = calloc(p->window, p->job_size);
+    p->done = calloc(p->window, sizeof(*p->done));
+    if (p->jobs == nullptr || p->done == nullptr) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", p->app_name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * The next job in the order they were added, once it is done, or
+ * nullptr after the last. The job stays valid until the next call.
+ */
+static inline void *pool_take(struct pool *p)
+{
+    if (p->holding) {
+        p->taken++;
+        p->holding = false;
+    }
+
+    /* Keep the ring full. Only this thread adds jobs, and it hands
+     * them over a batch at a time. */
+    while (!p->finished && p->added - p->taken < p->window) {
+        size_t n = 0;
+        bool more = true;
+        while (n < p->batch && p->added + n - p->taken < p->window) {
+            const size_t i = p->added + n;
+            more = p->next(p, pool_job(p, i));
+            if (!more) {
+                break;
+            }
+            p->done[i % p->window] = false;
+            n++;
+        }
+
+        pthread_mutex_lock(&p->lock);
+        p->added += n;
+        p->finished = !more;
+        pthread_cond_broadcast(&p->work);
+        pthread_mutex_unlock(&p->lock);
+    }
+    if (p->taken == p->added) {
+        return nullptr;
+    }
+
+    const size_t i = p->taken % p->window;
+    if (p->workers == 0) {
+        while (!p->done[i]) {
+            const size_t waiting = p->added - p->claimed;
+            const size_t n = waiting < p->batch ? waiting : p->batch;
+            p->run(p, p->self, p->claimed, n);
+            for (const size_t end = p->claimed + n; p->claimed < end; p->claimed++) {
+                p->done[p->claimed % p->window] = true;
+            }
+        }
+    } else {
+        pthread_mutex_lock(&p->lock);
+        while (!p->done[i]) {
+            pthread_cond_wait(&p->done_cond, &p->lock);
+        }
+        pthread_mutex_unlock(&p->lock);
+    }
+    p->holding = true;
+    return pool_job(p, p->taken);
+}
+
+/* Wait for the workers and free the ring. Every job must have been taken. */
+static inline void pool_stop(struct pool *p)
+{
+    for (unsigned i = 0; i < p->workers; i++) {
+        pthread_join(p->tids[i], nullptr);
+    }
+    free(p->jobs);
+    free(p->done);
+    pthread_cond_destroy(&p->done_cond);
+    pthread_cond_destroy(&p->work);
+    pthread_mutex_destroy(&p->lock);
+}
+
+#endif /* POOL_H */
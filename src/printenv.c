@@ -68,6 +68,7 @@ int main(const int argc, char *argv[])
     struct option longopts[] = {
         {"help", 0, NULL, 'h'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {nullptr,0,nullptr,0}
     };
 
@@ -83,15 +84,18 @@ int main(const int argc, char *argv[])
             case 'h':
                 show_help();
                 exit(EXIT_SUCCESS);
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 exit(EXIT_FAILURE);
         }
     }
 
-    if (argc == 2) {
-        print_env(argv[1]);
-    } else if (argc == 1) {
+    if (argc - optind == 1) {
+        print_env(argv[optind]);
+    } else if (argc == optind) {
         print_all_env();
     } else {
         fprintf(stderr, "%s takes either zero or one argument\n", APP_NAME);
@@ -32,6 +32,8 @@
 
 #include "proc.h"
 #include "common.h"
+#include "idcache.h"
+#include "io.h"
 
 
 static const char *APP_NAME = "ps";
@@ -414,13 +416,14 @@ long double get_uptime_s()
         exit(EXIT_FAILURE);
     }
 
-    char buf[16];
-    const size_t n_read = fread(buf, 1, sizeof(buf), f);
+    char buf[32];
+    const size_t n_read = fread(buf, 1, sizeof(buf) - 1, f);
     if (n_read == 0) {
         fprintf(stderr, "Failed to read /proc/uptime");
         exit(EXIT_FAILURE);
     }
     buf[n_read] = '\0';
+    fclose(f);
 
     return strtold(buf, nullptr);
 }
@@ -494,17 +497,18 @@ char* get_tty(uint32_t device, char buf[]) {
 }
 
 void print_processes() {
+    struct io_writer *out = io_stdout(APP_NAME);
 
     /* Print the header. */
-    printf("%-*s ", USER_W, "USER");
-    printf("%*s ",  PID_W,  "PID");
-    printf("%*s ",  CPU_W,  "%CPU");
-    printf("%*s ",  MEM_W,  "%MEM");
-    printf("%*s ",  VSZ_W,  "VSZ");
-    printf("%*s ",  RSS_W,  "RSS");
-    printf("%*s ",  TTY_W,  "TTY");
-    printf("%*s ",  STAT_W, "STAT");
-    printf("%s\n", "COMMAND");
+    io_put_str(out, "USER", -USER_W); io_putc(out, ' ');
+    io_put_str(out, "PID",  PID_W);   io_putc(out, ' ');
+    io_put_str(out, "%CPU", CPU_W);   io_putc(out, ' ');
+    io_put_str(out, "%MEM", MEM_W);   io_putc(out, ' ');
+    io_put_str(out, "VSZ",  VSZ_W);   io_putc(out, ' ');
+    io_put_str(out, "RSS",  RSS_W);   io_putc(out, ' ');
+    io_put_str(out, "TTY",  TTY_W);   io_putc(out, ' ');
+    io_put_str(out, "STAT", STAT_W);  io_putc(out, ' ');
+    io_puts(out, "COMMAND\n");
 
     const uint32_t hertz = get_hertz();
     const long double sys_uptime = get_uptime_s();
@@ -514,81 +518,34 @@ void print_processes() {
     while (*proc_array != nullptr) {
         const proc_t *proc_stat = *proc_array;
 
-        printf("%-*s ", USER_W, get_username(proc_stat->euid));
-        printf("%*u ",  PID_W,  proc_stat->pid);
-        printf("%5.1Lf ", get_cpu_percent(hertz, sys_uptime,
-            proc_stat->utime, proc_stat->stime, proc_stat->start_time));
-        printf("%5.1Lf ", get_mem_percent(mem_t, proc_stat->vm_rss));
-        printf("%*u ",  VSZ_W,  proc_stat->vm_size);
-        printf("%*u ",  RSS_W,  proc_stat->vm_rss);
+        io_put_str(out, get_username(proc_stat->euid), -USER_W);
+        io_putc(out, ' ');
+        io_put_uint(out, proc_stat->pid, PID_W);
+        io_putc(out, ' ');
+        io_put_fixed(out, get_cpu_percent(hertz, sys_uptime,
+            proc_stat->utime, proc_stat->stime, proc_stat->start_time), 1, 5);
+        io_putc(out, ' ');
+        io_put_fixed(out, get_mem_percent(mem_t, proc_stat->vm_rss), 1, 5);
+        io_putc(out, ' ');
+        io_put_uint(out, proc_stat->vm_size, VSZ_W);
+        io_putc(out, ' ');
+        io_put_uint(out, proc_stat->vm_rss, RSS_W);
+        io_putc(out, ' ');
         get_tty(proc_stat->tty_nr, tty_buf);
-        printf("%*s ",  TTY_W,  tty_buf);
-        printf("%*c ",  STAT_W, proc_stat->state);
+        io_put_str(out, tty_buf, TTY_W);
+        io_putc(out, ' ');
+        io_pad(out, ' ', STAT_W - 1);
+        io_putc(out, proc_stat->state);
+        io_putc(out, ' ');
         if (proc_stat->k_thread) {
-            printf("[%s]\n", proc_stat->name);
+            io_putc(out, '[');
+            io_puts(out, proc_stat->name);
+            io_puts(out, "]\n");
         } else {
-            printf("%s\n", proc_stat->cmdline);
+            io_puts(out, proc_stat->cmdline);
+            io_putc(out, '\n');
         }
 
-
-        //
-        //
-        // printf("name: '%s' ", proc_stat->name);
-        // printf("cmdline: '%s' ", proc_stat->cmdline);
-        // printf("kthread: %d ", proc_stat->k_thread);
-        // printf("vm exe: %u ", proc_stat->vm_exe);
-        // printf("vm hwm: %u ", proc_stat->vm_hwm);
-        // printf("vm lck: %u ", proc_stat->vm_lck);
-        // printf("vm peak: %u ", proc_stat->vm_peak);
-        // printf("vm lib: %u ", proc_stat->vm_lib);
-        // printf("vm data: %u ", proc_stat->vm_data);
-        // printf("vm rss: %u ", proc_stat->vm_rss);
-        // printf("vm size: %u ", proc_stat->vm_size);
-        //
-        // printf("euid: %u ", proc_stat->euid);
-        // printf("ruid: %u ", proc_stat->ruid);
-        // printf("suid: %u ", proc_stat->suid);
-        // printf("fuid: %u ", proc_stat->fuid);
-        // printf("egid: %u ", proc_stat->egid);
-        // printf("rgid: %u ", proc_stat->rgid);
-        // printf("sgid: %u ", proc_stat->sgid);
-        // printf("fgid: %u ", proc_stat->fgid);
-        //
-        // printf("pid: %d ", proc_stat->pid);
-        // printf("state: %c ", proc_stat->state);
-        // printf("ppid: %d ", proc_stat->ppid);
-        // printf("pgrp: %d ", proc_stat->pgrp);
-        // printf("sid: %d ", proc_stat->sid);
-        // printf("tty_nr: %d ", proc_stat->tty_nr);
-        // printf("tty_pgrp: %d ", proc_stat->tty_pgrp);
-        // printf("flags: %lu ", proc_stat->flags);
-        // printf("min_flt: %lu ", proc_stat->min_flt);
-        // printf("cmin_flt: %lu ", proc_stat->cmin_flt);
-        // printf("maj_flt: %lu ", proc_stat->maj_flt);
-        // printf("cmaj_flt: %lu ", proc_stat->cmaj_flt);
-        // printf("utime: %lu ", proc_stat->utime);
-        // printf("stime: %lu ", proc_stat->stime);
-        // printf("cstime: %lu ", proc_stat->cstime);
-        // printf("priority: %d ", proc_stat->priority);
-        // printf("nice: %d ", proc_stat->nice);
-        // printf("num_threads: %d ", proc_stat->num_threads);
-        // printf("start_time: %lu ", proc_stat->start_time);
-        // printf("vsize: %u ", proc_stat->vsize);
-        // printf("rss: %u ", proc_stat->rss);
-        // printf("rsslim: %u ", proc_stat->rsslim);
-        // printf("start_code: %u ", proc_stat->start_code);
-        // printf("end_code: %u ", proc_stat->end_code);
-        // printf("start_stack: %u ", proc_stat->start_stack);
-        // printf("esp: %u ", proc_stat->esp);
-        // printf("eip: %u ", proc_stat->eip);
-        // printf("exit_signal: %u ", proc_stat->exit_signal);
-        // printf("task_cpu: %u ", proc_stat->task_cpu);
-        // printf("rt_priority: %u ", proc_stat->rt_priority);
-        // printf("policy: %u ", proc_stat->policy);
-        // printf("blkio_ticks: %lu ", proc_stat->blkio_ticks);
-        // printf("cgtime: %lu ", proc_stat->cgtime);
-        // printf("\n\n");
-
         proc_array++;
     }
 }
@@ -601,6 +558,7 @@ int main(const int argc, char** argv ) {
         { .name = "version",    .has_arg = no_argument,       .flag = nullptr, .val = 'V' },
         { .name = "all",     .has_arg = no_argument,       .flag = nullptr, .val = 'a' },
         { .name = "everyone",  .has_arg = no_argument,       .flag = nullptr, .val = 'e' },
+        STATS_LONG_OPT,
         { .name = nullptr,      .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -622,6 +580,9 @@ int main(const int argc, char** argv ) {
             case 'e':
                 opts.cur_uid = false;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 EXIT_FAILURE;
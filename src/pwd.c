@@ -42,6 +42,7 @@ int main(int argc, char *argv[])
     const struct option longopts[] = {
         {"help", 0, NULL, 'h'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {0,0,0,0}
     };
 
@@ -57,6 +58,9 @@ int main(int argc, char *argv[])
             case 'h':
                 show_help();
                 exit(EXIT_SUCCESS);
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 exit(EXIT_FAILURE);
@@ -71,6 +71,7 @@ int main(const int argc, char *argv[]) {
         {"recursive", 0, NULL, 'R'},
         {"verbose", 0, NULL, 'v'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {NULL,0,NULL,0}
     };
 
@@ -99,6 +100,9 @@ int main(const int argc, char *argv[]) {
                        strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__,
                        __DATE__, __TIME__);
                 exit(EXIT_SUCCESS);
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 showHelp();
                 exit(EXIT_FAILURE);
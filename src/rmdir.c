@@ -47,6 +47,7 @@ int main(int argc, char *argv[]) {
         {"verbose", 0, NULL, 'v'},
         {"help", 0, NULL, 'h'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {0,0,0,0}
     };
 
@@ -66,6 +67,9 @@ int main(int argc, char *argv[]) {
                 show_help();
                 exit(EXIT_SUCCESS);
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 exit(EXIT_FAILURE);
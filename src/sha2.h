@@ -24,34 +24,39 @@
 #define SHA2_H
 
 #include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "cpu.h"
 
 #define INT_32_BITS 32
 #define INT_64_BITS 64
 
 
-uint32_t *words;
-uint64_t *l_words;
-uint8_t  *in_buf;
-
-/* The eight 32-bit unsigned registers used by sha224/256. */
-uint32_t reg_h0;
-uint32_t reg_h1;
-uint32_t reg_h2;
-uint32_t reg_h3;
-uint32_t reg_h4;
-uint32_t reg_h5;
-uint32_t reg_h6;
-uint32_t reg_h7;
-
-/* The eight 64-bit unsigned registers used by sha384/512. */
-uint64_t reg64_h0;
-uint64_t reg64_h1;
-uint64_t reg64_h2;
-uint64_t reg64_h3;
-uint64_t reg64_h4;
-uint64_t reg64_h5;
-uint64_t reg64_h6;
-uint64_t reg64_h7;
+#define SHA256_BLOCK_SIZE  64
+#define SHA512_BLOCK_SIZE  128
+#define SHA224_DIGEST_SIZE 28
+#define SHA256_DIGEST_SIZE 32
+#define SHA384_DIGEST_SIZE 48
+#define SHA512_DIGEST_SIZE 64
+
+/* The initial values of the eight registers for each digest. */
+constexpr uint32_t sha224_init_regs[] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+                                          0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4 };
+constexpr uint32_t sha256_init_regs[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+constexpr uint64_t sha384_init_regs[] = { 0xcbbb9d5dc1059ed8, 0x629a292a367cd507,
+                                          0x9159015a3070dd17, 0x152fecd8f70e5939,
+                                          0x67332667ffc00b31, 0x8eb44a8768581511,
+                                          0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4 };
+constexpr uint64_t sha512_init_regs[] = { 0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
+                                          0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+                                          0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+                                          0x1f83d9abfb41bd6b, 0x5be0cd19137e2179 };
 
 /* A 64-element array k32[1 ... 64] constructed from the
  * first 32 bits of the fractional parts of the cube
@@ -98,17 +103,17 @@ constexpr uint64_t k64[] = { 0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfe
                              0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
 
 /* Right-rotate n by d bits. */
-inline extern uint32_t right_rotate_32(const uint32_t n, const uint8_t d)
+static inline uint32_t right_rotate_32(const uint32_t n, const uint8_t d)
 {
     return (n >> d) | (n << (INT_32_BITS - d));
 }
 
-inline extern uint64_t right_rotate_64(const uint64_t n, const uint8_t d)
+static inline uint64_t right_rotate_64(const uint64_t n, const uint8_t d)
 {
     return (n >> d) | (n << (INT_64_BITS - d));
 }
 
-inline extern void encode_words_32(const uint8_t *chunk)
+static inline void encode_words_32(const uint8_t *chunk, uint32_t words[64])
 {
     /* Combine bytes into 32-bit big-endian words. */
     for (int j = 0; j < 16; j++) {
@@ -131,7 +136,8 @@ inline extern void encode_words_32(const uint8_t *chunk)
     }
 }
 
-inline extern void encode_words_64(const uint8_t *chunk) {
+static inline void encode_words_64(const uint8_t *chunk, uint64_t l_words[80])
+{
     /* Combine bytes into 64-bit big-endian words. */
     for (int j = 0; j < 16; j++) {
         l_words[j] = ((uint64_t)chunk[8 * j]     << 56) |
@@ -157,18 +163,20 @@ inline extern void encode_words_64(const uint8_t *chunk) {
     }
 }
 
-inline extern void process_chunk_32(const uint8_t *chunk)
+/* Mix one 64-byte chunk into the registers reg[0..7]. */
+static inline void process_chunk_32(uint32_t reg[8], const uint8_t *chunk)
 {
-    encode_words_32(chunk);
+    uint32_t words[64];
+    encode_words_32(chunk, words);
 
-    uint32_t a = reg_h0;
-    uint32_t b = reg_h1;
-    uint32_t c = reg_h2;
-    uint32_t d = reg_h3;
-    uint32_t e = reg_h4;
-    uint32_t f = reg_h5;
-    uint32_t g = reg_h6;
-    uint32_t h = reg_h7;
+    uint32_t a = reg[0];
+    uint32_t b = reg[1];
+    uint32_t c = reg[2];
+    uint32_t d = reg[3];
+    uint32_t e = reg[4];
+    uint32_t f = reg[5];
+    uint32_t g = reg[6];
+    uint32_t h = reg[7];
 
     for (int i = 0; i < 64; i++) {
         const uint32_t S1 = right_rotate_32(e, 6) ^ right_rotate_32(e, 11) ^ right_rotate_32(e, 25);
@@ -188,55 +196,678 @@ inline extern void process_chunk_32(const uint8_t *chunk)
         a = temp1 + temp2;
     }
 
-    reg_h0 += a;
-    reg_h1 += b;
-    reg_h2 += c;
-    reg_h3 += d;
-    reg_h4 += e;
-    reg_h5 += f;
-    reg_h6 += g;
-    reg_h7 += h;
+    reg[0] += a;
+    reg[1] += b;
+    reg[2] += c;
+    reg[3] += d;
+    reg[4] += e;
+    reg[5] += f;
+    reg[6] += g;
+    reg[7] += h;
+}
+
+/*
+ * Mix n consecutive 64-byte chunks into reg[0..7]. SHA-NI on x86 and
+ * the SHA-2 crypto extension on ARMv8 run the rounds in hardware;
+ * sha256_update() picks one of these when the context is set up.
+ */
+typedef void (*sha256_blocks_fn)(uint32_t reg[8], const uint8_t *p, size_t n);
+
+static inline void sha256_blocks_scalar(uint32_t reg[8], const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += SHA256_BLOCK_SIZE) {
+        process_chunk_32(reg, p);
+    }
 }
 
-inline extern void process_chunk_64(const uint8_t *chunk)
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * sha256rnds2 runs two rounds on the registers split as ABEF and CDGH,
+ * taking the message words plus constants from the low half of its
+ * third operand. sha256msg1 and sha256msg2 extend the schedule four
+ * words at a time.
+ */
+CPU_TARGET_SHANI
+static void sha256_blocks_shani(uint32_t reg[8], const uint8_t *p, size_t n)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&reg[0]), 0xb1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&reg[4]), 0x1b);
+    __m128i abef = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+    for (; n > 0; n--, p += SHA256_BLOCK_SIZE) {
+        const __m128i abef_save = abef;
+        const __m128i cdgh_save = cdgh;
+        __m128i m[4];
+
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; i++) {
+            __m128i w;
+            if (i < 4) {
+                w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16 * i)), bswap);
+            } else {
+                w = _mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+                w = _mm_sha256msg2_epu32(w, m[(i + 3) & 3]);
+            }
+            m[i & 3] = w;
+
+            const __m128i wk = _mm_add_epi32(w, _mm_loadu_si128((const __m128i *)&k32[4 * i]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e));
+        }
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32(abef, 0x1b);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128((__m128i *)&reg[0], _mm_blend_epi16(tmp, cdgh, 0xf0));
+    _mm_storeu_si128((__m128i *)&reg[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+#elif defined(__aarch64__)
+/* vsha256hq and vsha256h2q each advance one half of the registers by four rounds. */
+CPU_TARGET_ARMSHA2
+static void sha256_blocks_armv8(uint32_t reg[8], const uint8_t *p, size_t n)
 {
-    encode_words_64(chunk);
+    uint32x4_t abcd = vld1q_u32(&reg[0]);
+    uint32x4_t efgh = vld1q_u32(&reg[4]);
+
+    for (; n > 0; n--, p += SHA256_BLOCK_SIZE) {
+        const uint32x4_t abcd_save = abcd;
+        const uint32x4_t efgh_save = efgh;
+        uint32x4_t m[4];
+
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16 * i)));
+            } else {
+                m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]),
+                                           m[(i + 2) & 3], m[(i + 3) & 3]);
+            }
 
-    uint64_t a = reg64_h0;
-    uint64_t b = reg64_h1;
-    uint64_t c = reg64_h2;
-    uint64_t d = reg64_h3;
-    uint64_t e = reg64_h4;
-    uint64_t f = reg64_h5;
-    uint64_t g = reg64_h6;
-    uint64_t h = reg64_h7;
+            const uint32x4_t wk = vaddq_u32(m[i & 3], vld1q_u32(&k32[4 * i]));
+            const uint32x4_t prev = abcd;
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, prev, wk);
+        }
+
+        abcd = vaddq_u32(abcd, abcd_save);
+        efgh = vaddq_u32(efgh, efgh_save);
+    }
+
+    vst1q_u32(&reg[0], abcd);
+    vst1q_u32(&reg[4], efgh);
+}
+#endif
+
+static const struct {
+    uint32_t needs;
+    const char *isa;
+    sha256_blocks_fn fn;
+} sha256_blocks_impls[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { .needs = CPU_SHANI,   .isa = "sha-ni", .fn = sha256_blocks_shani },
+#elif defined(__aarch64__)
+    { .needs = CPU_ARMSHA2, .isa = "sha2",   .fn = sha256_blocks_armv8 },
+#endif
+    { .needs = 0,           .isa = "scalar", .fn = sha256_blocks_scalar },
+};
+
+/*
+ * Multi-buffer SHA-256: each SIMD lane runs the rounds of a different
+ * message, so a tree of small files keeps every lane busy where one
+ * stream would use a single one. The state is kept word-major,
+ * st[word][lane], so each register loads as one vector. A call hashes
+ * n chunks from each lane's data pointer; lanes the caller has no
+ * message for may point at another lane's data, and their state is
+ * just ignored.
+ */
+#define SHA256_MB_MAX_LANES 16
+
+typedef void (*sha256_mb_fn)(uint32_t st[8][SHA256_MB_MAX_LANES],
+                             const uint8_t *const data[], size_t n);
+
+#if defined(__x86_64__) || defined(__i386__)
+CPU_TARGET_AVX2
+static inline __m256i sha256_mb_ror_avx2(const __m256i x, const int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+/* Load words 8 * half .. 8 * half + 7 of block i of eight lanes, as w[word][lane]. */
+CPU_TARGET_AVX2
+static inline void sha256_mb_load8_avx2(__m256i w[8], const uint8_t *const data[8],
+                                        const size_t i, const int half)
+{
+    const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+                                            0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m256i r[8], t[8];
+    for (int l = 0; l < 8; l++) {
+        r[l] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(data[l] + i * 64 + half * 32)),
+                                   bswap);
+    }
+
+    /* An 8x8 transpose of 32-bit words. */
+    for (int l = 0; l < 8; l += 2) {
+        t[l]     = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+        t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+    }
+    for (int l = 0; l < 8; l += 4) {
+        r[l]     = _mm256_unpacklo_epi64(t[l], t[l + 2]);
+        r[l + 1] = _mm256_unpackhi_epi64(t[l], t[l + 2]);
+        r[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+        r[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+    }
+    for (int j = 0; j < 4; j++) {
+        w[j]     = _mm256_permute2x128_si256(r[j], r[j + 4], 0x20);
+        w[j + 4] = _mm256_permute2x128_si256(r[j], r[j + 4], 0x31);
+    }
+}
+
+CPU_TARGET_AVX2
+static void sha256_mb_avx2(uint32_t st[8][SHA256_MB_MAX_LANES], const uint8_t *const data[], size_t n)
+{
+    __m256i reg[8];
+    for (int j = 0; j < 8; j++) {
+        reg[j] = _mm256_loadu_si256((const __m256i *)st[j]);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        __m256i w[16];
+        sha256_mb_load8_avx2(w, data, i, 0);
+        sha256_mb_load8_avx2(w + 8, data, i, 1);
+
+        __m256i a = reg[0], b = reg[1], c = reg[2], d = reg[3];
+        __m256i e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+        for (int t = 0; t < 64; t++) {
+            if (t >= 16) {
+                const __m256i w15 = w[(t - 15) & 15];
+                const __m256i w2 = w[(t - 2) & 15];
+                const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha256_mb_ror_avx2(w15, 7),
+                                                                     sha256_mb_ror_avx2(w15, 18)),
+                                                    _mm256_srli_epi32(w15, 3));
+                const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha256_mb_ror_avx2(w2, 17),
+                                                                     sha256_mb_ror_avx2(w2, 19)),
+                                                    _mm256_srli_epi32(w2, 10));
+                w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+                                             _mm256_add_epi32(w[(t - 7) & 15], s1));
+            }
+
+            const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha256_mb_ror_avx2(e, 6),
+                                                                 sha256_mb_ror_avx2(e, 11)),
+                                                sha256_mb_ror_avx2(e, 25));
+            const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            const __m256i temp1 = _mm256_add_epi32(_mm256_add_epi32(h, s1),
+                                                   _mm256_add_epi32(_mm256_add_epi32(ch, w[t & 15]),
+                                                                    _mm256_set1_epi32((int)k32[t])));
+            const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha256_mb_ror_avx2(a, 2),
+                                                                 sha256_mb_ror_avx2(a, 13)),
+                                                sha256_mb_ror_avx2(a, 22));
+            const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b),
+                                                _mm256_and_si256(c, _mm256_or_si256(a, b)));
+
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi32(d, temp1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm256_add_epi32(temp1, _mm256_add_epi32(s0, maj));
+        }
+
+        reg[0] = _mm256_add_epi32(reg[0], a);
+        reg[1] = _mm256_add_epi32(reg[1], b);
+        reg[2] = _mm256_add_epi32(reg[2], c);
+        reg[3] = _mm256_add_epi32(reg[3], d);
+        reg[4] = _mm256_add_epi32(reg[4], e);
+        reg[5] = _mm256_add_epi32(reg[5], f);
+        reg[6] = _mm256_add_epi32(reg[6], g);
+        reg[7] = _mm256_add_epi32(reg[7], h);
+    }
+
+    for (int j = 0; j < 8; j++) {
+        _mm256_storeu_si256((__m256i *)st[j], reg[j]);
+    }
+}
+
+/* As above, but sixteen lanes, with native rotates and three-input logic ops. */
+CPU_TARGET_AVX512
+static void sha256_mb_avx512(uint32_t st[8][SHA256_MB_MAX_LANES], const uint8_t *const data[], size_t n)
+{
+    __m512i reg[8];
+    for (int j = 0; j < 8; j++) {
+        reg[j] = _mm512_loadu_si512(st[j]);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        __m512i w[16];
+        for (int half = 0; half < 2; half++) {
+            __m256i lo[8], hi[8];
+            sha256_mb_load8_avx2(lo, data, i, half);
+            sha256_mb_load8_avx2(hi, data + 8, i, half);
+            for (int j = 0; j < 8; j++) {
+                w[half * 8 + j] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[j]), hi[j], 1);
+            }
+        }
+
+        __m512i a = reg[0], b = reg[1], c = reg[2], d = reg[3];
+        __m512i e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+        for (int t = 0; t < 64; t++) {
+            if (t >= 16) {
+                const __m512i w15 = w[(t - 15) & 15];
+                const __m512i w2 = w[(t - 2) & 15];
+                const __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7),
+                                                             _mm512_ror_epi32(w15, 18),
+                                                             _mm512_srli_epi32(w15, 3), 0x96);
+                const __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17),
+                                                             _mm512_ror_epi32(w2, 19),
+                                                             _mm512_srli_epi32(w2, 10), 0x96);
+                w[t & 15] = _mm512_add_epi32(_mm512_add_epi32(w[t & 15], s0),
+                                             _mm512_add_epi32(w[(t - 7) & 15], s1));
+            }
+
+            const __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11),
+                                                         _mm512_ror_epi32(e, 25), 0x96);
+            const __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xca);
+            const __m512i temp1 = _mm512_add_epi32(_mm512_add_epi32(h, s1),
+                                                   _mm512_add_epi32(_mm512_add_epi32(ch, w[t & 15]),
+                                                                    _mm512_set1_epi32((int)k32[t])));
+            const __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13),
+                                                         _mm512_ror_epi32(a, 22), 0x96);
+            const __m512i maj = _mm512_ternarylogic_epi32(a, b, c, 0xe8);
+
+            h = g;
+            g = f;
+            f = e;
+            e = _mm512_add_epi32(d, temp1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm512_add_epi32(temp1, _mm512_add_epi32(s0, maj));
+        }
+
+        reg[0] = _mm512_add_epi32(reg[0], a);
+        reg[1] = _mm512_add_epi32(reg[1], b);
+        reg[2] = _mm512_add_epi32(reg[2], c);
+        reg[3] = _mm512_add_epi32(reg[3], d);
+        reg[4] = _mm512_add_epi32(reg[4], e);
+        reg[5] = _mm512_add_epi32(reg[5], f);
+        reg[6] = _mm512_add_epi32(reg[6], g);
+        reg[7] = _mm512_add_epi32(reg[7], h);
+    }
+
+    for (int j = 0; j < 8; j++) {
+        _mm512_storeu_si512(st[j], reg[j]);
+    }
+}
+#endif
+
+/*
+ * SHA-NI outruns eight AVX2 lanes on one long message, but the lanes
+ * still win on a tree of small files, where reading each file whole
+ * into a lane costs less than streaming it. With no lanes, files are
+ * hashed one at a time.
+ */
+static const struct {
+    uint32_t needs;
+    const char *isa;
+    size_t lanes;
+    sha256_mb_fn fn;
+} sha256_mb_impls[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { .needs = CPU_AVX512, .isa = "avx512", .lanes = 16, .fn = sha256_mb_avx512 },
+    { .needs = CPU_AVX2,   .isa = "avx2",   .lanes = 8,  .fn = sha256_mb_avx2 },
+#endif
+    { .needs = 0,          .isa = "scalar", .lanes = 0,  .fn = nullptr },
+};
+
+/*
+ * One SHA-512 round, with the roles of the registers passed in rather
+ * than shifted along: the caller rotates the argument list instead,
+ * so eight unrolled rounds leave every value where it started.
+ */
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, wk) do {                                        \
+        const uint64_t t1 = (h) + (right_rotate_64((e), 14) ^ right_rotate_64((e), 18) ^     \
+                                   right_rotate_64((e), 41)) + ((g) ^ ((e) & ((f) ^ (g)))) + \
+                            (wk);                                                            \
+        const uint64_t t2 = (right_rotate_64((a), 28) ^ right_rotate_64((a), 34) ^           \
+                             right_rotate_64((a), 39)) + (((a) & (b)) ^ ((c) & ((a) ^ (b)))); \
+        (d) += t1;                                                                           \
+        (h) = t1 + t2;                                                                       \
+    } while (0)
+
+/* Run the 80 rounds over reg[0..7], taking W[t] + K[t] from wk[t * stride]. */
+static inline void sha512_rounds(uint64_t reg[8], const uint64_t *wk, const size_t stride)
+{
+    uint64_t a = reg[0];
+    uint64_t b = reg[1];
+    uint64_t c = reg[2];
+    uint64_t d = reg[3];
+    uint64_t e = reg[4];
+    uint64_t f = reg[5];
+    uint64_t g = reg[6];
+    uint64_t h = reg[7];
+
+    for (int t = 0; t < 80; t += 8) {
+        SHA512_ROUND(a, b, c, d, e, f, g, h, wk[(t + 0) * stride]);
+        SHA512_ROUND(h, a, b, c, d, e, f, g, wk[(t + 1) * stride]);
+        SHA512_ROUND(g, h, a, b, c, d, e, f, wk[(t + 2) * stride]);
+        SHA512_ROUND(f, g, h, a, b, c, d, e, wk[(t + 3) * stride]);
+        SHA512_ROUND(e, f, g, h, a, b, c, d, wk[(t + 4) * stride]);
+        SHA512_ROUND(d, e, f, g, h, a, b, c, wk[(t + 5) * stride]);
+        SHA512_ROUND(c, d, e, f, g, h, a, b, wk[(t + 6) * stride]);
+        SHA512_ROUND(b, c, d, e, f, g, h, a, wk[(t + 7) * stride]);
+    }
+
+    reg[0] += a;
+    reg[1] += b;
+    reg[2] += c;
+    reg[3] += d;
+    reg[4] += e;
+    reg[5] += f;
+    reg[6] += g;
+    reg[7] += h;
+}
+
+/* Mix one 128-byte chunk into the registers reg[0..7]. */
+static inline void process_chunk_64(uint64_t reg[8], const uint8_t *chunk)
+{
+    uint64_t l_words[80];
+    encode_words_64(chunk, l_words);
 
     for (int i = 0; i < 80; i++) {
-        const uint64_t S1 = right_rotate_64(e, 14) ^ right_rotate_64(e, 18) ^ right_rotate_64(e, 41);
-        const uint64_t ch = g ^ (e & (f ^ g));
-        const uint64_t temp1 = h + S1 + ch + k64[i] + l_words[i];
-        const uint64_t S0 = right_rotate_64(a, 28) ^ right_rotate_64(a, 34) ^ right_rotate_64(a, 39);
-        const uint64_t maj = (a & b) ^ (c & (a ^ b));
-        const uint64_t temp2 = S0 + maj;
+        l_words[i] += k64[i];
+    }
+    sha512_rounds(reg, l_words, 1);
+}
 
-        h = g;
-        g = f;
-        f = e;
-        e = d + temp1;
-        d = c;
-        c = b;
-        b = a;
-        a = temp1 + temp2;
+/*
+ * Mix n consecutive 128-byte chunks into reg[0..7]. The rounds of one
+ * chunk depend on the last, but the message schedules do not, so the
+ * vector versions expand the schedules of four or eight chunks at
+ * once, one chunk per lane, and then run the rounds of each in turn.
+ */
+typedef void (*sha512_blocks_fn)(uint64_t reg[8], const uint8_t *p, size_t n);
+
+static inline void sha512_blocks_scalar(uint64_t reg[8], const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += SHA512_BLOCK_SIZE) {
+        process_chunk_64(reg, p);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+CPU_TARGET_AVX2
+static inline __m256i sha512_ror_avx2(const __m256i x, const int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n));
+}
+
+CPU_TARGET_AVX2
+static void sha512_blocks_avx2(uint64_t reg[8], const uint8_t *p, size_t n)
+{
+    const __m256i bswap = _mm256_set_epi64x(0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+                                            0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL);
+    const __m256i lanes = _mm256_set_epi64x(3 * SHA512_BLOCK_SIZE, 2 * SHA512_BLOCK_SIZE,
+                                            SHA512_BLOCK_SIZE, 0);
+    alignas(32) uint64_t wk[80][4];
+
+    for (; n >= 4; n -= 4, p += 4 * SHA512_BLOCK_SIZE) {
+        __m256i w[16];
+        for (int t = 0; t < 80; t++) {
+            if (t < 16) {
+                w[t] = _mm256_shuffle_epi8(_mm256_i64gather_epi64((const long long *)(p + 8 * t),
+                                                                  lanes, 1), bswap);
+            } else {
+                const __m256i w15 = w[(t - 15) & 15];
+                const __m256i w2 = w[(t - 2) & 15];
+                const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha512_ror_avx2(w15, 1),
+                                                                     sha512_ror_avx2(w15, 8)),
+                                                    _mm256_srli_epi64(w15, 7));
+                const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha512_ror_avx2(w2, 19),
+                                                                     sha512_ror_avx2(w2, 61)),
+                                                    _mm256_srli_epi64(w2, 6));
+                w[t & 15] = _mm256_add_epi64(_mm256_add_epi64(w[t & 15], s0),
+                                             _mm256_add_epi64(w[(t - 7) & 15], s1));
+            }
+            _mm256_store_si256((__m256i *)wk[t],
+                               _mm256_add_epi64(w[t & 15], _mm256_set1_epi64x((long long)k64[t])));
+        }
+
+        for (int l = 0; l < 4; l++) {
+            sha512_rounds(reg, &wk[0][l], 4);
+        }
+    }
+    sha512_blocks_scalar(reg, p, n);
+}
+
+CPU_TARGET_AVX512
+static void sha512_blocks_avx512(uint64_t reg[8], const uint8_t *p, size_t n)
+{
+    const __m512i bswap = _mm512_set_epi64(0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+                                           0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+                                           0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+                                           0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL);
+    const __m512i lanes = _mm512_set_epi64(7 * SHA512_BLOCK_SIZE, 6 * SHA512_BLOCK_SIZE,
+                                           5 * SHA512_BLOCK_SIZE, 4 * SHA512_BLOCK_SIZE,
+                                           3 * SHA512_BLOCK_SIZE, 2 * SHA512_BLOCK_SIZE,
+                                           SHA512_BLOCK_SIZE, 0);
+    alignas(64) uint64_t wk[80][8];
+
+    for (; n >= 8; n -= 8, p += 8 * SHA512_BLOCK_SIZE) {
+        __m512i w[16];
+        for (int t = 0; t < 80; t++) {
+            if (t < 16) {
+                w[t] = _mm512_shuffle_epi8(_mm512_i64gather_epi64(lanes, p + 8 * t, 1), bswap);
+            } else {
+                const __m512i w15 = w[(t - 15) & 15];
+                const __m512i w2 = w[(t - 2) & 15];
+                const __m512i s0 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w15, 1),
+                                                             _mm512_ror_epi64(w15, 8),
+                                                             _mm512_srli_epi64(w15, 7), 0x96);
+                const __m512i s1 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w2, 19),
+                                                             _mm512_ror_epi64(w2, 61),
+                                                             _mm512_srli_epi64(w2, 6), 0x96);
+                w[t & 15] = _mm512_add_epi64(_mm512_add_epi64(w[t & 15], s0),
+                                             _mm512_add_epi64(w[(t - 7) & 15], s1));
+            }
+            _mm512_store_si512(wk[t], _mm512_add_epi64(w[t & 15], _mm512_set1_epi64((long long)k64[t])));
+        }
+
+        for (int l = 0; l < 8; l++) {
+            sha512_rounds(reg, &wk[0][l], 8);
+        }
+    }
+    sha512_blocks_avx2(reg, p, n);
+}
+#endif
+
+static const struct {
+    uint32_t needs;
+    const char *isa;
+    sha512_blocks_fn fn;
+} sha512_blocks_impls[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { .needs = CPU_AVX512, .isa = "avx512", .fn = sha512_blocks_avx512 },
+    { .needs = CPU_AVX2,   .isa = "avx2",   .fn = sha512_blocks_avx2 },
+#endif
+    { .needs = 0,          .isa = "scalar", .fn = sha512_blocks_scalar },
+};
+
+/*
+ * Digests in progress. SHA-224 is SHA-256 with other initial values and
+ * a shorter output, and SHA-384 is the same to SHA-512, so each pair
+ * shares a context type and update function.
+ */
+struct sha256_ctx {
+    uint32_t reg[8];
+    uint64_t length;                    /* Bytes hashed so far. */
+    uint8_t buf[SHA256_BLOCK_SIZE];     /* A partial chunk. */
+    size_t buf_len;
+    size_t digest_size;
+    sha256_blocks_fn blocks;
+};
+
+struct sha512_ctx {
+    uint64_t reg[8];
+    uint64_t length;
+    uint8_t buf[SHA512_BLOCK_SIZE];
+    size_t buf_len;
+    size_t digest_size;
+    sha512_blocks_fn blocks;
+};
+
+static inline void sha224_init(struct sha256_ctx *ctx)
+{
+    memcpy(ctx->reg, sha224_init_regs, sizeof(ctx->reg));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+    ctx->digest_size = SHA224_DIGEST_SIZE;
+    ctx->blocks = CPU_SELECT(sha256_blocks_impls)->fn;
+}
+
+static inline void sha256_init(struct sha256_ctx *ctx)
+{
+    memcpy(ctx->reg, sha256_init_regs, sizeof(ctx->reg));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+    ctx->digest_size = SHA256_DIGEST_SIZE;
+    ctx->blocks = CPU_SELECT(sha256_blocks_impls)->fn;
+}
+
+static inline void sha384_init(struct sha512_ctx *ctx)
+{
+    memcpy(ctx->reg, sha384_init_regs, sizeof(ctx->reg));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+    ctx->digest_size = SHA384_DIGEST_SIZE;
+    ctx->blocks = CPU_SELECT(sha512_blocks_impls)->fn;
+}
+
+static inline void sha512_init(struct sha512_ctx *ctx)
+{
+    memcpy(ctx->reg, sha512_init_regs, sizeof(ctx->reg));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+    ctx->digest_size = SHA512_DIGEST_SIZE;
+    ctx->blocks = CPU_SELECT(sha512_blocks_impls)->fn;
+}
+
+/* Hash len more bytes of the message. */
+static inline void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    ctx->length += len;
+
+    if (ctx->buf_len > 0) {
+        const size_t room = SHA256_BLOCK_SIZE - ctx->buf_len;
+        const size_t take = len < room ? len : room;
+        memcpy(ctx->buf + ctx->buf_len, p, take);
+        ctx->buf_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buf_len < SHA256_BLOCK_SIZE) {
+            return;
+        }
+        ctx->blocks(ctx->reg, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+
+    const size_t n = len / SHA256_BLOCK_SIZE;
+    if (n > 0) {
+        ctx->blocks(ctx->reg, p, n);
+        p += n * SHA256_BLOCK_SIZE;
+        len -= n * SHA256_BLOCK_SIZE;
+    }
+    memcpy(ctx->buf, p, len);
+    ctx->buf_len = len;
+}
+
+static inline void sha512_update(struct sha512_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    ctx->length += len;
+
+    if (ctx->buf_len > 0) {
+        const size_t room = SHA512_BLOCK_SIZE - ctx->buf_len;
+        const size_t take = len < room ? len : room;
+        memcpy(ctx->buf + ctx->buf_len, p, take);
+        ctx->buf_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buf_len < SHA512_BLOCK_SIZE) {
+            return;
+        }
+        ctx->blocks(ctx->reg, ctx->buf, 1);
+        ctx->buf_len = 0;
     }
 
-    reg64_h0 += a;
-    reg64_h1 += b;
-    reg64_h2 += c;
-    reg64_h3 += d;
-    reg64_h4 += e;
-    reg64_h5 += f;
-    reg64_h6 += g;
-    reg64_h7 += h;
+    const size_t n = len / SHA512_BLOCK_SIZE;
+    if (n > 0) {
+        ctx->blocks(ctx->reg, p, n);
+        p += n * SHA512_BLOCK_SIZE;
+        len -= n * SHA512_BLOCK_SIZE;
+    }
+    memcpy(ctx->buf, p, len);
+    ctx->buf_len = len;
+}
+
+/* Pad the message, and write the digest_size byte digest to out. */
+static inline void sha256_final(struct sha256_ctx *ctx, uint8_t *out)
+{
+    const uint64_t bits = ctx->length * 8;
+
+    ctx->buf[ctx->buf_len++] = 0x80;
+    if (ctx->buf_len > 56) {
+        /* No room for the size; it goes in a chunk of its own. */
+        memset(ctx->buf + ctx->buf_len, 0, SHA256_BLOCK_SIZE - ctx->buf_len);
+        ctx->blocks(ctx->reg, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    memset(ctx->buf + ctx->buf_len, 0, 56 - ctx->buf_len);
+
+    /* The 64-bit message size in bits, big-endian. */
+    for (int i = 0; i < 8; i++) {
+        ctx->buf[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    ctx->blocks(ctx->reg, ctx->buf, 1);
+
+    for (size_t i = 0; i < ctx->digest_size; i++) {
+        out[i] = (uint8_t)(ctx->reg[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static inline void sha512_final(struct sha512_ctx *ctx, uint8_t *out)
+{
+    const uint64_t bits_hi = ctx->length >> 61;
+    const uint64_t bits_lo = ctx->length << 3;
+
+    ctx->buf[ctx->buf_len++] = 0x80;
+    if (ctx->buf_len > 112) {
+        memset(ctx->buf + ctx->buf_len, 0, SHA512_BLOCK_SIZE - ctx->buf_len);
+        ctx->blocks(ctx->reg, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    memset(ctx->buf + ctx->buf_len, 0, 112 - ctx->buf_len);
+
+    /* The 128-bit message size in bits, big-endian. */
+    for (int i = 0; i < 8; i++) {
+        ctx->buf[112 + i] = (uint8_t)(bits_hi >> (56 - 8 * i));
+        ctx->buf[120 + i] = (uint8_t)(bits_lo >> (56 - 8 * i));
+    }
+    ctx->blocks(ctx->reg, ctx->buf, 1);
+
+    for (size_t i = 0; i < ctx->digest_size; i++) {
+        out[i] = (uint8_t)(ctx->reg[i / 8] >> (56 - 8 * (i % 8)));
+    }
 }
 
 #endif
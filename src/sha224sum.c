@@ -23,51 +23,60 @@
 #include <stdint.h>
 #include <getopt.h>
 
-#include "sha2.h"
 #include "common.h"
-
-uint32_t *words;
-uint8_t  *in_buf;
+#include "digest.h"
 
 static const char *APP_NAME = "sha224sum";
 
-static struct {
-    bool check;
-    bool bsd_style;
-} opts = {
-    .check = false,
-    .bsd_style = false };
+#define OPT_FILES0_FROM 256
+#define OPT_QUIET       257
+#define OPT_STATUS      258
+#define OPT_PROGRESS    259
 
-/* The eight 32-bit unsigned registers. */
-uint32_t reg_h0 = 0xc1059ed8;
-uint32_t reg_h1 = 0x367cd507;
-uint32_t reg_h2 = 0x3070dd17;
-uint32_t reg_h3 = 0xf70e5939;
-uint32_t reg_h4 = 0xffc00b31;
-uint32_t reg_h5 = 0x68581511;
-uint32_t reg_h6 = 0x64f98fa7;
-uint32_t reg_h7 = 0xbefa4fa4;
+static struct digest_opts opts = {
+    .check = false,
+    .bsd_style = false,
+    .quiet = false,
+    .status = false,
+    .progress = false,
+    .jobs = 0 };
 
 static void show_help()
 {
-    printf("Usage: %s [OPTION]...\n\n\
+    printf("Usage: %s [OPTION]... [FILE]...\n\n\
 Options:\n\
+    -b, --bsd_style\t print BSD-style 'ALGO (FILE) = DIGEST' lines\n\
+    -c, --check\t\t read checksums from the FILEs and verify them\n\
+    -j, --jobs=N\t hash with N threads (default: one per CPU, at\n\
+    \t\t\t least 8, for more than one file)\n\
+        --files0-from=F read NUL-terminated file names from F\n\
     -h, --help\t\t display this help\n\
     -V, --version\t display version information\n\n\
+With --check:\n\
+        --quiet\t\t don't print OK for each verified file\n\
+        --status\t don't print anything, the exit status tells\n\
+        --progress\t show a count of the files checked on stderr\n\n\
 Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 }
 
 int main(const int argc, char *argv[]) {
     const struct option long_opts[] = {
-        { .name = "help",      .has_arg = no_argument, .flag = nullptr, .val = 'h' },
-        { .name = "version",   .has_arg = no_argument, .flag = nullptr, .val = 'V' },
-        { .name = "check",     .has_arg = no_argument, .flag = nullptr, .val = 'c' },
-        { .name = "bsd_style", .has_arg = no_argument, .flag = nullptr, .val = 'b' },
-        { .name = nullptr,     .has_arg = no_argument, .flag = nullptr, .val = 0 }
+        { .name = "help",        .has_arg = no_argument,       .flag = nullptr, .val = 'h' },
+        { .name = "version",     .has_arg = no_argument,       .flag = nullptr, .val = 'V' },
+        { .name = "check",       .has_arg = no_argument,       .flag = nullptr, .val = 'c' },
+        { .name = "bsd_style",   .has_arg = no_argument,       .flag = nullptr, .val = 'b' },
+        { .name = "jobs",        .has_arg = required_argument, .flag = nullptr, .val = 'j' },
+        { .name = "files0-from", .has_arg = required_argument, .flag = nullptr, .val = OPT_FILES0_FROM },
+        { .name = "quiet",       .has_arg = no_argument,       .flag = nullptr, .val = OPT_QUIET },
+        { .name = "status",      .has_arg = no_argument,       .flag = nullptr, .val = OPT_STATUS },
+        { .name = "progress",    .has_arg = no_argument,       .flag = nullptr, .val = OPT_PROGRESS },
+        STATS_LONG_OPT,
+        { .name = nullptr,       .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
+    const char *files0_from = nullptr;
     int opt;
-    while ((opt = getopt_long(argc, argv, "Vh", long_opts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "Vhcbj:", long_opts, nullptr)) != -1) {
         switch(opt) {
             case 'V':
                 printf("%s (%s) version %s\n", APP_NAME, APP_SUITE, APP_VERSION);
@@ -84,109 +93,32 @@ int main(const int argc, char *argv[]) {
             case 'b':
                 opts.bsd_style = true;
                 break;
+            case 'j': {
+                const int min = 1;
+                const int max = POOL_MAX_WORKERS;
+                opts.jobs = (unsigned)parse_numeric_arg(optarg, &min, &max, APP_NAME);
+                break;
+            }
+            case OPT_FILES0_FROM:
+                files0_from = optarg;
+                break;
+            case OPT_QUIET:
+                opts.quiet = true;
+                break;
+            case OPT_STATUS:
+                opts.status = true;
+                break;
+            case OPT_PROGRESS:
+                opts.progress = true;
+                break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
         }
     }
 
-    /* Allocate a read buffer and a word buffer. */
-    in_buf = malloc(sizeof(uint8_t)  * 64);
-    words  = malloc(sizeof(uint32_t) * 64);
-    if (!in_buf || !words) {
-        /* This is fatal no matter what. */
-        fprintf(stderr, "%s: failed to allocate memory!\n", APP_NAME);
-        return EXIT_FAILURE;
-    }
-
-    bool read_stdin = false;
-    
-    /* For stdin, we need to just read data until
-     * we get an EOF, then determine the size, add
-     * the padding etc etc. */
-    if (argc == optind || strcmp(argv[optind], "-") == 0) {
-        read_stdin = true;
-    }
-
-    /* Possibly multiple file arguments. Iterate
-     * over them and print the digest on a separate line. */
-    do {
-        /* We need the message size in bits as an uint64_t. */
-        uint64_t message_size = 0;
-
-        /* Open the file. */
-        FILE *fh;
-        if (read_stdin) {
-            fh = stdin;
-        } else {
-            fh = fopen(argv[optind], "r");
-            if (!fh) {
-                fprintf(stderr, "%s: unable to open %s: %s",
-                    APP_NAME, argv[optind], strerror(errno));
-            }
-        }
-
-        /* As long as we can read 64 byte chunks, process them. */
-        size_t bytes_read;
-        while ((bytes_read = fread(in_buf, 1, 64, fh)) == 64) {
-            process_chunk_32(in_buf);
-            message_size += bytes_read;
-        }
-
-        /* In bits.... */
-        message_size = (message_size + bytes_read) * 8;
-
-        /* No more full chunks. Pad and process the last chunk. */
-        if (bytes_read >= 56) {
-            /* Edge case where partial read is too large
-             * to fit the padding and requires 2 chunks. */
-            in_buf[bytes_read++] = 0x80;
-            memset(in_buf + bytes_read, 0, 64 - bytes_read);
-            process_chunk_32(in_buf);
-
-            memset(in_buf, 0, 56);
-        }
-        else {
-            in_buf[bytes_read++] = 0x80;
-            memset(in_buf + bytes_read, 0, 56 - bytes_read);
-        }
-
-        /* Encode the 64-bit file size, big-endian. */
-        in_buf[56] = (uint8_t)(message_size >> 56) & 0xFF;
-        in_buf[57] = (uint8_t)(message_size >> 48) & 0xFF;
-        in_buf[58] = (uint8_t)(message_size >> 40) & 0xFF;
-        in_buf[59] = (uint8_t)(message_size >> 32) & 0xFF;
-        in_buf[60] = (uint8_t)(message_size >> 24) & 0xFF;
-        in_buf[61] = (uint8_t)(message_size >> 16) & 0xFF;
-        in_buf[62] = (uint8_t)(message_size >> 8)  & 0xFF;
-        in_buf[63] = (uint8_t)message_size         & 0xFF;
-
-        /* Process the last chunk. */
-        process_chunk_32(in_buf);
-
-        /* Print the result. */
-        printf("%08x%08x%08x%08x%08x%08x%08x", reg_h0, reg_h1, reg_h2, reg_h3,
-                                               reg_h4, reg_h5, reg_h6);
-        printf("  %s\n", read_stdin ? "-" : argv[optind]);
-
-        if (read_stdin) goto exit;
-
-        optind++;
-
-        /* Reset the registers. */
-        reg_h0 = 0xc1059ed8;
-        reg_h1 = 0x367cd507;
-        reg_h2 = 0x3070dd17;
-        reg_h3 = 0xf70e5939;
-        reg_h4 = 0xffc00b31;
-        reg_h5 = 0x68581511;
-        reg_h6 = 0x64f98fa7;
-        reg_h7 = 0xbefa4fa4;
-
-    } while (optind < argc);
-
-exit:
-    free(in_buf);
-    free(words);
-    return EXIT_SUCCESS;
+    return digest_main(&digest_sha224, argv + optind, argc - optind, files0_from, &opts, APP_NAME);
 }
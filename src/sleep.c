@@ -70,6 +70,7 @@ int main(int argc, char *argv[]) {
     struct option longopts[] = {
         {"help", 0, NULL, 'h'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {0,0,0,0}
     };
 
@@ -84,13 +85,20 @@ int main(int argc, char *argv[]) {
             case 'h':
                 show_help();
                 exit(EXIT_SUCCESS);
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 exit(EXIT_FAILURE);
         }
     }
     long int sleep_length;
-    sleep_length = make_seconds(argv[1]);
+    if (argc == optind) {
+        show_help();
+        exit(EXIT_FAILURE);
+    }
+    sleep_length = make_seconds(argv[optind]);
     sleep(sleep_length);
     return EXIT_SUCCESS;
 }
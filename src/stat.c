@@ -27,6 +27,7 @@
 #endif
 
 #include "common.h"
+#include "idcache.h"
 
 
 static const char *APP_NAME = "stat";
@@ -105,7 +106,8 @@ static void stat_file(char *filename, const int follow_links)
     printf("Inode: %ld\t", (long) buf.st_ino);
     printf("Links: %ld\n", (long) buf.st_nlink);
 
-    printf(" Perms: %#o/%s\t", file_perm_oct(buf.st_mode), file_perm_str(buf.st_mode, 1));
+    char perms[PERM_STR_SIZE];
+    printf(" Perms: %#o/%s\t", file_perm_oct(buf.st_mode), file_perm_str(buf.st_mode, 1, perms));
     printf("Uid: %ld/%s\t", (long) buf.st_uid, get_username(buf.st_uid));
     printf("Gid: %ld/%s\n", (long) buf.st_gid, get_groupname(buf.st_gid));
 
@@ -125,6 +127,7 @@ int main(const int argc, char *argv[])
         {.name = "help",        .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version",     .has_arg = 0, .flag = nullptr, .val = 'V'},
         {.name = "dereference", .has_arg = 0, .flag = nullptr, .val = 'd'},
+        STATS_LONG_OPT,
         {.name = nullptr,       .has_arg = 0, .flag = nullptr, .val = 0}
     };
 
@@ -143,6 +146,9 @@ int main(const int argc, char *argv[])
             case 'd':
                 follow_links = true;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
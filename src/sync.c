@@ -43,6 +43,7 @@ int main(int argc, char *argv[]) {
     struct option longopts[] = {
         {"help", 0, NULL, 'h'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {0,0,0,0}
     };
 
@@ -63,6 +64,9 @@ int main(int argc, char *argv[]) {
                  /* getopt_long prints own error message */
                 exit(EXIT_FAILURE);
                 break;
+            case STATS_OPT:
+                 stats_enable(APP_NAME);
+                 break;
             case '?':
                  /* getopt_long prints own error message */
                 exit(EXIT_FAILURE);
@@ -25,8 +25,7 @@
 #include <sys/fcntl.h>
 
 #include "common.h"
-
-#define MAX_LINE_LENGTH 2048
+#include "io.h"
 
 
 static const char *APP_NAME = "tail";
@@ -56,86 +55,119 @@ Options:\n\
 Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 }
 
+static struct io_writer out;
+
+/* Copy the reader's input from offset 'start' to the end. */
+static void copy_from(struct io_reader *in, const off_t start)
+{
+    const uint8_t *buf;
+    size_t len;
+
+    if (lseek(in->fd, start, SEEK_SET) < 0) {
+        return;
+    }
+    while ((len = io_read(in, &buf)) > 0) {
+        io_write(&out, buf, len);
+    }
+}
+
 static int tail_bytes(char *filename, const uint32_t n_bytes)
 {
     if (opts.verbose) {
-        printf("==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
+        io_printf(&out, "==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
     }
 
-    FILE *fd = fopen(filename, "r");
-    if (!fd) {
+    struct io_reader in;
+    if (!io_open(&in, filename, APP_NAME)) {
         fprintf(stderr, "%s: unable to open '%s': %s\n",
             APP_NAME, filename, strerror(errno));
         return EXIT_FAILURE;
     }
 
     /* Get file size in case it is less than bytes requested. */
-    fseek(fd, 0, SEEK_END);
-    const long int fs_bytes = ftell(fd);
-
-    if (fs_bytes < n_bytes) {
-        /* If it is less, just rewind the FP. */
-        rewind(fd);
-    } else {
-        /* Otherwise, position read head to n_bytes from the end. */
-        if (fseek(fd, fs_bytes - n_bytes, SEEK_SET) != 0) {
-            fprintf(stderr, "%s: unable to seek to end of '%s': %s\n",
-                APP_NAME, filename, strerror(errno));
-            return EXIT_FAILURE;
-        }
+    const off_t fs_bytes = lseek(in.fd, 0, SEEK_END);
+    if (fs_bytes < 0) {
+        fprintf(stderr, "%s: unable to seek to end of '%s': %s\n",
+            APP_NAME, filename, strerror(errno));
+        io_close(&in);
+        return EXIT_FAILURE;
     }
 
-    int ch;
-    while ((ch = fgetc(fd))) {
-        if (ch == EOF) {
-        break;
-        }
-        printf("%c", ch);
-    }
+    /* If it is less, start at the beginning, otherwise
+     * position read head to n_bytes from the end. */
+    copy_from(&in, fs_bytes < n_bytes ? 0 : fs_bytes - n_bytes);
 
-    fclose(fd);
+    io_close(&in);
     return EXIT_SUCCESS;
 }
 
 static int tail_lines(char *filename, const int32_t n_lines)
 {
     if (opts.verbose) {
-        printf("==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
+        io_printf(&out, "==> %s%s%s <==\n", ANSI_BLUE_B, filename, ANSI_RESET);
     }
 
-    FILE *fd = fopen(filename, "r");
-    if (fd == NULL) {
+    struct io_reader in;
+    if (!io_open(&in, filename, APP_NAME)) {
         fprintf(stderr, "Unable to open '%s': %s\n", filename, strerror(errno));
         return EXIT_FAILURE;
     }
 
-    int lines = 0;
-    int ch;
-    while ((ch = getc(fd)) != EOF) {
-        if (ch == '\n') {
-            lines++;
-        }
+    const off_t fs_bytes = lseek(in.fd, 0, SEEK_END);
+    if (fs_bytes < 0) {
+        fprintf(stderr, "%s: unable to seek to end of '%s': %s\n",
+            APP_NAME, filename, strerror(errno));
+        io_close(&in);
+        return EXIT_FAILURE;
     }
-    rewind(fd);
-    char buffer[MAX_LINE_LENGTH];
 
-    /* If total lines is less than requested lines - print entire file. */
-    if (lines <= n_lines) {
-        while (fgets(buffer, sizeof(buffer), fd) != NULL) {
-            printf("%s", buffer);
+    /* Scan backwards from the end a block at a time, counting
+     * newlines. A newline ending the file does not start a new
+     * line, so it is not counted. The output starts just after
+     * the newline preceding the first of the last n_lines lines. */
+    off_t start = 0;
+    off_t pos = fs_bytes;
+    int32_t lines = 0;
+    bool found = false;
+    bool last_byte = true;
+
+    while (pos > 0 && !found) {
+        const size_t len = pos < (off_t)in.cap ? (size_t)pos : in.cap;
+        pos -= len;
+
+        ssize_t n;
+        do {
+            n = pread(in.fd, in.buf, len, pos);
+            io_counters.reads++;
+        } while (n < 0 && errno == EINTR);
+        if (n != (ssize_t)len) {
+            fprintf(stderr, "%s: error reading '%s': %s\n",
+                APP_NAME, filename, n < 0 ? strerror(errno) : "short read");
+            io_close(&in);
+            return EXIT_FAILURE;
         }
-    } else {
-      const long int first_line = lines - n_lines;
-        int current_line = 0;
-        while (fgets(buffer, sizeof(buffer), fd) != NULL) {
-            current_line++;
-            if (current_line > first_line) {
-                printf("%s", buffer);
+        io_counters.bytes_read += n;
+
+        for (size_t i = len; i-- > 0;) {
+            if (in.buf[i] != '\n') {
+                last_byte = false;
+                continue;
+            }
+            if (last_byte) {
+                last_byte = false;
+                continue;
+            }
+            if (++lines == n_lines) {
+                start = pos + i + 1;
+                found = true;
+                break;
             }
         }
     }
 
-    fclose(fd);
+    copy_from(&in, start);
+
+    io_close(&in);
     return EXIT_SUCCESS;
 }
 
@@ -147,6 +179,7 @@ int main(const int argc, char *argv[]) {
         { .name = "bytes",   .has_arg = required_argument, .flag = nullptr, .val = 'b' },
         { .name = "quiet",   .has_arg = no_argument,       .flag = nullptr, .val = 'q' },
         { .name = "verbose", .has_arg = no_argument,       .flag = nullptr, .val = 'v' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument,       .flag = nullptr, .val = 0 }
     };
 
@@ -186,6 +219,9 @@ int main(const int argc, char *argv[]) {
         opts.bytes = true;
         n_units = (uint32_t)parse_numeric_arg(optarg, min, max, "tail");
         break;
+      case STATS_OPT:
+        stats_enable(APP_NAME);
+        break;
       default:
         show_help();
         return EXIT_FAILURE;
@@ -206,6 +242,8 @@ int main(const int argc, char *argv[]) {
         }
     }
 
+    io_writer_fd(&out, STDOUT_FILENO, false, APP_NAME);
+
     for (; optind < argc; optind++) {
         if (opts.bytes) {
             tail_bytes(argv[optind], n_units);
@@ -213,5 +251,6 @@ int main(const int argc, char *argv[]) {
             tail_lines(argv[optind], n_units);
         }
     }
+    io_writer_close(&out);
     return EXIT_SUCCESS;
 }
@@ -45,6 +45,7 @@ int main(const int argc, char *argv[])
         { .name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h' },
         { .name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V' },
         { .name = "append",  .has_arg = no_argument, .flag = nullptr, .val = 'a' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
 
@@ -66,6 +67,9 @@ int main(const int argc, char *argv[])
         case 'a':
             append = true;
             break;
+        case STATS_OPT:
+            stats_enable(APP_NAME);
+            break;
         default:
             show_help();
             return EXIT_FAILURE;
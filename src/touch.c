@@ -128,6 +128,7 @@ int main(const int argc, char *argv[])
         { .name = "no-dereference", .has_arg = no_argument,       .flag = nullptr, .val = 'n' },
         { .name = "date",           .has_arg = required_argument, .flag = nullptr, .val = 'd' },
         { .name = "reference",      .has_arg = required_argument, .flag = nullptr, .val = 'r' },
+        STATS_LONG_OPT,
         { .name = nullptr,          .has_arg = no_argument,       .flag = nullptr, .val = 0}
     };
     
@@ -166,6 +167,9 @@ int main(const int argc, char *argv[])
                 opts.reference = true;
                 snprintf(ref_file, sizeof(ref_file), "%s", optarg);
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -43,6 +43,7 @@ int main(int argc, char *argv[]) {
     struct option longopts[] = {
         {"help", 0, NULL, 'h'},
         {"version", 0, NULL, 'V'},
+        STATS_LONG_OPT,
         {0,0,0,0}
     };
 
@@ -59,6 +60,9 @@ int main(int argc, char *argv[]) {
                 show_help();
                 exit(EXIT_SUCCESS);
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 exit(EXIT_FAILURE);
@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   ull.c - multicall binary that dispatches to the individual tools      *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * This file is not built by the default target. `make ull` compiles every
+ * tool with its main() renamed to ull_<tool>_main(), hides all other global
+ * symbols in each object, and links them together with this dispatcher.
+ * The applet list is generated by the Makefile into ull_applets.h as a
+ * series of APPLET(name) lines, sorted by name.
+ */
+
+#include "common.h"
+#include "ull_applets.h"
+
+
+static const char *APP_NAME = "ull";
+
+typedef int (*applet_main)(int, char *[]);
+
+struct applet {
+    const char *name;
+    applet_main main;
+};
+
+/* Declare each applet's renamed main(). */
+#define APPLET(tool) int ull_##tool##_main(int, char *[]);
+ULL_APPLETS
+#undef APPLET
+
+/* ...and build the lookup table. */
+#define APPLET(tool) { .name = #tool, .main = ull_##tool##_main },
+static const struct applet applets[] = {
+    ULL_APPLETS
+};
+#undef APPLET
+
+static constexpr size_t n_applets = sizeof(applets) / sizeof(applets[0]);
+
+static void show_help()
+{
+    printf("Usage: %s APPLET [ARGUMENT]...\n\
+       APPLET [ARGUMENT]...\t(when invoked through a link named APPLET)\n\n\
+Options:\n\
+    -l, --list\t\t list the available applets\n\
+    -h, --help\t\t display this help\n\
+    -V, --version\t display version information\n\n\
+Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
+}
+
+static int compare_applet(const void *key, const void *elem)
+{
+    return strcmp(key, ((const struct applet *)elem)->name);
+}
+
+static const struct applet* find_applet(const char *name)
+{
+    return bsearch(name, applets, n_applets, sizeof(struct applet), compare_applet);
+}
+
+/* Run the applet named by argv[0], which is
+ * either a link name or a path to a link. */
+static int run_applet(const int argc, char *argv[])
+{
+    const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+    const struct applet *app = find_applet(name);
+
+    if (!app) {
+        fprintf(stderr, "%s: %s: applet not found\n", APP_NAME, name);
+        return EXIT_FAILURE;
+    }
+
+    /* Tools print their own name in messages, so
+     * hand them a bare name rather than a path. */
+    argv[0] = (char *)app->name;
+    return app->main(argc, argv);
+}
+
+int main(const int argc, char *argv[])
+{
+    const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+
+    /* Invoked through a link: dispatch on our own name. */
+    if (strcmp(name, APP_NAME) != 0) {
+        return run_applet(argc, argv);
+    }
+
+    /* Invoked as `ull`. Options are only checked in argv[1],
+     * everything after the applet name belongs to the applet. */
+    if (argc < 2) {
+        show_help();
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "-l") == 0 || strcmp(argv[1], "--list") == 0) {
+        for (size_t i = 0; i < n_applets; i++) {
+            printf("%s\n", applets[i].name);
+        }
+        return EXIT_SUCCESS;
+    }
+    if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        show_help();
+        return EXIT_SUCCESS;
+    }
+    if (strcmp(argv[1], "-V") == 0 || strcmp(argv[1], "--version") == 0) {
+        printf("%s (%s) version %s\n", APP_NAME, APP_SUITE, APP_VERSION);
+        printf("%s compiled on %s at %s\n",
+               strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__,
+               __DATE__, __TIME__);
+        return EXIT_SUCCESS;
+    }
+
+    return run_applet(argc - 1, argv + 1);
+}
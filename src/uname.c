@@ -83,6 +83,7 @@ int main(const int argc, char *argv[])
         {.name = "operating-system",  .has_arg = 0, .flag = nullptr, .val = 'o'},
         {.name = "help",              .has_arg = 0, .flag = nullptr, .val = 'h'},
         {.name = "version",           .has_arg = 0, .flag = nullptr, .val = 'V'},
+        STATS_LONG_OPT,
         {.name = nullptr,             .has_arg = 0, .flag = nullptr, .val = 0}
     };
     
@@ -139,6 +140,9 @@ int main(const int argc, char *argv[])
                 opts.s = false;
                 opts.o = true;     /* operating system */
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
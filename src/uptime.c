@@ -160,6 +160,7 @@ int main(const int argc, char *argv[])
     const struct option long_opts[] = {
         { .name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h' },
         { .name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
 
@@ -175,6 +176,9 @@ int main(const int argc, char *argv[])
             case 'h':
                 showHelp();
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 showHelp();
                 exit(EXIT_FAILURE);
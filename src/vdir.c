@@ -180,7 +180,7 @@ int main(const int argc, char *argv[])
             }
 
             if (n_args > 1) {
-                printf("\n%s:\n", path_to_ls);
+                io_printf(io_stdout(APP_NAME), "\n%s:\n", path_to_ls);
             }
 
             if (opts.ls_long) {
@@ -0,0 +1,615 @@
+/***************************************************************************
+ *   walk.h - parallel directory tree walker                               *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef WALK_H
+#define WALK_H
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "common.h"
+
+/*
+ * A tree walker for the recursive tools. Directories are opened relative
+ * to their parent with openat(), and read in large batches (getdents64
+ * on Linux). d_type saves a stat per entry when the caller does not need
+ * one. Subdirectories are queued on the current worker's deque; idle
+ * workers steal the oldest, and so largest, pending directory from the
+ * others, so deep and wide trees both keep every thread busy.
+ *
+ * The visit callback sees every entry once: directories as WALK_PRE
+ * before their contents and WALK_POST after all of them, including
+ * those handled by other threads, and everything else as WALK_FILE.
+ * With more than one thread it is called concurrently, so it must be
+ * thread safe, and the order of visits between subtrees is not fixed.
+ */
+
+/* Flags for walk_opts. */
+#define WALK_FOLLOW (1u << 0)  /* Follow symbolic links, as fts FTS_LOGICAL. */
+#define WALK_STAT   (1u << 1)  /* Provide a struct stat for every entry. */
+
+enum walk_visit {
+    WALK_PRE,
+    WALK_POST,
+    WALK_FILE,
+    WALK_ERR    /* A directory could not be read; error is set. */
+};
+
+/* Callback return values. */
+#define WALK_CONTINUE 0
+#define WALK_SKIP     1  /* From WALK_PRE: do not descend. */
+
+struct walk_entry {
+    const char *path;       /* Path from the root operand. */
+    int dirfd;              /* Parent directory, or AT_FDCWD. */
+    const char *name;       /* Path relative to dirfd. */
+    int fd;                 /* The directory itself in WALK_PRE, else -1. */
+    unsigned char type;     /* DT_DIR, DT_LNK, DT_REG... */
+    const struct stat *st;  /* Only with WALK_STAT. */
+    size_t depth;           /* 0 for the root. */
+    int error;              /* errno for WALK_ERR. */
+};
+
+typedef int (*walk_fn)(const struct walk_entry *e, enum walk_visit visit, void *arg);
+
+struct walk_opts {
+    unsigned flags;
+    unsigned threads;       /* 0 picks walk_default_threads(). */
+    walk_fn visit;
+    void *arg;
+    const char *app_name;
+};
+
+/* Batch size for reading directories. */
+#define WALK_DENTS_SIZE (256 * 1024)
+#define WALK_MAX_THREADS 64
+
+/* A directory that is queued, being read, or waiting for its subtree. */
+struct walk_node {
+    struct walk_node *parent;
+    char *path;
+    size_t name_off;        /* The name within path. */
+    size_t depth;
+    int fd;
+    dev_t dev;
+    ino_t ino;
+    atomic_size_t refs;     /* This node's own scan, plus unfinished subdirectories. */
+    atomic_size_t holds;    /* Users of fd: the scan, plus children yet to open. */
+    bool share_fd;          /* Children open relative to fd. */
+};
+
+struct walk_deque {
+    pthread_mutex_t lock;
+    struct walk_node **items;
+    size_t head;
+    size_t tail;
+    size_t cap;
+};
+
+struct walk_state {
+    const struct walk_opts *opts;
+    unsigned n_workers;
+    struct walk_deque *deques;
+    atomic_size_t pending;  /* Queued or running directories. */
+    atomic_size_t wake_gen;
+    atomic_uint sleepers;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    atomic_size_t open_fds;
+    size_t fd_budget;
+    atomic_size_t errors;
+};
+
+struct walk_worker {
+    struct walk_state *ws;
+    unsigned id;
+    uint8_t *dents;
+    char *path_buf;
+    size_t path_cap;
+    pthread_t thread;
+};
+
+static inline unsigned walk_default_threads(void)
+{
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) {
+        return 1;
+    }
+    /* Past this, the walk is bound by the device rather than by latency. */
+    return n > 16 ? 16 : (unsigned)n;
+}
+
+static inline void *walk_xalloc(void *p, const char *app_name)
+{
+    if (p == nullptr) {
+        fprintf(stderr, "%s: unable to allocate memory!\n", app_name);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static inline void walk_push(struct walk_state *ws, const unsigned id, struct walk_node *n)
+{
+    struct walk_deque *d = &ws->deques[id];
+
+    atomic_fetch_add(&ws->pending, 1);
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->cap) {
+        if (d->head > 0) {
+            memmove(d->items, d->items + d->head, (d->tail - d->head) * sizeof(*d->items));
+            d->tail -= d->head;
+            d->head = 0;
+        } else {
+            d->cap = d->cap ? d->cap * 2 : 256;
+            d->items = walk_xalloc(realloc(d->items, d->cap * sizeof(*d->items)), ws->opts->app_name);
+        }
+    }
+    d->items[d->tail++] = n;
+    pthread_mutex_unlock(&d->lock);
+
+    atomic_fetch_add(&ws->wake_gen, 1);
+    if (atomic_load(&ws->sleepers) > 0) {
+        pthread_mutex_lock(&ws->idle_lock);
+        pthread_cond_signal(&ws->idle_cond);
+        pthread_mutex_unlock(&ws->idle_lock);
+    }
+}
+
+/* The owner takes its newest directory, which keeps it depth first. */
+static inline struct walk_node *walk_pop(struct walk_deque *d)
+{
+    struct walk_node *n = nullptr;
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head) {
+        n = d->items[--d->tail];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return n;
+}
+
+/* Thieves take the oldest, nearest the root of the owner's subtree. */
+static inline struct walk_node *walk_steal(struct walk_deque *d)
+{
+    struct walk_node *n = nullptr;
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head) {
+        n = d->items[d->head++];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return n;
+}
+
+static inline void walk_close_fd(struct walk_state *ws, struct walk_node *n)
+{
+    close(n->fd);
+    n->fd = -1;
+    atomic_fetch_sub(&ws->open_fds, 1);
+}
+
+/* Drop one hold on the node's fd, closing it with the last. */
+static inline void walk_unhold(struct walk_state *ws, struct walk_node *n)
+{
+    if (atomic_fetch_sub(&n->holds, 1) == 1 && n->fd >= 0) {
+        walk_close_fd(ws, n);
+    }
+}
+
+/* Drop a reference. The last one completes the directory: it gets
+ * its post-order visit, and in turn releases its parent. */
+static inline void walk_release(struct walk_state *ws, struct walk_node *n)
+{
+    while (n != nullptr && atomic_fetch_sub(&n->refs, 1) == 1) {
+        const struct walk_entry e = {
+            .path = n->path, .dirfd = AT_FDCWD, .name = n->path, .fd = -1,
+            .type = DT_DIR, .st = nullptr, .depth = n->depth, .error = 0
+        };
+        ws->opts->visit(&e, WALK_POST, ws->opts->arg);
+
+        struct walk_node *parent = n->parent;
+        free(n->path);
+        free(n);
+        n = parent;
+    }
+}
+
+static inline void walk_error(struct walk_state *ws, const struct walk_node *n, const int error)
+{
+    const struct walk_entry e = {
+        .path = n->path, .dirfd = AT_FDCWD, .name = n->path, .fd = -1,
+        .type = DT_DIR, .st = nullptr, .depth = n->depth, .error = error
+    };
+    atomic_fetch_add(&ws->errors, 1);
+    ws->opts->visit(&e, WALK_ERR, ws->opts->arg);
+}
+
+static inline struct walk_node *walk_node_new(struct walk_state *ws, struct walk_node *parent,
+                                              const char *path, const size_t path_len,
+                                              const size_t name_off)
+{
+    struct walk_node *n = walk_xalloc(malloc(sizeof(*n)), ws->opts->app_name);
+    n->parent = parent;
+    n->path = walk_xalloc(malloc(path_len + 1), ws->opts->app_name);
+    memcpy(n->path, path, path_len + 1);
+    n->name_off = name_off;
+    n->depth = parent ? parent->depth + 1 : 0;
+    n->fd = -1;
+    n->dev = 0;
+    n->ino = 0;
+    atomic_init(&n->refs, 1);
+    atomic_init(&n->holds, 1);
+    n->share_fd = false;
+    return n;
+}
+
+/* Put parent-path "/" name in the worker's scratch buffer. */
+static inline size_t walk_join(struct walk_worker *w, const struct walk_node *parent, const char *name)
+{
+    const size_t plen = strlen(parent->path);
+    const size_t nlen = strlen(name);
+    const bool slash = plen > 0 && parent->path[plen - 1] != '/';
+    const size_t len = plen + slash + nlen;
+
+    if (len + 1 > w->path_cap) {
+        w->path_cap = (len + 1) * 2;
+        w->path_buf = walk_xalloc(realloc(w->path_buf, w->path_cap), w->ws->opts->app_name);
+    }
+    memcpy(w->path_buf, parent->path, plen);
+    if (slash) {
+        w->path_buf[plen] = '/';
+    }
+    memcpy(w->path_buf + plen + slash, name, nlen + 1);
+    return len;
+}
+
+/* Read a batch of entries. Returns bytes filled, 0 at the end, -1 on error. */
+static inline ssize_t walk_read_dents(const int fd, DIR *dp, uint8_t *buf)
+{
+#if defined(__linux__)
+    (void)dp;
+    return syscall(SYS_getdents64, fd, buf, WALK_DENTS_SIZE);
+#else
+    /* Elsewhere, repack readdir() results into the same layout. */
+    (void)fd;
+    size_t len = 0;
+    struct dirent *de;
+    errno = 0;
+    while ((de = readdir(dp)) != nullptr) {
+        const size_t nlen = strlen(de->d_name);
+        const size_t reclen = (sizeof(uint16_t) + 1 + nlen + 1 + 7) & ~(size_t)7;
+        memcpy(buf + len, &(uint16_t){ (uint16_t)reclen }, sizeof(uint16_t));
+        buf[len + 2] = de->d_type;
+        memcpy(buf + len + 3, de->d_name, nlen + 1);
+        len += reclen;
+        if (len + 3 + 1024 + 8 > WALK_DENTS_SIZE) {
+            break;
+        }
+    }
+    return (errno != 0 && len == 0) ? -1 : (ssize_t)len;
+#endif
+}
+
+/* Unpack one record from a walk_read_dents() batch. */
+static inline size_t walk_next_dent(const uint8_t *rec, unsigned char *type, const char **name)
+{
+#if defined(__linux__)
+    /* struct linux_dirent64: ino (8), off (8), reclen (2), type (1), name. */
+    uint16_t reclen;
+    memcpy(&reclen, rec + 16, sizeof(reclen));
+    *type = rec[18];
+    *name = (const char *)rec + 19;
+    return reclen;
+#else
+    uint16_t reclen;
+    memcpy(&reclen, rec, sizeof(reclen));
+    *type = rec[2];
+    *name = (const char *)rec + 3;
+    return reclen;
+#endif
+}
+
+static inline bool walk_is_loop(const struct walk_node *n)
+{
+    for (const struct walk_node *a = n->parent; a != nullptr; a = a->parent) {
+        if (a->dev == n->dev && a->ino == n->ino) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Open, visit and read one directory, queueing its subdirectories. */
+static inline void walk_dir(struct walk_worker *w, struct walk_node *n)
+{
+    struct walk_state *ws = w->ws;
+    const struct walk_opts *o = ws->opts;
+    const bool follow = o->flags & WALK_FOLLOW;
+    struct walk_node *parent = n->parent;
+
+    int at = AT_FDCWD;
+    const char *rel = n->path;
+    if (parent != nullptr && parent->share_fd) {
+        at = parent->fd;
+        rel = n->path + n->name_off;
+    }
+    n->fd = openat(at, rel, O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow ? 0 : O_NOFOLLOW));
+    const int open_errno = errno;
+    if (parent != nullptr && parent->share_fd) {
+        walk_unhold(ws, parent);
+    }
+
+    if (n->fd < 0) {
+        walk_error(ws, n, open_errno);
+        walk_release(ws, n);
+        return;
+    }
+    atomic_fetch_add(&ws->open_fds, 1);
+
+    struct stat st;
+    bool have_stat = false;
+    if ((follow || (o->flags & WALK_STAT)) && fstat(n->fd, &st) == 0) {
+        have_stat = true;
+        n->dev = st.st_dev;
+        n->ino = st.st_ino;
+        if (follow && walk_is_loop(n)) {
+            walk_error(ws, n, ELOOP);
+            walk_close_fd(ws, n);
+            walk_release(ws, n);
+            return;
+        }
+    }
+
+    /* The parent's fd may be closed by now, so name the directory by path. */
+    const struct walk_entry pre = {
+        .path = n->path,
+        .dirfd = AT_FDCWD,
+        .name = n->path,
+        .fd = n->fd,
+        .type = DT_DIR,
+        .st = (have_stat && (o->flags & WALK_STAT)) ? &st : nullptr,
+        .depth = n->depth,
+        .error = 0
+    };
+    if (o->visit(&pre, WALK_PRE, o->arg) == WALK_SKIP) {
+        walk_close_fd(ws, n);
+        walk_release(ws, n);
+        return;
+    }
+
+    /* Children open relative to this directory unless
+     * too many descriptors are held open already. */
+    n->share_fd = atomic_load(&ws->open_fds) < ws->fd_budget;
+
+    DIR *dp = nullptr;
+#if !defined(__linux__)
+    const int dup_fd = dup(n->fd);
+    dp = dup_fd >= 0 ? fdopendir(dup_fd) : nullptr;
+    if (dp == nullptr) {
+        if (dup_fd >= 0) {
+            close(dup_fd);
+        }
+        walk_error(ws, n, errno);
+        n->share_fd = false;
+        walk_close_fd(ws, n);
+        walk_release(ws, n);
+        return;
+    }
+#endif
+
+    ssize_t got;
+    while ((got = walk_read_dents(n->fd, dp, w->dents)) > 0) {
+        for (ssize_t off = 0; off < got; ) {
+            unsigned char type;
+            const char *name;
+            off += walk_next_dent(w->dents + off, &type, &name);
+
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            struct stat est;
+            have_stat = false;
+            if ((o->flags & WALK_STAT) || type == DT_UNKNOWN || (follow && type == DT_LNK)) {
+                if (fstatat(n->fd, name, &est, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0 ||
+                    (follow && fstatat(n->fd, name, &est, AT_SYMLINK_NOFOLLOW) == 0)) {
+                    /* A dangling link under WALK_FOLLOW is reported as the link. */
+                    have_stat = true;
+                    type = IFTODT(est.st_mode);
+                }
+            }
+
+            const size_t len = walk_join(w, n, name);
+            if (type == DT_DIR) {
+                struct walk_node *child = walk_node_new(ws, n, w->path_buf, len, len - strlen(name));
+                atomic_fetch_add(&n->refs, 1);
+                if (n->share_fd) {
+                    atomic_fetch_add(&n->holds, 1);
+                }
+                walk_push(ws, w->id, child);
+                continue;
+            }
+
+            const struct walk_entry e = {
+                .path = w->path_buf,
+                .dirfd = n->fd,
+                .name = name,
+                .fd = -1,
+                .type = type,
+                .st = have_stat ? &est : nullptr,
+                .depth = n->depth + 1,
+                .error = 0
+            };
+            o->visit(&e, WALK_FILE, o->arg);
+        }
+    }
+    if (got < 0) {
+        walk_error(ws, n, errno);
+    }
+
+#if !defined(__linux__)
+    closedir(dp);
+#endif
+
+    /* Children still to be opened keep the fd alive. */
+    if (n->share_fd) {
+        walk_unhold(ws, n);
+    } else {
+        walk_close_fd(ws, n);
+    }
+    walk_release(ws, n);
+}
+
+static inline struct walk_node *walk_find_work(struct walk_worker *w)
+{
+    struct walk_state *ws = w->ws;
+
+    struct walk_node *n = walk_pop(&ws->deques[w->id]);
+    for (unsigned i = 1; n == nullptr && i < ws->n_workers; i++) {
+        n = walk_steal(&ws->deques[(w->id + i) % ws->n_workers]);
+    }
+    return n;
+}
+
+static inline void *walk_worker_main(void *arg)
+{
+    struct walk_worker *w = arg;
+    struct walk_state *ws = w->ws;
+
+    while (true) {
+        const size_t gen = atomic_load(&ws->wake_gen);
+        struct walk_node *n = walk_find_work(w);
+        if (n != nullptr) {
+            walk_dir(w, n);
+            if (atomic_fetch_sub(&ws->pending, 1) == 1) {
+                /* That was the last directory: wake everyone to exit. */
+                pthread_mutex_lock(&ws->idle_lock);
+                pthread_cond_broadcast(&ws->idle_cond);
+                pthread_mutex_unlock(&ws->idle_lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&ws->idle_lock);
+        if (atomic_load(&ws->pending) == 0) {
+            pthread_mutex_unlock(&ws->idle_lock);
+            break;
+        }
+        atomic_fetch_add(&ws->sleepers, 1);
+        if (atomic_load(&ws->wake_gen) == gen && atomic_load(&ws->pending) > 0) {
+            pthread_cond_wait(&ws->idle_cond, &ws->idle_lock);
+        }
+        atomic_fetch_sub(&ws->sleepers, 1);
+        pthread_mutex_unlock(&ws->idle_lock);
+    }
+    return nullptr;
+}
+
+/* Walk the tree at root. Returns the number of directories that
+ * could not be read, each of which was also passed to WALK_ERR. */
+static inline size_t walk(const char *root, const struct walk_opts *o)
+{
+    const bool follow = o->flags & WALK_FOLLOW;
+    struct stat st;
+
+    if ((follow ? stat(root, &st) : lstat(root, &st)) == -1) {
+        const struct walk_entry e = {
+            .path = root, .dirfd = AT_FDCWD, .name = root, .fd = -1,
+            .type = DT_UNKNOWN, .st = nullptr, .depth = 0, .error = errno
+        };
+        o->visit(&e, WALK_ERR, o->arg);
+        return 1;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        const struct walk_entry e = {
+            .path = root, .dirfd = AT_FDCWD, .name = root, .fd = -1,
+            .type = IFTODT(st.st_mode), .st = &st, .depth = 0, .error = 0
+        };
+        o->visit(&e, WALK_FILE, o->arg);
+        return 0;
+    }
+
+    struct walk_state ws = {
+        .opts = o,
+        .n_workers = o->threads ? o->threads : walk_default_threads(),
+    };
+    if (ws.n_workers > WALK_MAX_THREADS) {
+        ws.n_workers = WALK_MAX_THREADS;
+    }
+    atomic_init(&ws.pending, 0);
+    atomic_init(&ws.wake_gen, 0);
+    atomic_init(&ws.sleepers, 0);
+    atomic_init(&ws.open_fds, 0);
+    atomic_init(&ws.errors, 0);
+    pthread_mutex_init(&ws.idle_lock, nullptr);
+    pthread_cond_init(&ws.idle_cond, nullptr);
+
+    /* Leave half the descriptor limit to the caller. */
+    struct rlimit rl;
+    ws.fd_budget = 512;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        ws.fd_budget = rl.rlim_cur / 2;
+    }
+
+    ws.deques = walk_xalloc(calloc(ws.n_workers, sizeof(*ws.deques)), o->app_name);
+    struct walk_worker *workers = walk_xalloc(calloc(ws.n_workers, sizeof(*workers)), o->app_name);
+    for (unsigned i = 0; i < ws.n_workers; i++) {
+        pthread_mutex_init(&ws.deques[i].lock, nullptr);
+        workers[i].ws = &ws;
+        workers[i].id = i;
+        workers[i].dents = walk_xalloc(malloc(WALK_DENTS_SIZE), o->app_name);
+    }
+
+    walk_push(&ws, 0, walk_node_new(&ws, nullptr, root, strlen(root), 0));
+
+    /* The calling thread is worker 0. A deque left without a thread
+     * if pthread_create() fails is never pushed to, so is harmless. */
+    unsigned started = 1;
+    while (started < ws.n_workers &&
+           pthread_create(&workers[started].thread, nullptr, walk_worker_main, &workers[started]) == 0) {
+        started++;
+    }
+    walk_worker_main(&workers[0]);
+    for (unsigned i = 1; i < started; i++) {
+        pthread_join(workers[i].thread, nullptr);
+    }
+
+    for (unsigned i = 0; i < ws.n_workers; i++) {
+        free(workers[i].dents);
+        free(workers[i].path_buf);
+        free(ws.deques[i].items);
+        pthread_mutex_destroy(&ws.deques[i].lock);
+    }
+    free(workers);
+    free(ws.deques);
+    pthread_cond_destroy(&ws.idle_cond);
+    pthread_mutex_destroy(&ws.idle_lock);
+
+    return atomic_load(&ws.errors);
+}
+
+#endif /* WALK_H */
@@ -20,22 +20,25 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
 #include <getopt.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <pthread.h>
+#include <sys/mman.h>
 
 #include "common.h"
+#include "io.h"
+#include "names.h"
+#include "pool.h"
+#include "wc.h"
 
 
 static const char *APP_NAME = "wc";
 
-/* Our count struct is used both for storing boolean
-   values regarding _if_ we want to count something,
-   and it also holds the counts themselves */
-struct count {
-    unsigned int chars;
-    unsigned int words;
-    unsigned int lines;
-    unsigned int longest;
-};
+#define OPT_FILES0_FROM 256
 
 static void showHelp()
 {
@@ -44,56 +47,270 @@ static void showHelp()
     one FILE is specified.  With no FILE, read standard input.\n\n\
 Options:\n\
     -c, --bytes\t\t  print the byte counts\n\
-    -m, --chars\t\t  print the character counts\n\
+    -m, --chars\t\t  print the character counts, as the locale defines them\n\
     -l, --lines\t\t  print the newline counts \n\
     -w, --words\t\t  print the word counts \n\
     -L, --max-line-length print the length of the longest line\n\
+    -j, --threads=N\t  count with N threads (default: one per CPU for\n\
+    \t\t\t  files of 16 MiB and more, and at least 8 for many files)\n\
+        --files0-from=F   read NUL-terminated file names from F\n\
     -h, --help\t\t  display this help and exit\n\
     -V, --version\t  output version information and exit\n\n\
 Report bugs to <darren@dragonbyte.ca>\n", APP_NAME);
 }
 
-static struct count count_all(char *filename)
+/*
+ * A large regular file is mapped and cut into one range per thread.
+ * Each range is counted as if it began a file, and the joins are fixed
+ * up afterwards: a word split across a cut was counted twice, and the
+ * line open at a cut continues into the next range.
+ */
+#define WC_SPLIT_MIN   (16 * 1024 * 1024)  /* Smallest range for automatic threads. */
+#define WC_RANGE_MIN   (64 * 1024)         /* Smallest range for --threads. */
+#define WC_MAX_THREADS 256
+
+/* Threads per file, or 0 to pick from the CPU count and file size. */
+static unsigned n_threads;
+
+/* The state every count starts from, set up once options are known. */
+static struct count_state count_proto;
+
+struct wc_range {
+    const uint8_t *buf;
+    size_t len;
+    struct count_state st;  /* Set up before the thread starts. */
+    struct count counts;
+};
+
+static void *count_range(void *arg)
+{
+    struct wc_range *r = arg;
+
+    r->counts = (struct count){ .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+    count_buffer(r->buf, r->len, &r->counts, &r->st);
+    return nullptr;
+}
+
+/* The number of threads to count a file of 'size' bytes with. */
+static unsigned threads_for(const uint64_t size)
 {
-    FILE *fp;
+    uint64_t n = n_threads;
+    uint64_t most = size / WC_RANGE_MIN;
 
-    if ((fp = fopen(filename, "r")) == NULL ) {
-        fprintf(stderr, "%s: error opening %s: %s\n",
-            APP_NAME, filename, strerror(errno));
-        exit(EXIT_FAILURE);
+    if (n == 0) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (uint64_t)cpus : 1;
+        most = size / WC_SPLIT_MIN;
     }
+    if (n > most) {
+        n = most;
+    }
+    if (n > WC_MAX_THREADS) {
+        n = WC_MAX_THREADS;
+    }
+    return n ? (unsigned)n : 1;
+}
 
-    struct count t_counts = { .chars = 0, .words = 0, .lines = 0, .longest = 0 };
+/* Count a regular file of 'size' bytes with 'threads' threads.
+ * Returns false if it could not be mapped. */
+static bool count_mapped(const int fd, const size_t size, const unsigned threads,
+                         struct count *t)
+{
+    uint8_t *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
 
-    int c;
-    int state = 0;
-    unsigned int current_line_count = 0;
+    struct wc_range ranges[WC_MAX_THREADS];
+    pthread_t tids[WC_MAX_THREADS];
+    bool started[WC_MAX_THREADS];
+    const size_t step = size / threads;
+    size_t cut[WC_MAX_THREADS + 1];
 
+    /* Cut where a UTF-8 character starts, so that none is split. A run
+     * of more continuation bytes than any character has is malformed
+     * anyway, and is cut where it falls. */
+    cut[0] = 0;
+    cut[threads] = size;
+    for (unsigned i = 1; i < threads; i++) {
+        cut[i] = i * step;
+        for (int k = 0; k < 5 && (map[cut[i]] & 0xc0) == 0x80; k++) {
+            cut[i]++;
+        }
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        ranges[i].buf = map + cut[i];
+        ranges[i].len = cut[i + 1] - cut[i];
+        ranges[i].st = count_proto;
+        started[i] = i > 0 && pthread_create(&tids[i], nullptr, count_range, &ranges[i]) == 0;
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        if (started[i]) {
+            pthread_join(tids[i], nullptr);
+        } else {
+            count_range(&ranges[i]);
+        }
+    }
+
+    uint64_t open_line = 0;
+    for (unsigned i = 0; i < threads; i++) {
+        const struct wc_range *r = &ranges[i];
 
-    while ((c = getc(fp)) != EOF) {
-        current_line_count++;  /* Longest line char counter. */
-        t_counts.chars++;      /* Everything is a char. */
+        t->chars += r->counts.chars;
+        t->bytes += r->counts.bytes;
+        t->lines += r->counts.lines;
+        t->words += r->counts.words;
+        if (i > 0 && !wc_is_blank(r->buf[-1]) && !wc_is_blank(r->buf[0])) {
+            t->words--;
+        }
 
-        if (c == '\n') {
-            ++t_counts.lines;
-            /* We do not count the newline, so we remove
-             * it from the comparison and assignment. */
-            if (current_line_count - 1 > t_counts.longest) {
-                t_counts.longest = current_line_count - 1;
+        if (count_proto.longest) {
+            /* The range's own longest may include a first line cut
+             * short, but that can only be below its true length. */
+            if (r->counts.longest > t->longest) {
+                t->longest = r->counts.longest;
+            }
+            const uint8_t *nl = memchr(r->buf, '\n', r->len);
+            if (nl == nullptr) {
+                open_line += r->len;
+                continue;
+            }
+            if (open_line + (nl - r->buf) > t->longest) {
+                t->longest = open_line + (nl - r->buf);
             }
-            current_line_count = 0;
+            open_line = r->st.current_line_count;
         }
+    }
+    munmap(map, size);
+    return true;
+}
+
+/* Count one file, "-" being stdin. Returns false with errno
+ * set if it cannot be opened. */
+static bool count_all(const char *filename, struct count *t_counts)
+{
+    struct io_reader in;
 
-        /* A word boundary. */
-        if (c == ' ' || c == '\n' || c == '\t')
-            state = 0;
-        else if (state == 0) {
-            state = 1;
-            ++t_counts.words;
+    if (!io_open(&in, filename, APP_NAME)) {
+        return false;
+    }
+
+    struct stat sb;
+    if (count_splittable(&count_proto) && fstat(in.fd, &sb) == 0 && S_ISREG(sb.st_mode)
+        && sb.st_size > 0 && lseek(in.fd, 0, SEEK_CUR) == 0) {
+        const unsigned threads = threads_for(sb.st_size);
+        if (threads > 1 && count_mapped(in.fd, sb.st_size, threads, t_counts)) {
+            io_close(&in);
+            return true;
         }
+    }
 
+    struct count_state st = count_proto;
+    const uint8_t *buf;
+    size_t n;
+
+    while ((n = io_read(&in, &buf)) > 0) {
+        count_buffer(buf, n, t_counts, &st);
     }
-    return t_counts;
+    io_close(&in);
+    return true;
+}
+
+/*
+ * Several files are counted on a pool of workers (pool.h), one file
+ * per job, so that output stays in argument order.
+ */
+#define WC_JOBS_PER_WORKER 4
+
+struct wc_job {
+    char *name;
+    bool owned;     /* name was read from --files0-from. */
+    int error;
+    struct count counts;
+};
+
+static bool next_job(struct pool *p, void *job)
+{
+    struct wc_job *j = job;
+    j->name = names_next(p->arg, &j->owned, APP_NAME);
+    return j->name != nullptr;
+}
+
+static void run_jobs(struct pool *p, void *state, const size_t first, const size_t n)
+{
+    (void)state;
+    for (size_t i = 0; i < n; i++) {
+        struct wc_job *job = pool_job(p, first + i);
+        job->counts = (struct count){ .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+        job->error = 0;
+        if (job->name[0] == '\0') {
+            job->error = ENOENT;
+        } else if (!count_all(job->name, &job->counts)) {
+            job->error = errno;
+        }
+    }
+}
+
+static void print_counts(const struct count *c, const struct count *opts, const char *label)
+{
+    if (opts->lines)
+        printf("%5" PRIu64 " ", c->lines);
+    if (opts->words)
+        printf("%5" PRIu64 " ", c->words);
+    if (opts->chars)
+        printf("%5" PRIu64 " ", c->chars);
+    if (opts->bytes)
+        printf("%5" PRIu64 " ", c->bytes);
+    if (opts->longest)
+        printf("%5" PRIu64 " ", c->longest);
+    printf("%s\n", label);
+}
+
+/* Count and print every file from src, adding them to *total.
+ * Returns the number of files, and sets *failed if any could not be read. */
+static size_t count_files(struct name_source *src, const struct count *opts,
+                          struct count *total, bool *failed)
+{
+    const size_t files = src->files0 == nullptr ? (size_t)src->argc : SIZE_MAX;
+    struct pool pool = {
+        .job_size = sizeof(struct wc_job),
+        .batch = 1,
+        .next = next_job,
+        .run = run_jobs,
+        .arg = src,
+        .app_name = APP_NAME
+    };
+    pool_start(&pool, pool_workers(n_threads, files), WC_JOBS_PER_WORKER, 1, nullptr);
+
+    size_t printed = 0;
+    struct wc_job *job;
+    while ((job = pool_take(&pool)) != nullptr) {
+        if (job->name[0] == '\0') {
+            fflush(stdout);
+            fprintf(stderr, "%s: invalid zero-length file name\n", APP_NAME);
+            *failed = true;
+        } else if (job->error != 0) {
+            fflush(stdout);
+            fprintf(stderr, "%s: error opening %s: %s\n",
+                APP_NAME, job->name, strerror(job->error));
+            *failed = true;
+        } else {
+            print_counts(&job->counts, opts, job->name);
+            total->lines += job->counts.lines;
+            total->words += job->counts.words;
+            total->chars += job->counts.chars;
+            total->bytes += job->counts.bytes;
+            if (job->counts.longest > total->longest)
+                total->longest = job->counts.longest;
+        }
+        if (job->owned) {
+            free(job->name);
+        }
+        printed++;
+    }
+    pool_stop(&pool);
+    return printed;
 }
 
 int main(const int argc, char *argv[])
@@ -106,17 +323,23 @@ int main(const int argc, char *argv[])
         { .name = "words",           .has_arg = no_argument, .flag = nullptr, .val = 'w' },
         { .name = "version",         .has_arg = no_argument, .flag = nullptr, .val = 'V' },
         { .name = "max-line-length", .has_arg = no_argument, .flag = nullptr, .val = 'L' },
+        { .name = "threads",         .has_arg = required_argument, .flag = nullptr, .val = 'j' },
+        { .name = "files0-from",     .has_arg = required_argument, .flag = nullptr, .val = OPT_FILES0_FROM },
+        STATS_LONG_OPT,
         { .name = nullptr,           .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
 
     int opt;
-    struct count opts = { .chars = 0, .words = 0, .lines = 0, .longest = 0 };
-    while ((opt = getopt_long(argc, argv, "hcmlLwV", longopts, NULL)) != -1) {
+    const char *files0_from = nullptr;
+    struct count opts = { .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+    while ((opt = getopt_long(argc, argv, "hcmlLwVj:", longopts, NULL)) != -1) {
         switch(opt) {
             case 'L':
                 opts.longest = 1;
                 break;
-            case 'c':  /* Bytes same as chars until Unicode support is added. */
+            case 'c':
+                opts.bytes = 1;
+                break;
             case 'm':
                 opts.chars = 1;
                 break;
@@ -126,6 +349,15 @@ int main(const int argc, char *argv[])
             case 'w':
                 opts.words = 1;
                 break;
+            case 'j': {
+                const int min = 1;
+                const int max = WC_MAX_THREADS;
+                n_threads = (unsigned)parse_numeric_arg(optarg, &min, &max, APP_NAME);
+                break;
+            }
+            case OPT_FILES0_FROM:
+                files0_from = optarg;
+                break;
             case 'h':
                 showHelp();
                 return EXIT_SUCCESS;
@@ -135,74 +367,65 @@ int main(const int argc, char *argv[])
                        strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__,
                        __DATE__, __TIME__);
                 return EXIT_SUCCESS;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 showHelp();
                 return EXIT_FAILURE;
         }
     }
 
-    /* If there are no options we count all but the longest line */
-    if (opts.chars == 0 && opts.lines == 0 && opts.words == 0 && opts.longest == 0)
-        opts.chars = opts.lines = opts.words = 1;
+    /* If there are no options we count lines, words and bytes */
+    if (opts.chars == 0 && opts.bytes == 0 && opts.lines == 0 && opts.words == 0 && opts.longest == 0)
+        opts.bytes = opts.lines = opts.words = 1;
 
-    struct count t_counts;
-    struct count t_cumulative = { .chars = 0, .words = 0, .lines = 0, .longest = 0 };;
-    bool multiple_args = false;
+    setlocale(LC_CTYPE, "");
+    count_init(&count_proto, opts.longest, opts.chars);
 
-    if (argc == optind) {
-        /* We're dealing with STDIN. Using /de/fd/0
-         * is not POSIX, but APUE says this works on
-         * *BSD, OS X. Linux and Solaris. */
-        t_counts = count_all("/dev/fd/0");
-        if (opts.lines)
-            printf("%i ", t_counts.lines);
-        if (opts.words)
-            printf("%i ", t_counts.words);
-        if (opts.chars)
-            printf("%i ", t_counts.chars);
-        if (opts.longest)
-            printf("%i ", t_counts.longest);
-        printf("\n");
+    struct count t_counts = { .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+    struct count t_cumulative = { .chars = 0, .bytes = 0, .words = 0, .lines = 0, .longest = 0 };
+    bool failed = false;
 
-    } else {
-        /* Cycle through file arguments. */
-        if (argc > optind + 1) {
-            multiple_args = true;
+    if (files0_from != nullptr) {
+        if (optind < argc) {
+            fprintf(stderr, "%s: file operands cannot be combined with --files0-from\n", APP_NAME);
+            return EXIT_FAILURE;
         }
-
-        while (optind < argc) {
-            t_counts = count_all(argv[optind]);
-            if (opts.lines)
-                printf("%5i ", t_counts.lines);
-            if (opts.words)
-                printf("%5i ", t_counts.words);
-            if (opts.chars)
-                printf("%5i ", t_counts.chars);
-            if (opts.longest)
-                printf("%5i ", t_counts.longest);
-            printf("%s\n", argv[optind]);
-            optind++;
-
-            t_cumulative.lines   += t_counts.lines;
-            t_cumulative.words   += t_counts.words;
-            t_cumulative.chars   += t_counts.chars;
-
-            if (t_counts.longest > t_cumulative.longest)
-                t_cumulative.longest = t_counts.longest;
+        struct name_source src = { 0 };
+        if (!names_open_files0(&src, files0_from, APP_NAME)) {
+            return EXIT_FAILURE;
         }
-    }
+        if (count_files(&src, &opts, &t_cumulative, &failed) > 1) {
+            print_counts(&t_cumulative, &opts, "total");
+        }
+        names_close(&src);
 
-    /* If there were multiple files, print the totals line. */
-    if (multiple_args) {
+    } else if (argc == optind) {
+        /* We're dealing with STDIN. */
+        if (!count_all("-", &t_counts)) {
+            fprintf(stderr, "%s: error opening -: %s\n", APP_NAME, strerror(errno));
+            return EXIT_FAILURE;
+        }
         if (opts.lines)
-            printf("%5i ", t_cumulative.lines);
+            printf("%" PRIu64 " ", t_counts.lines);
         if (opts.words)
-            printf("%5i ", t_cumulative.words);
+            printf("%" PRIu64 " ", t_counts.words);
         if (opts.chars)
-            printf("%5i ", t_cumulative.chars);
+            printf("%" PRIu64 " ", t_counts.chars);
+        if (opts.bytes)
+            printf("%" PRIu64 " ", t_counts.bytes);
         if (opts.longest)
-            printf("%5i ", t_cumulative.longest);
-        printf("total\n");
+            printf("%" PRIu64 " ", t_counts.longest);
+        printf("\n");
+
+    } else {
+        /* Cycle through file arguments. If there were
+         * multiple files, print the totals line. */
+        struct name_source src = { .argv = argv + optind, .argc = argc - optind };
+        if (count_files(&src, &opts, &t_cumulative, &failed) > 1) {
+            print_counts(&t_cumulative, &opts, "total");
+        }
     }
-    return EXIT_SUCCESS;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
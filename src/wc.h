@@ -0,0 +1,814 @@
+/***************************************************************************
+ *   wc.h - the counting loop used by wc                                   *
+ *                                                                         *
+ *   Copyright (C) 2014 - 2026 by Darren Kirby                             *
+ *   darren@dragonbyte.ca                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef WC_H
+#define WC_H
+
+#include <langinfo.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "cpu.h"
+
+/* Our count struct is used both for storing boolean
+   values regarding _if_ we want to count something,
+   and it also holds the counts themselves */
+struct count {
+    uint64_t chars;
+    uint64_t bytes;
+    uint64_t words;
+    uint64_t lines;
+    uint64_t longest;
+};
+
+/* Counts newlines and word starts in len bytes of buf into t. *in_word
+ * says whether the byte before buf was part of a word, and is updated
+ * for the next call. */
+typedef void count_words_fn(const uint8_t *buf, size_t len, struct count *t, bool *in_word);
+
+/* Sets *chars to the number of characters in len bytes of UTF-8, or
+ * returns false if they are not whole, valid UTF-8 characters. */
+typedef bool count_utf8_fn(const uint8_t *buf, size_t len, uint64_t *chars);
+
+/* What a character is in the current locale. */
+enum char_mode {
+    CHARS_BYTES,   /* A single-byte locale: every byte. */
+    CHARS_UTF8,    /* UTF-8: the block kernels, mbrtowc() where the text is malformed. */
+    CHARS_MB       /* Any other multibyte locale: whatever mbrtowc() says. */
+};
+
+/* Scanner state carried from one buffer to the next. */
+struct count_state {
+    bool in_word;
+    bool longest;                  /* Track line lengths, for -L. */
+    bool chars;                    /* Count characters, for -m. */
+    enum char_mode char_mode;
+    uint64_t current_line_count;
+    mbstate_t chars_mb;            /* A character split across buffers. */
+    mbstate_t width_mb;
+    count_words_fn *count_words;
+    count_utf8_fn *count_utf8;
+};
+
+static inline bool wc_is_blank(const uint8_t c)
+{
+    return c == ' ' || c == '\n' || c == '\t';
+}
+
+static inline void count_words_bytes(const uint8_t *buf, const size_t len,
+                                     struct count *t, bool *in_word)
+{
+    uint64_t lines = 0;
+    uint64_t words = 0;
+    bool in = *in_word;
+
+    for (size_t i = 0; i < len; i++) {
+        const bool blank = wc_is_blank(buf[i]);
+        lines += buf[i] == '\n';
+        words += !blank & !in;
+        in = !blank;
+    }
+    t->lines += lines;
+    t->words += words;
+    *in_word = in;
+}
+
+/*
+ * The block kernels look at 64 bytes at a time, and turn them into
+ * one bit per byte: 'nl' for newlines and 'blank' for any word
+ * separator. A word starts at every non-blank byte whose predecessor is
+ * blank; the predecessor of bit 0 is the last byte of the block before,
+ * carried in *prev_blank.
+ */
+static inline void count_masks(const uint64_t nl, const uint64_t blank, uint64_t *prev_blank,
+                               uint64_t *lines, uint64_t *words)
+{
+    *lines += __builtin_popcountll(nl);
+    *words += __builtin_popcountll(~blank & (blank << 1 | *prev_blank));
+    *prev_blank = blank >> 63;
+}
+
+/* One bit per byte of x equal to c, in memory order, found
+ * eight bytes at a time with ordinary integer arithmetic. */
+static inline uint64_t wc_byte_mask(const uint64_t x, const uint8_t c)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    const uint64_t y = x ^ (0x0101010101010101ULL * c);
+    const uint64_t zero = ~(((y & low7) + low7) | y | low7);
+    return ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+static inline void count_words_scalar(const uint8_t *buf, const size_t len,
+                                      struct count *t, bool *in_word)
+{
+    uint64_t prev_blank = !*in_word;
+    uint64_t lines = 0;
+    uint64_t words = 0;
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        uint64_t nl_mask = 0;
+        uint64_t blank = 0;
+        for (int j = 0; j < 8; j++) {
+            uint64_t x;
+            memcpy(&x, buf + i + j * 8, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            x = __builtin_bswap64(x);
+#endif
+            const uint64_t nl = wc_byte_mask(x, '\n');
+            nl_mask |= nl << (j * 8);
+            blank |= (nl | wc_byte_mask(x, ' ') | wc_byte_mask(x, '\t')) << (j * 8);
+        }
+        count_masks(nl_mask, blank, &prev_blank, &lines, &words);
+    }
+    t->lines += lines;
+    t->words += words;
+    *in_word = !prev_blank;
+    count_words_bytes(buf + i, len - i, t, in_word);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+CPU_TARGET_AVX512
+static void count_words_avx512(const uint8_t *buf, const size_t len,
+                               struct count *t, bool *in_word)
+{
+    const __m512i nl = _mm512_set1_epi8('\n');
+    const __m512i space = _mm512_set1_epi8(' ');
+    const __m512i tab = _mm512_set1_epi8('\t');
+    uint64_t prev_blank = !*in_word;
+    uint64_t lines = 0;
+    uint64_t words = 0;
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        const __m512i v = _mm512_loadu_si512(buf + i);
+        const uint64_t nl_mask = _mm512_cmpeq_epi8_mask(v, nl);
+        const uint64_t blank = nl_mask | _mm512_cmpeq_epi8_mask(v, space)
+                             | _mm512_cmpeq_epi8_mask(v, tab);
+        count_masks(nl_mask, blank, &prev_blank, &lines, &words);
+    }
+    t->lines += lines;
+    t->words += words;
+    *in_word = !prev_blank;
+    count_words_bytes(buf + i, len - i, t, in_word);
+}
+
+CPU_TARGET_AVX2
+static void count_words_avx2(const uint8_t *buf, const size_t len,
+                             struct count *t, bool *in_word)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    uint64_t prev_blank = !*in_word;
+    uint64_t lines = 0;
+    uint64_t words = 0;
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        const __m256i lo = _mm256_loadu_si256((const __m256i *)(buf + i));
+        const __m256i hi = _mm256_loadu_si256((const __m256i *)(buf + i + 32));
+        const __m256i nl_lo = _mm256_cmpeq_epi8(lo, nl);
+        const __m256i nl_hi = _mm256_cmpeq_epi8(hi, nl);
+        const __m256i blank_lo = _mm256_or_si256(nl_lo, _mm256_or_si256(
+            _mm256_cmpeq_epi8(lo, space), _mm256_cmpeq_epi8(lo, tab)));
+        const __m256i blank_hi = _mm256_or_si256(nl_hi, _mm256_or_si256(
+            _mm256_cmpeq_epi8(hi, space), _mm256_cmpeq_epi8(hi, tab)));
+
+        const uint64_t nl_mask = (uint32_t)_mm256_movemask_epi8(nl_lo)
+                               | (uint64_t)(uint32_t)_mm256_movemask_epi8(nl_hi) << 32;
+        const uint64_t blank = (uint32_t)_mm256_movemask_epi8(blank_lo)
+                             | (uint64_t)(uint32_t)_mm256_movemask_epi8(blank_hi) << 32;
+        count_masks(nl_mask, blank, &prev_blank, &lines, &words);
+    }
+    t->lines += lines;
+    t->words += words;
+    *in_word = !prev_blank;
+    count_words_bytes(buf + i, len - i, t, in_word);
+}
+
+/* SSE2 compares, built for SSE4.2 so that POPCNT is available. */
+CPU_TARGET_SSE42
+static void count_words_sse42(const uint8_t *buf, const size_t len,
+                              struct count *t, bool *in_word)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    uint64_t prev_blank = !*in_word;
+    uint64_t lines = 0;
+    uint64_t words = 0;
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        uint64_t nl_mask = 0;
+        uint64_t blank = 0;
+        for (int j = 0; j < 4; j++) {
+            const __m128i v = _mm_loadu_si128((const __m128i *)(buf + i + j * 16));
+            const __m128i v_nl = _mm_cmpeq_epi8(v, nl);
+            const __m128i v_blank = _mm_or_si128(v_nl, _mm_or_si128(
+                _mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)));
+            nl_mask |= (uint64_t)_mm_movemask_epi8(v_nl) << (j * 16);
+            blank |= (uint64_t)_mm_movemask_epi8(v_blank) << (j * 16);
+        }
+        count_masks(nl_mask, blank, &prev_blank, &lines, &words);
+    }
+    t->lines += lines;
+    t->words += words;
+    *in_word = !prev_blank;
+    count_words_bytes(buf + i, len - i, t, in_word);
+}
+#endif
+
+/*
+ * In UTF-8 every character has exactly one byte outside 0x80-0xbf, so
+ * counting the characters of valid text is counting those bytes, which
+ * as signed values are the ones above -65. The kernels check that the
+ * text is valid as they count, and give up if it is not, so that
+ * count_utf8_chars() can leave malformed text to mbrtowc().
+ *
+ * Only RFC 3629 UTF-8 passes: no overlong forms, surrogates, or code
+ * points above U+10FFFF. Anything the C library accepts beyond that is
+ * still counted the library's way, just more slowly.
+ */
+
+/* The length of the character at p, of the n bytes left, or 0 if it is not valid. */
+static inline size_t utf8_char_len(const uint8_t *p, const size_t n)
+{
+    const uint8_t b = p[0];
+    size_t len;
+    uint8_t lo = 0x80;  /* The range of the second byte. */
+    uint8_t hi = 0xbf;
+
+    if (b < 0x80) {
+        return 1;
+    } else if (b >= 0xc2 && b <= 0xdf) {
+        len = 2;
+    } else if (b >= 0xe0 && b <= 0xef) {
+        len = 3;
+        lo = b == 0xe0 ? 0xa0 : lo;
+        hi = b == 0xed ? 0x9f : hi;
+    } else if (b >= 0xf0 && b <= 0xf4) {
+        len = 4;
+        lo = b == 0xf0 ? 0x90 : lo;
+        hi = b == 0xf4 ? 0x8f : hi;
+    } else {
+        return 0;
+    }
+    if (n < len || p[1] < lo || p[1] > hi) {
+        return 0;
+    }
+    for (size_t i = 2; i < len; i++) {
+        if ((p[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/* Eight bytes at a time while they are ASCII, else a character at a time. */
+static inline bool count_utf8_scalar(const uint8_t *buf, const size_t len, uint64_t *chars)
+{
+    uint64_t n = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t x;
+            memcpy(&x, buf + i, sizeof(x));
+            if ((x & 0x8080808080808080ULL) == 0) {
+                n += 8;
+                i += 8;
+                continue;
+            }
+        }
+        const size_t k = utf8_char_len(buf + i, len - i);
+        if (k == 0) {
+            return false;
+        }
+        n++;
+        i += k;
+    }
+    *chars = n;
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * The vector kernels validate as in Keiser and Lemire, "Validating
+ * UTF-8 In Less Than One Instruction Per Byte": the high nibble of each
+ * byte and both nibbles of the byte before it look up three 16-entry
+ * tables of error bits, whose AND is non-zero where that pair of bytes
+ * cannot occur. The third and fourth bytes of long characters, which
+ * no pair can vouch for, are checked against the bytes two and three
+ * back. Text is taken 64 bytes at a time, the last block padded with
+ * zeros, so a character cut short by the end shows as an error.
+ */
+#define WC_U8_TOO_SHORT   (1 << 0)  /* A lead byte without its continuation. */
+#define WC_U8_TOO_LONG    (1 << 1)  /* A continuation byte after ASCII. */
+#define WC_U8_OVERLONG_3  (1 << 2)
+#define WC_U8_TOO_LARGE   (1 << 3)  /* Above U+10FFFF. */
+#define WC_U8_SURROGATE   (1 << 4)
+#define WC_U8_OVERLONG_2  (1 << 5)
+#define WC_U8_TOO_LARGE_1000 (1 << 6)
+#define WC_U8_OVERLONG_4  (1 << 6)
+#define WC_U8_TWO_CONTS   (1 << 7)  /* Two continuation bytes, checked separately. */
+#define WC_U8_CARRY (WC_U8_TOO_SHORT | WC_U8_TOO_LONG | WC_U8_TWO_CONTS)
+
+alignas(16) static const uint8_t wc_utf8_byte1_high[16] = {
+    /* 0xxx: ASCII */
+    WC_U8_TOO_LONG, WC_U8_TOO_LONG, WC_U8_TOO_LONG, WC_U8_TOO_LONG,
+    WC_U8_TOO_LONG, WC_U8_TOO_LONG, WC_U8_TOO_LONG, WC_U8_TOO_LONG,
+    /* 10xx: continuation */
+    WC_U8_TWO_CONTS, WC_U8_TWO_CONTS, WC_U8_TWO_CONTS, WC_U8_TWO_CONTS,
+    /* 1100, 1101: two-byte lead */
+    WC_U8_TOO_SHORT | WC_U8_OVERLONG_2,
+    WC_U8_TOO_SHORT,
+    /* 1110: three-byte lead */
+    WC_U8_TOO_SHORT | WC_U8_OVERLONG_3 | WC_U8_SURROGATE,
+    /* 1111: four-byte lead, or worse */
+    WC_U8_TOO_SHORT | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000 | WC_U8_OVERLONG_4,
+};
+
+alignas(16) static const uint8_t wc_utf8_byte1_low[16] = {
+    WC_U8_CARRY | WC_U8_OVERLONG_3 | WC_U8_OVERLONG_2 | WC_U8_OVERLONG_4,    /* ____0000 */
+    WC_U8_CARRY | WC_U8_OVERLONG_2,                                         /* ____0001 */
+    WC_U8_CARRY,
+    WC_U8_CARRY,
+    WC_U8_CARRY | WC_U8_TOO_LARGE,                                          /* ____0100 */
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000 | WC_U8_SURROGATE,  /* ____1101 */
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+    WC_U8_CARRY | WC_U8_TOO_LARGE | WC_U8_TOO_LARGE_1000,
+};
+
+alignas(16) static const uint8_t wc_utf8_byte2_high[16] = {
+    /* 0xxx: ASCII */
+    WC_U8_TOO_SHORT, WC_U8_TOO_SHORT, WC_U8_TOO_SHORT, WC_U8_TOO_SHORT,
+    WC_U8_TOO_SHORT, WC_U8_TOO_SHORT, WC_U8_TOO_SHORT, WC_U8_TOO_SHORT,
+    /* 1000 */
+    WC_U8_TOO_LONG | WC_U8_OVERLONG_2 | WC_U8_TWO_CONTS | WC_U8_OVERLONG_3 | WC_U8_TOO_LARGE_1000 | WC_U8_OVERLONG_4,
+    /* 1001 */
+    WC_U8_TOO_LONG | WC_U8_OVERLONG_2 | WC_U8_TWO_CONTS | WC_U8_OVERLONG_3 | WC_U8_TOO_LARGE,
+    /* 101x */
+    WC_U8_TOO_LONG | WC_U8_OVERLONG_2 | WC_U8_TWO_CONTS | WC_U8_SURROGATE | WC_U8_TOO_LARGE,
+    WC_U8_TOO_LONG | WC_U8_OVERLONG_2 | WC_U8_TWO_CONTS | WC_U8_SURROGATE | WC_U8_TOO_LARGE,
+    /* 11xx: a lead byte */
+    WC_U8_TOO_SHORT, WC_U8_TOO_SHORT, WC_U8_TOO_SHORT, WC_U8_TOO_SHORT,
+};
+
+/* Subtracted with saturation from the end of a block, non-zero where a
+ * character started in its last three bytes runs past it. */
+alignas(64) static const uint8_t wc_utf8_max[64] = {
+    [0 ... 60] = 0xff, [61] = 0xf0 - 1, [62] = 0xe0 - 1, [63] = 0xc0 - 1
+};
+
+CPU_TARGET_AVX512
+static inline __m512i utf8_errors_avx512(const __m512i in, const __m512i prev)
+{
+    const __m512i nib = _mm512_set1_epi8(0x0f);
+    const __m512i t1h = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i *)wc_utf8_byte1_high));
+    const __m512i t1l = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i *)wc_utf8_byte1_low));
+    const __m512i t2h = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i *)wc_utf8_byte2_high));
+
+    /* 'in' moved up one 16-byte lane, with the top lane of 'prev' below. */
+    const __m512i shifted = _mm512_permutex2var_epi64(prev, _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6), in);
+    const __m512i prev1 = _mm512_alignr_epi8(in, shifted, 15);
+    const __m512i prev2 = _mm512_alignr_epi8(in, shifted, 14);
+    const __m512i prev3 = _mm512_alignr_epi8(in, shifted, 13);
+
+    const __m512i special = _mm512_and_si512(
+        _mm512_and_si512(_mm512_shuffle_epi8(t1h, _mm512_and_si512(_mm512_srli_epi16(prev1, 4), nib)),
+                         _mm512_shuffle_epi8(t1l, _mm512_and_si512(prev1, nib))),
+        _mm512_shuffle_epi8(t2h, _mm512_and_si512(_mm512_srli_epi16(in, 4), nib)));
+    const __m512i must23 = _mm512_or_si512(_mm512_subs_epu8(prev2, _mm512_set1_epi8(0xe0 - 0x80)),
+                                           _mm512_subs_epu8(prev3, _mm512_set1_epi8(0xf0 - 0x80)));
+    return _mm512_xor_si512(_mm512_and_si512(must23, _mm512_set1_epi8((char)0x80)), special);
+}
+
+CPU_TARGET_AVX512
+static bool count_utf8_avx512(const uint8_t *buf, const size_t len, uint64_t *chars)
+{
+    const __m512i cont_max = _mm512_set1_epi8(-65);
+    const __m512i max = _mm512_load_si512(wc_utf8_max);
+    __m512i prev = _mm512_setzero_si512();
+    __m512i err = _mm512_setzero_si512();
+    __m512i incomplete = _mm512_setzero_si512();
+    alignas(64) uint8_t last[64];
+    uint64_t n = 0;
+
+    for (size_t i = 0; i < len; i += 64) {
+        const uint8_t *p = buf + i;
+        if (len - i < 64) {
+            memset(last, 0, sizeof(last));
+            memcpy(last, p, len - i);
+            p = last;
+            n -= 64 - (len - i);  /* The padding counts as ASCII below. */
+        }
+        const __m512i v = _mm512_loadu_si512(p);
+        if (_mm512_movepi8_mask(v) == 0) {
+            n += 64;  /* All ASCII. */
+            err = _mm512_or_si512(err, incomplete);
+            incomplete = _mm512_setzero_si512();
+        } else {
+            n += __builtin_popcountll(_mm512_cmpgt_epi8_mask(v, cont_max));
+            err = _mm512_or_si512(err, utf8_errors_avx512(v, prev));
+            incomplete = _mm512_subs_epu8(v, max);
+        }
+        prev = v;
+    }
+    err = _mm512_or_si512(err, incomplete);
+    *chars = n;
+    return _mm512_test_epi8_mask(err, err) == 0;
+}
+
+CPU_TARGET_AVX2
+static inline __m256i utf8_errors_avx2(const __m256i in, const __m256i prev)
+{
+    const __m256i nib = _mm256_set1_epi8(0x0f);
+    const __m256i t1h = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)wc_utf8_byte1_high));
+    const __m256i t1l = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)wc_utf8_byte1_low));
+    const __m256i t2h = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)wc_utf8_byte2_high));
+
+    /* The high lane of 'prev' and the low lane of 'in'. */
+    const __m256i shifted = _mm256_permute2x128_si256(prev, in, 0x21);
+    const __m256i prev1 = _mm256_alignr_epi8(in, shifted, 15);
+    const __m256i prev2 = _mm256_alignr_epi8(in, shifted, 14);
+    const __m256i prev3 = _mm256_alignr_epi8(in, shifted, 13);
+
+    const __m256i special = _mm256_and_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(t1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nib)),
+                         _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, nib))),
+        _mm256_shuffle_epi8(t2h, _mm256_and_si256(_mm256_srli_epi16(in, 4), nib)));
+    const __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                                           _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+    return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char)0x80)), special);
+}
+
+CPU_TARGET_AVX2
+static bool count_utf8_avx2(const uint8_t *buf, const size_t len, uint64_t *chars)
+{
+    const __m256i cont_max = _mm256_set1_epi8(-65);
+    const __m256i max = _mm256_load_si256((const __m256i *)(wc_utf8_max + 32));
+    __m256i prev = _mm256_setzero_si256();
+    __m256i err = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    alignas(32) uint8_t last[64];
+    uint64_t n = 0;
+
+    for (size_t i = 0; i < len; i += 64) {
+        const uint8_t *p = buf + i;
+        if (len - i < 64) {
+            memset(last, 0, sizeof(last));
+            memcpy(last, p, len - i);
+            p = last;
+            n -= 64 - (len - i);  /* The padding counts as ASCII below. */
+        }
+        const __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+        const __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+        if (_mm256_movemask_epi8(_mm256_or_si256(lo, hi)) == 0) {
+            n += 64;  /* All ASCII. */
+            err = _mm256_or_si256(err, incomplete);
+            incomplete = _mm256_setzero_si256();
+        } else {
+            const uint64_t starts = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(lo, cont_max))
+                                  | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(hi, cont_max)) << 32;
+            n += __builtin_popcountll(starts);
+            err = _mm256_or_si256(err, _mm256_or_si256(utf8_errors_avx2(lo, prev), utf8_errors_avx2(hi, lo)));
+            incomplete = _mm256_subs_epu8(hi, max);
+        }
+        prev = hi;
+    }
+    err = _mm256_or_si256(err, incomplete);
+    *chars = n;
+    return _mm256_testz_si256(err, err);
+}
+
+CPU_TARGET_SSE42
+static inline __m128i utf8_errors_sse42(const __m128i in, const __m128i prev)
+{
+    const __m128i nib = _mm_set1_epi8(0x0f);
+    const __m128i t1h = _mm_load_si128((const __m128i *)wc_utf8_byte1_high);
+    const __m128i t1l = _mm_load_si128((const __m128i *)wc_utf8_byte1_low);
+    const __m128i t2h = _mm_load_si128((const __m128i *)wc_utf8_byte2_high);
+
+    const __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+    const __m128i prev2 = _mm_alignr_epi8(in, prev, 14);
+    const __m128i prev3 = _mm_alignr_epi8(in, prev, 13);
+
+    const __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(t1h, _mm_and_si128(_mm_srli_epi16(prev1, 4), nib)),
+                      _mm_shuffle_epi8(t1l, _mm_and_si128(prev1, nib))),
+        _mm_shuffle_epi8(t2h, _mm_and_si128(_mm_srli_epi16(in, 4), nib)));
+    const __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                                        _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+    return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8((char)0x80)), special);
+}
+
+CPU_TARGET_SSE42
+static bool count_utf8_sse42(const uint8_t *buf, const size_t len, uint64_t *chars)
+{
+    const __m128i cont_max = _mm_set1_epi8(-65);
+    const __m128i max = _mm_load_si128((const __m128i *)(wc_utf8_max + 48));
+    __m128i prev = _mm_setzero_si128();
+    __m128i err = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    alignas(16) uint8_t last[64];
+    uint64_t n = 0;
+
+    for (size_t i = 0; i < len; i += 64) {
+        const uint8_t *p = buf + i;
+        if (len - i < 64) {
+            memset(last, 0, sizeof(last));
+            memcpy(last, p, len - i);
+            p = last;
+            n -= 64 - (len - i);  /* The padding counts as ASCII below. */
+        }
+        __m128i v[4];
+        uint64_t starts = 0;
+        uint32_t high = 0;
+        for (int j = 0; j < 4; j++) {
+            v[j] = _mm_loadu_si128((const __m128i *)(p + j * 16));
+            high |= _mm_movemask_epi8(v[j]);
+            starts |= (uint64_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v[j], cont_max)) << (j * 16);
+        }
+        if (high == 0) {
+            n += 64;  /* All ASCII. */
+            err = _mm_or_si128(err, incomplete);
+            incomplete = _mm_setzero_si128();
+        } else {
+            n += __builtin_popcountll(starts);
+            for (int j = 0; j < 4; j++) {
+                err = _mm_or_si128(err, utf8_errors_sse42(v[j], j > 0 ? v[j - 1] : prev));
+            }
+            incomplete = _mm_subs_epu8(v[3], max);
+        }
+        prev = v[3];
+    }
+    err = _mm_or_si128(err, incomplete);
+    *chars = n;
+    return _mm_testz_si128(err, err);
+}
+#endif
+
+static const struct {
+    uint32_t needs;
+    const char *isa;
+    count_utf8_fn *fn;
+} count_utf8_impls[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { .needs = CPU_AVX512, .isa = "avx512", .fn = count_utf8_avx512 },
+    { .needs = CPU_AVX2,   .isa = "avx2",   .fn = count_utf8_avx2 },
+    { .needs = CPU_SSE42,  .isa = "sse4.2", .fn = count_utf8_sse42 },
+#endif
+    { .needs = 0,          .isa = "scalar", .fn = count_utf8_scalar },
+};
+
+/* Characters in other multibyte locales. Bytes that do not
+ * form a character are skipped, as mbrtowc() rejects them. */
+static inline uint64_t count_mb_chars(const uint8_t *buf, size_t len, mbstate_t *mb)
+{
+    uint64_t chars = 0;
+
+    while (len > 0) {
+        if (*buf < 0x80 && mbsinit(mb)) {
+            chars++;
+            buf++;
+            len--;
+            continue;
+        }
+        wchar_t wc;
+        size_t n = mbrtowc(&wc, (const char *)buf, len, mb);
+        if (n == (size_t)-2) {
+            break;  /* Finished in the next buffer. */
+        }
+        if (n == (size_t)-1) {
+            memset(mb, 0, sizeof(*mb));
+            n = 1;
+        } else {
+            chars++;
+            n = n ? n : 1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return chars;
+}
+
+/*
+ * Characters in UTF-8. The text goes to the kernel a piece at a time,
+ * each piece cut where a character starts, and a piece the kernel
+ * rejects is counted again by count_mb_chars(), so malformed bytes are
+ * skipped exactly as in other multibyte locales. The last character
+ * of the buffer always goes to count_mb_chars(), which carries it over
+ * to the next buffer if it is cut short.
+ */
+#define WC_UTF8_PIECE (64 * 1024)
+
+static inline uint64_t count_utf8_chars(const uint8_t *buf, const size_t len, struct count_state *st)
+{
+    uint64_t chars = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (!mbsinit(&st->chars_mb)) {
+            /* Finish the character the last piece left open. */
+            wchar_t wc;
+            const size_t n = mbrtowc(&wc, (const char *)buf + i, len - i, &st->chars_mb);
+            if (n == (size_t)-2) {
+                break;
+            }
+            if (n == (size_t)-1) {
+                /* It was never finished. Start over from this byte. */
+                memset(&st->chars_mb, 0, sizeof(st->chars_mb));
+                continue;
+            }
+            chars++;
+            i += n ? n : 1;
+            continue;
+        }
+
+        size_t end = len - i > WC_UTF8_PIECE ? i + WC_UTF8_PIECE : len;
+        if (end == len) {
+            /* Back to the start of the last character. */
+            for (size_t k = 1; k <= 4 && k <= len - i; k++) {
+                if ((buf[len - k] & 0xc0) != 0x80) {
+                    end = len - k;
+                    break;
+                }
+            }
+        } else {
+            for (int k = 0; k < 3 && (buf[end] & 0xc0) == 0x80; k++) {
+                end--;
+            }
+        }
+
+        uint64_t n;
+        if (end > i && st->count_utf8(buf + i, end - i, &n)) {
+            chars += n;
+            i = end;
+            continue;
+        }
+        end = end > i ? end : len;
+        chars += count_mb_chars(buf + i, end - i, &st->chars_mb);
+        i = end;
+    }
+    return chars;
+}
+
+/* Add the display width of n bytes, none of them a newline, to the
+ * current line. ASCII is one column a byte, as in a single-byte locale,
+ * and a byte that is not part of a character also takes one. */
+static inline void add_line_width(const uint8_t *p, size_t n, struct count_state *st)
+{
+    while (n > 0) {
+        if (*p < 0x80 && mbsinit(&st->width_mb)) {
+            st->current_line_count++;
+            p++;
+            n--;
+            continue;
+        }
+        wchar_t wc;
+        size_t k = mbrtowc(&wc, (const char *)p, n, &st->width_mb);
+        if (k == (size_t)-2) {
+            break;
+        }
+        if (k == (size_t)-1) {
+            memset(&st->width_mb, 0, sizeof(st->width_mb));
+            st->current_line_count++;
+            k = 1;
+        } else {
+            const int w = wcwidth(wc);
+            st->current_line_count += w >= 0 ? w : 1;
+            k = k ? k : 1;
+        }
+        p += k;
+        n -= k;
+    }
+}
+
+/* The character mode of the current LC_CTYPE. */
+static inline enum char_mode count_char_mode(void)
+{
+    if (MB_CUR_MAX == 1) {
+        return CHARS_BYTES;
+    }
+    return strcmp(nl_langinfo(CODESET), "UTF-8") == 0 ? CHARS_UTF8 : CHARS_MB;
+}
+
+static const struct {
+    uint32_t needs;
+    const char *isa;
+    count_words_fn *fn;
+} count_words_impls[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { .needs = CPU_AVX512, .isa = "avx512", .fn = count_words_avx512 },
+    { .needs = CPU_AVX2,   .isa = "avx2",   .fn = count_words_avx2 },
+    { .needs = CPU_SSE42,  .isa = "sse4.2", .fn = count_words_sse42 },
+#endif
+    { .needs = 0,          .isa = "scalar", .fn = count_words_scalar },
+};
+
+/* Start a count, picking the kernels for this CPU. */
+static inline void count_init(struct count_state *st, const bool longest, const bool chars)
+{
+    st->in_word = false;
+    st->longest = longest;
+    st->chars = chars;
+    st->char_mode = count_char_mode();
+    st->current_line_count = 0;
+    memset(&st->chars_mb, 0, sizeof(st->chars_mb));
+    memset(&st->width_mb, 0, sizeof(st->width_mb));
+    st->count_words = CPU_SELECT(count_words_impls)->fn;
+    st->count_utf8 = CPU_SELECT(count_utf8_impls)->fn;
+}
+
+/* Whether a count can be cut between UTF-8 characters and rejoined: not
+ * when characters decoded by mbrtowc() or line widths might be split. */
+static inline bool count_splittable(const struct count_state *st)
+{
+    return !(st->chars && st->char_mode == CHARS_MB)
+        && !(st->longest && st->char_mode != CHARS_BYTES);
+}
+
+/* Add the counts for len bytes of buf to t_counts. */
+static inline void count_buffer(const uint8_t *buf, const size_t len,
+                                struct count *t_counts, struct count_state *st)
+{
+    t_counts->bytes += len;
+    if (st->chars) {
+        switch (st->char_mode) {
+            case CHARS_BYTES:
+                t_counts->chars += len;
+                break;
+            case CHARS_UTF8:
+                t_counts->chars += count_utf8_chars(buf, len, st);
+                break;
+            case CHARS_MB:
+                t_counts->chars += count_mb_chars(buf, len, &st->chars_mb);
+                break;
+        }
+    }
+    st->count_words(buf, len, t_counts, &st->in_word);
+
+    if (!st->longest) {
+        return;
+    }
+
+    /* We do not count the newline, so a line's length is the
+     * distance from its start to the newline. In a multibyte
+     * locale it is the line's width on screen instead. */
+    const bool width = st->char_mode != CHARS_BYTES;
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+    while (p < end) {
+        const uint8_t *nl = memchr(p, '\n', end - p);
+        const uint8_t *stop = nl ? nl : end;
+        if (width) {
+            add_line_width(p, stop - p, st);
+        } else {
+            st->current_line_count += stop - p;
+        }
+        if (nl == nullptr) {
+            break;
+        }
+        memset(&st->width_mb, 0, sizeof(st->width_mb));
+        if (st->current_line_count > t_counts->longest) {
+            t_counts->longest = st->current_line_count;
+        }
+        st->current_line_count = 0;
+        p = nl + 1;
+    }
+}
+
+#endif /* WC_H */
@@ -117,6 +117,7 @@ int main(const int argc, char *argv[])
         { .name = "all",     .has_arg = no_argument, .flag = nullptr, .val = 'a' },
         { .name = "boot",    .has_arg = no_argument, .flag = nullptr, .val = 'b' },
         { .name = "quick",   .has_arg = no_argument, .flag = nullptr, .val = 'q' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
 
@@ -138,6 +139,9 @@ int main(const int argc, char *argv[])
             case 'a':
                 print_boot_time();
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
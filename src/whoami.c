@@ -40,6 +40,7 @@ int main(const int argc, char *argv[])
     const struct option longopts[] = {
         { .name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h' },
         { .name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
 
@@ -57,6 +58,9 @@ int main(const int argc, char *argv[])
                 show_help();
                 return EXIT_SUCCESS;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
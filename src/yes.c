@@ -42,6 +42,7 @@ int main(const int argc, char *argv[])
     const struct option longopts[] = {
         { .name = "help",    .has_arg = no_argument, .flag = nullptr, .val = 'h' },
         { .name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'V' },
+        STATS_LONG_OPT,
         { .name = nullptr,   .has_arg = no_argument, .flag = nullptr, .val = 0 }
     };
     
@@ -59,6 +60,9 @@ int main(const int argc, char *argv[])
                 show_help();
                 return EXIT_SUCCESS;
                 break;
+            case STATS_OPT:
+                stats_enable(APP_NAME);
+                break;
             default:
                 show_help();
                 return EXIT_FAILURE;
@@ -66,7 +70,7 @@ int main(const int argc, char *argv[])
         }
     }
 
-    if (argc == 1) {
+    if (argc == optind) {
         while (true)
             printf("%s\n", "y");
     }